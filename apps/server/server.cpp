@@ -36,34 +36,125 @@
 #include "aditof/device_factory.h"
 #include "buffer.pb.h"
 
-#include "../../sdk/src/local_device.h"
+#include "../../sdk/src/frame_codec.h"
+#include "../../sdk/src/frame_stream.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
-#include <linux/videodev2.h>
+#include <list>
 #include <map>
+#include <mutex>
+#include <set>
 #include <string>
 #include <sys/time.h>
+#include <thread>
+#include <vector>
 
 using namespace google::protobuf::io;
 using namespace std;
 
 static int interrupted = 0;
 
-static std::shared_ptr<LocalDevice> device = nullptr;
+/* When set, the server plays back this recording (see ReplayDevice) instead
+ * of giving access to the sensors of the system */
+static std::string replay_manifest;
+
+/* A sensor instantiated by one or more clients. Clients that instantiate a
+ * device with the same driver path share it. While at least one of them
+ * streams, a capture thread serializes every frame once into latestFrame (and
+ * compresses it once into latestCompressedFrame if any of the clients asked
+ * for compression) and the same buffer is sent to all the clients that stream
+ * it. */
+struct SharedDevice {
+    std::string driverPath;
+    std::shared_ptr<aditof::DeviceInterface> device;
+    aditof::FrameDetails frameDetails = {0, 0, ""};
+    bool opened = false;
+    unsigned int startCount = 0;
+    unsigned int streamCount = 0;
+    std::atomic<unsigned int> compressedStreamCount{0};
+
+    // Held around every call to the device, the capture thread leasing frames
+    // while a client programs the device or reads its registers. Never held
+    // while joining the capture thread.
+    std::mutex deviceMutex;
+
+    std::thread captureThread;
+    std::atomic<bool> capturing{false};
+    std::mutex frameMutex;
+    // Wakes the capture thread up from its back off when capture stops
+    std::condition_variable captureCv;
+    std::shared_ptr<std::vector<unsigned char>> latestFrame;
+    std::shared_ptr<std::vector<unsigned char>> latestCompressedFrame;
+    uint32_t frameSequence = 0;
+
+    ~SharedDevice();
+};
+
+/* The state of one connected client */
+struct ClientSession {
+    struct lws *wsi = nullptr;
+    std::shared_ptr<SharedDevice> device;
+    aditof::FrameStreamCodec codec = aditof::FrameStreamCodec::RAW12;
+    bool started = false;
+    bool streaming = false;
+    uint32_t lastSentSequence = 0;
+
+    /* A GET_FRAME waiting for the capture thread to capture a frame newer
+     * than lastFrameSequence, the last one the client got */
+    bool frameRequested = false;
+    uint32_t frameRequestId = 0;
+    uint32_t lastFrameSequence = 0;
+
+    /* Message being received in several fragments */
+    bool hasFragments = false;
+    std::vector<char> data;
+
+    /* Replies waiting to be sent, in the order of the requests. A client may
+     * send several requests before reading the replies. Sent replies are
+     * moved to spareReplies so that their buffers are reused. */
+    std::list<std::vector<unsigned char>> replies;
+    std::list<std::vector<unsigned char>> spareReplies;
+};
+
 static payload::ClientRequest buff_recv;
 static payload::ServerResponse buff_send;
+// Replies to the GET_FRAME requests answered by the capture thread
+static payload::ServerResponse frame_reply;
 static std::map<string, api_Values> s_map_api_Values;
 static void Initialize();
-void invoke_sdk_api(payload::ClientRequest buff_recv);
-static bool Client_Connected = false;
-static bool no_of_client_connected = false;
-static unsigned int frame_width = 0;
-static unsigned int frame_height = 0;
-bool latest_sent_msg_is_was_buffered = false;
+bool invoke_sdk_api(ClientSession *session,
+                    const payload::ClientRequest &buff_recv);
+static std::set<ClientSession *> sessions;
+static std::map<std::string, std::weak_ptr<SharedDevice>> devices;
+static struct lws_context *server_context = nullptr;
+
+static void queue_reply(ClientSession *session,
+                        const payload::ServerResponse &response);
+static void add_frame_payload(ClientSession *session,
+                              payload::ServerResponse &response,
+                              const uint8_t *data, size_t size);
+static bool reply_captured_frame(ClientSession *session,
+                                 payload::ServerResponse &response);
+static void answer_frame_requests(SharedDevice *dev);
+static bool has_frame_to_send(ClientSession *session);
+static void send_frame(ClientSession *session);
+static void start_capture(SharedDevice *dev);
+static void stop_capture(SharedDevice *dev);
+static void start_streaming(ClientSession *session);
+static void stop_streaming(ClientSession *session);
+static aditof::Status stop_device(ClientSession *session);
+static void release_device(ClientSession *session);
+static aditof::Status lease_frame(aditof::DeviceInterface *device,
+                                  aditof::FrameLease &lease,
+                                  const uint8_t **data, size_t &size,
+                                  aditof::FrameMetadata &metadata);
 
 struct clientData {
-    bool hasFragments;
-    std::vector<char> data;
+    ClientSession *session;
 };
 
 static struct lws_protocols protocols[] = {
@@ -82,23 +173,20 @@ int Network::callback_function(struct lws *wsi,
                                enum lws_callback_reasons reason, void *user,
                                void *in, size_t len) {
     int n;
+    struct clientData *clientData = static_cast<struct clientData *>(user);
 
     switch (reason) {
     case LWS_CALLBACK_ESTABLISHED: {
-        /*Check if another client is connected or not*/
+        cout << "Conn Established" << endl;
+        ClientSession *session = new ClientSession;
+        session->wsi = wsi;
+        clientData->session = session;
+        sessions.insert(session);
+
         buff_send.Clear();
-        if (Client_Connected == false) {
-            cout << "Conn Established" << endl;
-            Client_Connected = true;
-            buff_send.set_message("Connection Allowed");
-            lws_callback_on_writable(wsi);
-            break;
-        } else {
-            cout << "Another client connected" << endl;
-            no_of_client_connected = true;
-            buff_send.set_message("Only 1 client connection allowed");
-            lws_callback_on_writable(wsi);
-        }
+        buff_send.set_message("Connection Allowed");
+        queue_reply(session, buff_send);
+        lws_callback_on_writable(wsi);
         break;
     }
 
@@ -109,16 +197,16 @@ int Network::callback_function(struct lws *wsi,
         const size_t remaining = lws_remaining_packet_payload(wsi);
         bool isFinal = lws_is_final_fragment(wsi);
 
-        struct clientData *clientData = static_cast<struct clientData *>(user);
+        ClientSession *session = clientData->session;
 
         if (!remaining && isFinal) {
-            if (clientData->hasFragments) {
+            if (session->hasFragments) {
                 // apend message
                 char *inData = static_cast<char *>(in);
-                clientData->data.insert(clientData->data.end(), inData,
-                                        inData + len);
-                in = static_cast<void *>(clientData->data.data());
-                len = clientData->data.size();
+                session->data.insert(session->data.end(), inData,
+                                     inData + len);
+                in = static_cast<void *>(session->data.data());
+                len = session->data.size();
             }
 
             // process message
@@ -127,78 +215,88 @@ int Network::callback_function(struct lws *wsi,
 
             buff_recv.ParseFromCodedStream(&coded_input);
 
-            invoke_sdk_api(buff_recv);
-            lws_callback_on_writable(wsi);
+            // A GET_FRAME may be answered later by the capture thread
+            if (invoke_sdk_api(session, buff_recv)) {
+                buff_send.set_request_id(buff_recv.request_id());
+                queue_reply(session, buff_send);
+                lws_callback_on_writable(wsi);
+            }
+            buff_recv.Clear();
 
-            clientData->data.clear();
-            clientData->hasFragments = false;
+            session->data.clear();
+            session->hasFragments = false;
         } else {
             // append message
-            if (clientData->data.size() == 0) {
-                clientData->data.reserve(len + remaining);
+            if (session->data.size() == 0) {
+                session->data.reserve(len + remaining);
             }
             char *inData = static_cast<char *>(in);
-            clientData->data.insert(clientData->data.end(), inData,
-                                    inData + len);
-            clientData->hasFragments = true;
+            session->data.insert(session->data.end(), inData, inData + len);
+            session->hasFragments = true;
         }
 
         break;
     }
 
-    case LWS_CALLBACK_SERVER_WRITEABLE: {
-        // TO INVESTIGATE: Currently this workaround prevents the server to send
-        // the image buffer over and over again but as a side effect it lowers
-        // the FPS with about 2-3 frames. How to avoid FPS reduction?
-        if (latest_sent_msg_is_was_buffered) {
-            latest_sent_msg_is_was_buffered = false;
-            break;
+    case LWS_CALLBACK_EVENT_WAIT_CANCELLED: {
+        /* A capture thread has a new frame for the streaming clients and the
+         * ones waiting for a GET_FRAME, or it stopped capturing */
+        for (ClientSession *session : sessions) {
+            if (session->frameRequested) {
+                answer_frame_requests(session->device.get());
+            }
+            if (has_frame_to_send(session)) {
+                lws_callback_on_writable(session->wsi);
+            }
         }
+        break;
+    }
 
-        int siz = buff_send.ByteSize();
-        unsigned char *pkt =
-            new unsigned char[siz + LWS_SEND_BUFFER_PRE_PADDING];
-        unsigned char *pkt_pad = pkt + LWS_SEND_BUFFER_PRE_PADDING;
-        google::protobuf::io::ArrayOutputStream aos(pkt_pad, siz);
-        CodedOutputStream *coded_output = new CodedOutputStream(&aos);
-        buff_send.SerializeToCodedStream(coded_output);
-
-        n = lws_write(wsi, pkt_pad, (siz), LWS_WRITE_TEXT);
-        if (lws_partial_buffered(wsi)) {
-            latest_sent_msg_is_was_buffered = true;
-        }
+    case LWS_CALLBACK_SERVER_WRITEABLE: {
+        // Writeable is also reported after libwebsockets finished sending a
+        // partially buffered message, so only send what is actually pending.
+        // Replies go first, frames are sent when there is no reply waiting.
+        ClientSession *session = clientData->session;
+
+        if (!session->replies.empty()) {
+            std::vector<unsigned char> &reply = session->replies.front();
+            int siz = static_cast<int>(reply.size() - LWS_PRE);
+
+            n = lws_write(wsi, reply.data() + LWS_PRE, siz, LWS_WRITE_TEXT);
 #ifdef NW_DEBUG
-        cout << "server is sending " << n << endl;
+            cout << "server is sending " << n << endl;
 #endif
-        if (n < 0)
-            cout << "Error Sending" << endl;
-        else if (n < siz)
-            cout << "Partial write" << endl;
-        else if (n == siz) {
+            if (n < 0)
+                cout << "Error Sending" << endl;
+            else if (n < siz)
+                cout << "Partial write" << endl;
+            else if (n == siz) {
 #ifdef NW_DEBUG
-            cout << "Write successful" << endl;
+                cout << "Write successful" << endl;
 #endif
+            }
+            session->spareReplies.splice(session->spareReplies.end(),
+                                         session->replies,
+                                         session->replies.begin());
+
+            if (!session->replies.empty() || has_frame_to_send(session)) {
+                lws_callback_on_writable(wsi);
+            }
+            break;
         }
-        delete coded_output;
-        delete[] pkt;
+
+        send_frame(session);
         break;
     }
 
     case LWS_CALLBACK_CLOSED: {
-        if (Client_Connected == true && no_of_client_connected == false) {
-            /*CONN_CLOSED event is for first and only client connected*/
-            cout << "Connection Closed" << endl;
-            if (device) {
-                device.reset();
-            }
-            Client_Connected = false;
-            break;
-        } else {
-            /*CONN_CLOSED event for more than 1 client connected */
-            cout << "Another Client Connection Closed" << endl;
-            no_of_client_connected = false;
-            break;
-        }
+        cout << "Connection Closed" << endl;
+        ClientSession *session = clientData->session;
+        release_device(session);
+        sessions.erase(session);
+        delete session;
+        clientData->session = nullptr;
+        break;
     }
 
     default: {
@@ -213,8 +311,24 @@ int Network::callback_function(struct lws *wsi,
 
 void sigint_handler(int) { interrupted = 1; }
 
+static void print_usage(const char *name) {
+    cout << "Usage: " << name << " [--replay <manifest>]" << endl;
+    cout << "  --replay <manifest>  serve a recording instead of the sensors"
+         << endl;
+}
+
 int main(int argc, char *argv[]) {
 
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--replay" && i + 1 < argc) {
+            replay_manifest = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
     signal(SIGINT, sigint_handler);
     signal(SIGTERM, sigint_handler);
 
@@ -229,6 +343,7 @@ int main(int argc, char *argv[]) {
     Network *network = new Network();
 
     network->context = lws_create_context(&info);
+    server_context = network->context;
 
     Initialize();
 
@@ -250,21 +365,43 @@ int main(int argc, char *argv[]) {
     return 0;
 }
 
-void invoke_sdk_api(payload::ClientRequest buff_recv) {
+// Returns false when the reply to the request is queued later on
+bool invoke_sdk_api(ClientSession *session,
+                    const payload::ClientRequest &buff_recv) {
     buff_send.Clear();
     buff_send.set_server_status(::payload::ServerStatus::REQUEST_ACCEPTED);
 
-    switch (s_map_api_Values[buff_recv.func_name()]) {
+    api_Values api = s_map_api_Values[buff_recv.func_name()];
+    SharedDevice *dev = session->device.get();
+    aditof::DeviceInterface *device = dev ? dev->device.get() : nullptr;
+
+    if (!device && api != FIND_DEVICES && api != INSTANTIATE_DEVICE &&
+        api != DESTROY_DEVICE && api != API_NOT_DEFINED) {
+        std::string msgErr = "No device instantiated";
+        cout << msgErr << "\n";
+
+        buff_send.set_message(msgErr);
+        buff_send.set_status(::payload::Status::INVALID_ARGUMENT);
+        return true;
+    }
+
+    switch (api) {
 
     case FIND_DEVICES: {
 #ifdef DEBUG
         cout << "FindDevices function\n";
 #endif
         std::vector<aditof::DeviceConstructionData> devicesInfo;
-        auto localDevEnumerator =
-            aditof::DeviceEnumeratorFactory::buildDeviceEnumerator();
-
-        aditof::Status status = localDevEnumerator->findDevices(devicesInfo);
+        aditof::Status status = aditof::Status::OK;
+        if (replay_manifest.empty()) {
+            auto localDevEnumerator =
+                aditof::DeviceEnumeratorFactory::buildDeviceEnumerator();
+            status = localDevEnumerator->findDevices(devicesInfo);
+        } else {
+            aditof::DeviceConstructionData devData;
+            devData.driverPath = replay_manifest;
+            devicesInfo.push_back(devData);
+        }
         for (const auto &devInfo : devicesInfo) {
             auto pbDevInfo = buff_send.add_device_info();
             pbDevInfo->set_device_type(static_cast<::payload::DeviceType>(
@@ -281,19 +418,55 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
 #endif
         aditof::Status status = aditof::Status::OK;
         std::string errMsg;
-        aditof::DeviceConstructionData devData;
-
-        devData.deviceType = aditof::DeviceType::LOCAL;
-        devData.driverPath = buff_recv.device_data().driver_path();
-        std::shared_ptr<aditof::DeviceInterface> deviceI =
-            aditof::DeviceFactory::buildDevice(devData);
-        device = std::dynamic_pointer_cast<LocalDevice>(deviceI);
-        if (!device) {
-            errMsg = "Failed to create local device";
+        const std::string &driverPath = buff_recv.device_data().driver_path();
+
+        release_device(session);
+
+        // Share the device with the clients that already use it
+        std::shared_ptr<SharedDevice> shared;
+        auto it = devices.find(driverPath);
+        if (it != devices.end()) {
+            shared = it->second.lock();
+        }
+
+        // A replaying server only gives access to its recording
+        bool replay = !replay_manifest.empty();
+        if (!shared && (!replay || driverPath == replay_manifest)) {
+            aditof::DeviceConstructionData devData;
+            devData.deviceType = replay ? aditof::DeviceType::REPLAY
+                                        : aditof::DeviceType::LOCAL;
+            devData.driverPath = driverPath;
+            std::shared_ptr<aditof::DeviceInterface> deviceI(
+                aditof::DeviceFactory::buildDevice(devData));
+            if (deviceI) {
+                shared = std::make_shared<SharedDevice>();
+                shared->driverPath = driverPath;
+                shared->device = deviceI;
+                devices[driverPath] = shared;
+            }
+        }
+
+        if (!shared) {
+            errMsg = "Failed to create device";
             status = aditof::Status::INVALID_ARGUMENT;
         } else {
+            session->device = shared;
+
+            // Compress the frames for the clients that can decompress them
+            session->codec = aditof::FrameStreamCodec::RAW12;
+            for (auto codec : buff_recv.frame_codecs()) {
+                if (codec == static_cast<uint32_t>(
+                                 aditof::FrameStreamCodec::DELTA12)) {
+                    session->codec = aditof::FrameStreamCodec::DELTA12;
+                }
+            }
+            buff_send.set_frame_codec(static_cast<uint32_t>(session->codec));
+
             aditof::DeviceDetails devDetails;
-            deviceI->getDetails(devDetails);
+            {
+                std::lock_guard<std::mutex> lock(shared->deviceMutex);
+                shared->device->getDetails(devDetails);
+            }
             buff_send.set_sensor_type(
                 static_cast<::payload::SensorType>(devDetails.sensorType));
         }
@@ -307,9 +480,7 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
 #ifdef DEBUG
         cout << "DestroyDevice function\n";
 #endif
-        if (device) {
-            device.reset();
-        }
+        release_device(session);
         break;
     }
 
@@ -317,7 +488,12 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
 #ifdef DEBUG
         cout << "Open function\n";
 #endif
-        aditof::Status status = device->open();
+        aditof::Status status = aditof::Status::OK;
+        if (!dev->opened) {
+            std::lock_guard<std::mutex> lock(dev->deviceMutex);
+            status = device->open();
+            dev->opened = (status == aditof::Status::OK);
+        }
         buff_send.set_status(static_cast<::payload::Status>(status));
         break;
     }
@@ -326,7 +502,23 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
 #ifdef DEBUG
         cout << "Start function\n";
 #endif
-        aditof::Status status = device->start();
+        // The device runs as long as one of its clients has started it
+        aditof::Status status = aditof::Status::OK;
+        if (session->started) {
+            status = aditof::Status::BUSY;
+        } else {
+            if (dev->startCount == 0) {
+                std::lock_guard<std::mutex> lock(dev->deviceMutex);
+                status = device->start();
+            }
+            if (status == aditof::Status::OK) {
+                session->started = true;
+                ++dev->startCount;
+            }
+            if (status == aditof::Status::OK && dev->streamCount > 0) {
+                start_capture(dev);
+            }
+        }
         buff_send.set_status(static_cast<::payload::Status>(status));
         break;
     }
@@ -335,7 +527,8 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
 #ifdef DEBUG
         cout << "Stop function\n";
 #endif
-        aditof::Status status = device->stop();
+        stop_streaming(session);
+        aditof::Status status = stop_device(session);
         buff_send.set_status(static_cast<::payload::Status>(status));
         break;
     }
@@ -345,7 +538,9 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
         cout << "GetAvailableFrameTypes function" << endl;
 #endif
         std::vector<aditof::FrameDetails> frameDetails;
+        std::unique_lock<std::mutex> lock(dev->deviceMutex);
         aditof::Status status = device->getAvailableFrameTypes(frameDetails);
+        lock.unlock();
         for (auto detail : frameDetails) {
             auto type = buff_send.add_available_frame_types();
             type->set_width(detail.width);
@@ -360,15 +555,42 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
 #ifdef DEBUG
         cout << "SetFrameType function\n";
 #endif
+        stop_streaming(session);
+
         aditof::FrameDetails details;
         details.width = buff_recv.frame_type().width();
         details.height = buff_recv.frame_type().height();
         details.type = buff_recv.frame_type().type();
-        aditof::Status status = device->setFrameType(details);
-        buff_send.set_status(static_cast<::payload::Status>(status));
 
-        frame_width = details.width;
-        frame_height = details.height;
+        aditof::Status status = aditof::Status::OK;
+        if (details != dev->frameDetails) {
+            // The frame type is the same for all the clients of the device.
+            // Changing it needs the device to be stopped and the leases of
+            // the capture thread released, so pause the other clients for the
+            // time being. An unchanged type leaves the device alone.
+            bool capturing = dev->captureThread.joinable();
+            stop_capture(dev);
+
+            std::unique_lock<std::mutex> lock(dev->deviceMutex);
+            if (dev->startCount > 0) {
+                device->stop();
+            }
+
+            status = device->setFrameType(details);
+            if (status == aditof::Status::OK) {
+                dev->frameDetails = details;
+            }
+
+            if (dev->startCount > 0) {
+                device->start();
+            }
+            lock.unlock();
+
+            if (capturing && dev->streamCount > 0) {
+                start_capture(dev);
+            }
+        }
+        buff_send.set_status(static_cast<::payload::Status>(status));
         break;
     }
 
@@ -379,7 +601,9 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
         size_t programSize = static_cast<size_t>(buff_recv.func_int32_param(0));
         const uint8_t *pdata = reinterpret_cast<const uint8_t *>(
             buff_recv.func_bytes_param(0).c_str());
+        std::unique_lock<std::mutex> lock(dev->deviceMutex);
         aditof::Status status = device->program(pdata, programSize);
+        lock.unlock();
         buff_send.set_status(static_cast<::payload::Status>(status));
         break;
     }
@@ -388,37 +612,45 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
 #ifdef DEBUG
         cout << "GetFrame function\n";
 #endif
-        aditof::Status status = device->waitForBuffer();
-        if (status != aditof::Status::OK) {
-            buff_send.set_status(static_cast<::payload::Status>(status));
-            break;
-        }
-
-        struct v4l2_buffer buf;
-
-        status = device->dequeueInternalBuffer(buf);
-        if (status != aditof::Status::OK) {
-            buff_send.set_status(static_cast<::payload::Status>(status));
-            break;
+        if (dev->capturing) {
+            // Other clients stream from this device, so take the next frame
+            // from their capture thread instead of dequeuing one concurrently.
+            // Until it is captured, the other clients keep being served.
+            if (reply_captured_frame(session, buff_send)) {
+                break;
+            }
+            session->frameRequested = true;
+            session->frameRequestId = buff_recv.request_id();
+            return false;
         }
 
-        unsigned int buf_data_len;
-        uint8_t *buffer;
+        // The lease is held until the frame is copied into the reply
+        std::lock_guard<std::mutex> lock(dev->deviceMutex);
+        aditof::FrameLease lease;
+        const uint8_t *data;
+        size_t size;
+        aditof::FrameMetadata metadata;
 
-        status = device->getInternalBuffer(&buffer, buf_data_len, buf);
+        aditof::Status status =
+            lease_frame(device, lease, &data, size, metadata);
         if (status != aditof::Status::OK) {
             buff_send.set_status(static_cast<::payload::Status>(status));
             break;
         }
 
-        buff_send.add_bytes_payload(buffer, buf_data_len * sizeof(uint8_t));
+        add_frame_payload(session, buff_send, data, size);
+        buff_send.set_frame_sequence(metadata.sequence);
+        buff_send.set_frame_timestamp(metadata.sensorTimestamp);
 
-        status = device->enqueueInternalBuffer(buf);
-        if (status != aditof::Status::OK) {
-            buff_send.set_status(static_cast<::payload::Status>(status));
-            break;
-        }
+        buff_send.set_status(payload::Status::OK);
+        break;
+    }
 
+    case START_STREAMING: {
+#ifdef DEBUG
+        cout << "StartStreaming function\n";
+#endif
+        start_streaming(session);
         buff_send.set_status(payload::Status::OK);
         break;
     }
@@ -430,7 +662,9 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
         uint32_t address = static_cast<uint32_t>(buff_recv.func_int32_param(0));
         size_t length = static_cast<size_t>(buff_recv.func_int32_param(1));
         uint8_t *buffer = new uint8_t[length];
+        std::unique_lock<std::mutex> lock(dev->deviceMutex);
         aditof::Status status = device->readEeprom(address, buffer, length);
+        lock.unlock();
         if (status == aditof::Status::OK) {
             buff_send.add_bytes_payload(buffer, length);
         }
@@ -448,7 +682,9 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
         const uint8_t *buffer = reinterpret_cast<const uint8_t *>(
             buff_recv.func_bytes_param(0).c_str());
 
+        std::unique_lock<std::mutex> lock(dev->deviceMutex);
         aditof::Status status = device->writeEeprom(address, buffer, length);
+        lock.unlock();
         buff_send.set_status(static_cast<::payload::Status>(status));
         break;
     }
@@ -461,7 +697,9 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
         const uint16_t *address = reinterpret_cast<const uint16_t *>(
             buff_recv.func_bytes_param(0).c_str());
         uint16_t *data = new uint16_t[length];
+        std::unique_lock<std::mutex> lock(dev->deviceMutex);
         aditof::Status status = device->readAfeRegisters(address, data, length);
+        lock.unlock();
         if (status == aditof::Status::OK) {
             buff_send.add_bytes_payload(data, length * sizeof(uint16_t));
         }
@@ -479,8 +717,10 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
             buff_recv.func_bytes_param(0).c_str());
         const uint16_t *data = reinterpret_cast<const uint16_t *>(
             buff_recv.func_bytes_param(1).c_str());
+        std::unique_lock<std::mutex> lock(dev->deviceMutex);
         aditof::Status status =
             device->writeAfeRegisters(address, data, length);
+        lock.unlock();
         buff_send.set_status(static_cast<::payload::Status>(status));
         break;
     }
@@ -490,7 +730,9 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
         cout << "ReadAfeTemp function\n";
 #endif
         float temperature;
+        std::unique_lock<std::mutex> lock(dev->deviceMutex);
         aditof::Status status = device->readAfeTemp(temperature);
+        lock.unlock();
         if (status == aditof::Status::OK) {
             buff_send.add_float_payload(temperature);
         }
@@ -503,7 +745,9 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
         cout << "ReadLaserTemp function\n";
 #endif
         float temperature;
+        std::unique_lock<std::mutex> lock(dev->deviceMutex);
         aditof::Status status = device->readLaserTemp(temperature);
+        lock.unlock();
         if (status == aditof::Status::OK) {
             buff_send.add_float_payload(temperature);
         }
@@ -521,9 +765,10 @@ void invoke_sdk_api(payload::ClientRequest buff_recv) {
     }
     } // switch
 
-    buff_recv.Clear();
+    return true;
 }
 
+
 void Initialize() {
     s_map_api_Values["FindDevices"] = FIND_DEVICES;
     s_map_api_Values["InstantiateDevice"] = INSTANTIATE_DEVICE;
@@ -541,4 +786,381 @@ void Initialize() {
     s_map_api_Values["WriteAfeRegisters"] = WRITE_AFE_REGISTERS;
     s_map_api_Values["ReadAfeTemp"] = READ_AFE_TEMP;
     s_map_api_Values["ReadLaserTemp"] = READ_LASER_TEMP;
+    s_map_api_Values["StartStreaming"] = START_STREAMING;
+}
+
+SharedDevice::~SharedDevice() {
+    stop_capture(this);
+    if (startCount > 0) {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        device->stop();
+    }
+}
+
+static void queue_reply(ClientSession *session,
+                        const payload::ServerResponse &response) {
+    if (session->spareReplies.empty()) {
+        session->spareReplies.emplace_back();
+    }
+    session->replies.splice(session->replies.end(), session->spareReplies,
+                            session->spareReplies.begin());
+    std::vector<unsigned char> &reply = session->replies.back();
+
+    // resize() keeps the capacity of the buffer, so it only allocates when a
+    // reply is larger than all the previous ones
+    size_t siz = response.ByteSizeLong();
+    reply.resize(LWS_PRE + siz);
+    response.SerializeWithCachedSizesToArray(reply.data() + LWS_PRE);
+}
+
+static void add_frame_payload(ClientSession *session,
+                              payload::ServerResponse &response,
+                              const uint8_t *data, size_t size) {
+    if (session->codec != aditof::FrameStreamCodec::DELTA12) {
+        response.add_bytes_payload(data, size);
+        return;
+    }
+
+    size_t rowLength = session->device->frameDetails.width;
+    std::string *payload = response.add_bytes_payload();
+    payload->resize(aditof::compressedFrameBound(size, rowLength));
+    payload->resize(aditof::compressFrame(
+        data, size, rowLength, reinterpret_cast<uint8_t *>(&(*payload)[0])));
+}
+
+// Fills the response with the latest captured frame if the client didn't get
+// it yet
+static bool reply_captured_frame(ClientSession *session,
+                                 payload::ServerResponse &response) {
+    SharedDevice *dev = session->device.get();
+    std::shared_ptr<std::vector<unsigned char>> frame;
+    {
+        std::lock_guard<std::mutex> lock(dev->frameMutex);
+        if (!dev->latestFrame ||
+            dev->frameSequence == session->lastFrameSequence) {
+            return false;
+        }
+        frame = dev->latestFrame;
+        session->lastFrameSequence = dev->frameSequence;
+    }
+
+    aditof::FrameStreamHeader header;
+    memcpy(&header, frame->data() + LWS_PRE, sizeof(header));
+    response.set_frame_sequence(header.sequence);
+    response.set_frame_timestamp(header.timestamp);
+
+    size_t offset = LWS_PRE + sizeof(header);
+    add_frame_payload(session, response, frame->data() + offset,
+                      frame->size() - offset);
+    response.set_status(payload::Status::OK);
+    return true;
+}
+
+// Replies to the clients of the device waiting for a GET_FRAME, with a new
+// frame or with an error once the device stopped capturing
+static void answer_frame_requests(SharedDevice *dev) {
+    for (ClientSession *session : sessions) {
+        if (!session->frameRequested || session->device.get() != dev) {
+            continue;
+        }
+
+        frame_reply.Clear();
+        frame_reply.set_server_status(
+            ::payload::ServerStatus::REQUEST_ACCEPTED);
+        if (!dev->capturing) {
+            frame_reply.set_status(payload::Status::GENERIC_ERROR);
+        } else if (!reply_captured_frame(session, frame_reply)) {
+            continue;
+        }
+        frame_reply.set_request_id(session->frameRequestId);
+        session->frameRequested = false;
+        queue_reply(session, frame_reply);
+        lws_callback_on_writable(session->wsi);
+    }
+}
+
+static std::shared_ptr<std::vector<unsigned char>> &
+latest_frame(ClientSession *session) {
+    SharedDevice *dev = session->device.get();
+
+    return session->codec == aditof::FrameStreamCodec::DELTA12
+               ? dev->latestCompressedFrame
+               : dev->latestFrame;
+}
+
+static bool has_frame_to_send(ClientSession *session) {
+    if (!session->streaming) {
+        return false;
+    }
+
+    SharedDevice *dev = session->device.get();
+    std::lock_guard<std::mutex> lock(dev->frameMutex);
+
+    return latest_frame(session) &&
+           dev->frameSequence != session->lastSentSequence;
+}
+
+static void send_frame(ClientSession *session) {
+    if (!session->streaming) {
+        return;
+    }
+
+    SharedDevice *dev = session->device.get();
+    std::shared_ptr<std::vector<unsigned char>> frame;
+    {
+        std::lock_guard<std::mutex> lock(dev->frameMutex);
+        frame = latest_frame(session);
+        if (!frame || dev->frameSequence == session->lastSentSequence) {
+            return;
+        }
+        session->lastSentSequence = dev->frameSequence;
+    }
+
+    // The same buffer goes to every client. libwebsockets only writes the
+    // websocket header in the LWS_PRE bytes in front of the payload (server
+    // messages are not masked) and all the writes happen on this thread.
+    size_t siz = frame->size() - LWS_PRE;
+    int n = lws_write(session->wsi, frame->data() + LWS_PRE, siz,
+                      LWS_WRITE_BINARY);
+    if (n < 0) {
+        cout << "Error Sending frame" << endl;
+    }
+}
+
+static aditof::Status lease_frame(aditof::DeviceInterface *device,
+                                  aditof::FrameLease &lease,
+                                  const uint8_t **data, size_t &size,
+                                  aditof::FrameMetadata &metadata) {
+    aditof::Status status = device->getFrameLease(lease);
+    if (status != aditof::Status::OK) {
+        return status;
+    }
+
+    status = lease.getPackedData(data, size);
+    if (status != aditof::Status::OK) {
+        return status;
+    }
+
+    // Devices that don't report metadata still get their frames sent
+    if (device->getFrameMetadata(metadata) != aditof::Status::OK) {
+        metadata = aditof::FrameMetadata();
+    }
+
+    return aditof::Status::OK;
+}
+
+// Frames failing in a row before the capture thread gives up, and the longest
+// wait between two attempts
+static const unsigned int skMaxCaptureFailures = 50;
+static const std::chrono::milliseconds skMaxCaptureBackoff(500);
+
+static void capture_frames(SharedDevice *dev) {
+    aditof::DeviceInterface *device = dev->device.get();
+    const uint16_t width = static_cast<uint16_t>(dev->frameDetails.width);
+    const uint16_t height = static_cast<uint16_t>(dev->frameDetails.height);
+    uint32_t sequence = dev->frameSequence;
+
+    // Buffers are reused once no client is sending them anymore
+    typedef std::shared_ptr<std::vector<unsigned char>> FrameBuffer;
+    std::vector<FrameBuffer> buffers;
+    std::vector<FrameBuffer> compressedBuffers;
+    auto takeBuffer = [](std::vector<FrameBuffer> &pool) {
+        for (const auto &buffer : pool) {
+            if (buffer.use_count() == 1) {
+                return buffer;
+            }
+        }
+        pool.push_back(std::make_shared<std::vector<unsigned char>>());
+        return pool.back();
+    };
+
+    unsigned int failures = 0;
+    while (dev->capturing) {
+        aditof::FrameLease lease;
+        const uint8_t *buffer;
+        size_t buf_data_len;
+        aditof::FrameMetadata metadata;
+
+        std::unique_lock<std::mutex> deviceLock(dev->deviceMutex);
+        aditof::Status status =
+            lease_frame(device, lease, &buffer, buf_data_len, metadata);
+        if (status != aditof::Status::OK) {
+            lease.release();
+            deviceLock.unlock();
+
+            // Give the device time to recover, then give up on it
+            if (++failures == skMaxCaptureFailures) {
+                cout << "Capture stopped after " << failures
+                     << " failed frames" << endl;
+                dev->capturing = false;
+                break;
+            }
+            std::chrono::milliseconds backoff = std::min(
+                std::chrono::milliseconds(10 << std::min(failures, 6u)),
+                skMaxCaptureBackoff);
+            std::unique_lock<std::mutex> lock(dev->frameMutex);
+            dev->captureCv.wait_for(lock, backoff,
+                                    [dev]() { return !dev->capturing; });
+            continue;
+        }
+        failures = 0;
+
+        if (++sequence == 0) {
+            sequence = 1;
+        }
+
+        aditof::FrameStreamHeader header;
+        header.magic = aditof::FRAME_STREAM_MAGIC;
+        header.version = aditof::FRAME_STREAM_VERSION;
+        header.headerSize = sizeof(header);
+        header.sequence = sequence;
+        header.width = width;
+        header.height = height;
+        header.timestamp = metadata.sensorTimestamp;
+        header.codec = static_cast<uint16_t>(aditof::FrameStreamCodec::RAW12);
+        header.reserved = 0;
+        header.payloadSize = static_cast<uint32_t>(buf_data_len);
+
+        FrameBuffer frame = takeBuffer(buffers);
+        frame->resize(LWS_PRE + sizeof(header) + buf_data_len);
+        memcpy(frame->data() + LWS_PRE, &header, sizeof(header));
+        memcpy(frame->data() + LWS_PRE + sizeof(header), buffer, buf_data_len);
+
+        lease.release();
+        deviceLock.unlock();
+
+        FrameBuffer compressedFrame;
+        if (dev->compressedStreamCount > 0) {
+            compressedFrame = takeBuffer(compressedBuffers);
+            const uint8_t *raw = frame->data() + LWS_PRE + sizeof(header);
+            compressedFrame->resize(
+                LWS_PRE + sizeof(header) +
+                aditof::compressedFrameBound(buf_data_len, width));
+
+            header.codec =
+                static_cast<uint16_t>(aditof::FrameStreamCodec::DELTA12);
+            header.payloadSize = static_cast<uint32_t>(aditof::compressFrame(
+                raw, buf_data_len, width,
+                compressedFrame->data() + LWS_PRE + sizeof(header)));
+            memcpy(compressedFrame->data() + LWS_PRE, &header, sizeof(header));
+            compressedFrame->resize(LWS_PRE + sizeof(header) +
+                                    header.payloadSize);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(dev->frameMutex);
+            dev->latestFrame = frame;
+            dev->latestCompressedFrame = compressedFrame;
+            dev->frameSequence = sequence;
+        }
+        lws_cancel_service(server_context);
+    }
+
+    // Let the clients waiting for a frame know that none is coming
+    lws_cancel_service(server_context);
+}
+
+static void start_capture(SharedDevice *dev) {
+    if (dev->captureThread.joinable()) {
+        if (dev->capturing) {
+            return;
+        }
+        // The previous thread gave up on the device
+        dev->captureThread.join();
+    }
+
+    dev->capturing = true;
+    dev->captureThread = std::thread(capture_frames, dev);
+}
+
+static void stop_capture(SharedDevice *dev) {
+    if (!dev->captureThread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(dev->frameMutex);
+        dev->capturing = false;
+    }
+    dev->captureCv.notify_all();
+    dev->captureThread.join();
+    answer_frame_requests(dev);
+
+    // Don't send frames captured with settings that may change now
+    std::lock_guard<std::mutex> lock(dev->frameMutex);
+    dev->latestFrame.reset();
+    dev->latestCompressedFrame.reset();
+}
+
+static void start_streaming(ClientSession *session) {
+    if (session->streaming) {
+        return;
+    }
+
+    session->streaming = true;
+    if (session->codec == aditof::FrameStreamCodec::DELTA12) {
+        ++session->device->compressedStreamCount;
+    }
+    // A device that no client started yet begins capturing on START
+    SharedDevice *dev = session->device.get();
+    if (dev->streamCount++ == 0 && dev->startCount > 0) {
+        start_capture(dev);
+    }
+}
+
+static void stop_streaming(ClientSession *session) {
+    if (!session->streaming) {
+        return;
+    }
+
+    session->streaming = false;
+    if (session->codec == aditof::FrameStreamCodec::DELTA12) {
+        --session->device->compressedStreamCount;
+    }
+    if (--session->device->streamCount == 0) {
+        stop_capture(session->device.get());
+    }
+}
+
+static aditof::Status stop_device(ClientSession *session) {
+    SharedDevice *dev = session->device.get();
+
+    if (!session->started) {
+        // Nothing to undo for this client, but a device that no client
+        // started is stopped as the client asks
+        if (dev->startCount > 0) {
+            return aditof::Status::OK;
+        }
+        std::lock_guard<std::mutex> lock(dev->deviceMutex);
+        return dev->device->stop();
+    }
+
+    session->started = false;
+    if (--dev->startCount > 0) {
+        return aditof::Status::OK;
+    }
+
+    stop_capture(dev);
+    std::lock_guard<std::mutex> lock(dev->deviceMutex);
+    return dev->device->stop();
+}
+
+static void release_device(ClientSession *session) {
+    if (!session->device) {
+        return;
+    }
+
+    stop_streaming(session);
+    if (session->started) {
+        stop_device(session);
+    }
+    session->frameRequested = false;
+
+    std::string driverPath = session->device->driverPath;
+    session->device.reset();
+
+    auto it = devices.find(driverPath);
+    if (it != devices.end() && it->second.expired()) {
+        devices.erase(it);
+    }
 }
@@ -53,6 +53,7 @@ enum api_Values {
     WRITE_AFE_REGISTERS,
     READ_AFE_TEMP,
     READ_LASER_TEMP,
+    START_STREAMING,
 };
 
 enum protocols { PROTOCOL_EXAMPLE, PROTOCOL_COUNT };
@@ -267,6 +267,11 @@ const static int FIRMWARE_CAPACITY = 16384;
 char firmware[FIRMWARE_CAPACITY] = {0};
 unsigned short reg_addr;
 
+/* Batched AFE register reads: a count followed by the addresses */
+const static unsigned int AFE_BATCH_CAPACITY = (MAX_PACKET_SIZE - 2) / 2;
+unsigned short afe_batch_addr[AFE_BATCH_CAPACITY];
+unsigned int afe_batch_count = 0;
+
 /* EEPROM data */
 unsigned int eeprom_read_addr = 0;
 unsigned int eeprom_read_len = 0;
@@ -1152,6 +1157,7 @@ static void uvc_events_process_control(struct uvc_device *dev, uint8_t req,
         switch (cs) {
         case 1: /* AFE Programming */
         case 2: /* AFE Register Read */
+        case 4: /* AFE Batched Register Read */
             switch (req) {
             case UVC_SET_CUR:
                 USB_REQ_DEBUG("Received SET_CUR on %d\n", cs);
@@ -1168,6 +1174,13 @@ static void uvc_events_process_control(struct uvc_device *dev, uint8_t req,
                         &reg_addr,
                         reinterpret_cast<unsigned short *>(resp->data), 1);
                     resp->length = 2;
+                } else if (cs == 4) {
+                    memset(resp->data, 0, MAX_PACKET_SIZE);
+                    device->readAfeRegisters(
+                        afe_batch_addr,
+                        reinterpret_cast<unsigned short *>(resp->data),
+                        afe_batch_count);
+                    resp->length = MAX_PACKET_SIZE;
                 } else {
                     resp->length = 2;
                     memcpy(&resp->data[0], &dev->brightness_val, resp->length);
@@ -1624,6 +1637,13 @@ static int uvc_events_process_data(struct uvc_device *dev,
                 }
             } else if (dev->set_cur_cs == 2) { /* AFE register address */
                 reg_addr = *((unsigned short *)(data->data));
+            } else if (dev->set_cur_cs == 4) { /* AFE register addresses */
+                afe_batch_count = data->data[0];
+                if (afe_batch_count > AFE_BATCH_CAPACITY) {
+                    afe_batch_count = AFE_BATCH_CAPACITY;
+                }
+                memcpy(afe_batch_addr, &data->data[2],
+                       afe_batch_count * sizeof(unsigned short));
             } else if (dev->set_cur_cs == 5) { /* EEPROM Read Address */
                 eeprom_read_addr = *((unsigned int *)&(data->data[0]));
                 eeprom_read_len = data->data[4];
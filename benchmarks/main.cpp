@@ -0,0 +1,491 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "buffer.pb.h"
+#include "calibration_96tof1.h"
+#include "device_utils.h"
+#include "frame_codec.h"
+#include "undistortion.h"
+
+#include <aditof/bilateral_filter.h>
+#include <aditof/device_construction_data.h>
+#include <aditof/device_factory.h>
+#include <aditof/flying_pixel_filter.h>
+#include <aditof/frame.h>
+#include <aditof/median_filter.h>
+#include <aditof/point_cloud.h>
+#include <aditof/variance_filter.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <glog/logging.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+using namespace aditof;
+
+static const unsigned int skDepthIrWidth = 640;
+static const unsigned int skDepthIrHeight = 960;
+static const unsigned int skRawWidth = 668;
+static const unsigned int skRawHeight = 750;
+
+static std::string filter;
+
+//! run - Runs a benchmark and prints its results
+/*!
+    The benchmark is repeated for about half a second, after a warm up run.
+    \param name - the name of the benchmark
+    \param bytes - the amount of data processed by one run, in bytes
+    \param benchmark - the code to measure, processing one frame per run
+*/
+static void run(const std::string &name, size_t bytes,
+                const std::function<void()> &benchmark) {
+    using namespace std::chrono;
+
+    if (name.find(filter) == std::string::npos) {
+        return;
+    }
+
+    benchmark();
+
+    size_t iterations = 0;
+    auto start = steady_clock::now();
+    auto elapsed = steady_clock::duration::zero();
+    do {
+        benchmark();
+        ++iterations;
+        elapsed = steady_clock::now() - start;
+    } while (elapsed < milliseconds(500));
+
+    double ns = duration_cast<nanoseconds>(elapsed).count() /
+                static_cast<double>(iterations);
+    printf("%-32s %12.0f ns/frame %8.2f GB/s\n", name.c_str(), ns,
+           bytes / ns);
+}
+
+//! packedFrame - Builds a packed 12-bit frame with sensor-like content
+static std::vector<char> packedFrame(unsigned int width, unsigned int height) {
+    std::mt19937 generator(0);
+    std::uniform_int_distribution<int> noise(-8, 8);
+    std::vector<char> frame(width * height * 3 / 2);
+
+    int pixel = 2048;
+    for (size_t i = 0; i + 2 < frame.size(); i += 3) {
+        uint16_t pixels[2];
+        for (uint16_t &value : pixels) {
+            pixel = std::min(std::max(pixel + noise(generator), 0), 4095);
+            value = static_cast<uint16_t>(pixel);
+        }
+        frame[i] = static_cast<char>(pixels[0] >> 4);
+        frame[i + 1] = static_cast<char>(pixels[1] >> 4);
+        frame[i + 2] =
+            static_cast<char>((pixels[0] & 0xF) | ((pixels[1] & 0xF) << 4));
+    }
+
+    return frame;
+}
+
+//! writeCalibration - Writes a calibration map for the near mode in the
+//! EEPROM of a device, in the layout read by Calibration96Tof1
+static void writeCalibration(DeviceInterface &device) {
+    const float gainOffset[] = {26, 4, 1.05f, 27, 4, 10.0f};
+    const float intrinsic[] = {5,    36,   370.0f, 0.0f, 320.0f, 0.0f,
+                               370.0f, 240.0f, 0.0f, 0.0f, 1.0f};
+
+    std::vector<float> map;
+    map.push_back(2); // near mode
+    map.push_back(sizeof(gainOffset));
+    map.insert(map.end(), std::begin(gainOffset), std::end(gainOffset));
+    map.push_back(CAMERA_INTRINSIC);
+    map.push_back(sizeof(intrinsic));
+    map.insert(map.end(), std::begin(intrinsic), std::end(intrinsic));
+
+    float size = static_cast<float>(map.size() * sizeof(float));
+    device.writeEeprom(0, reinterpret_cast<uint8_t *>(&size), sizeof(size));
+    device.writeEeprom(4, reinterpret_cast<uint8_t *>(map.data()),
+                       static_cast<size_t>(size));
+}
+
+//! TemporaryCalibrationCache - Points the calibration cache to a temporary
+//! directory, which is removed with its files when going out of scope. The
+//! cache is disabled if the directory can't be created.
+class TemporaryCalibrationCache {
+  public:
+    TemporaryCalibrationCache() {
+#if defined(_WIN32)
+        char base[MAX_PATH];
+        char name[MAX_PATH];
+        // GetTempFileNameA() creates a file with the unique name it returns
+        if (GetTempPathA(MAX_PATH, base) &&
+            GetTempFileNameA(base, "adi", 0, name) && DeleteFileA(name) &&
+            CreateDirectoryA(name, nullptr)) {
+            m_directory = name;
+        }
+#else
+        char name[] = "/tmp/aditof-benchmarks-XXXXXX";
+        if (mkdtemp(name)) {
+            m_directory = name;
+        }
+#endif
+        setCacheDirectory(m_directory);
+    }
+
+    ~TemporaryCalibrationCache() {
+        setCacheDirectory("");
+        if (m_directory.empty()) {
+            return;
+        }
+
+#if defined(_WIN32)
+        WIN32_FIND_DATAA entry;
+        HANDLE find = FindFirstFileA((m_directory + "\\*").c_str(), &entry);
+        if (find != INVALID_HANDLE_VALUE) {
+            do {
+                if (entry.cFileName[0] != '.') {
+                    DeleteFileA(
+                        (m_directory + "\\" + entry.cFileName).c_str());
+                }
+            } while (FindNextFileA(find, &entry));
+            FindClose(find);
+        }
+        RemoveDirectoryA(m_directory.c_str());
+#else
+        if (DIR *dir = opendir(m_directory.c_str())) {
+            while (struct dirent *entry = readdir(dir)) {
+                if (entry->d_name[0] != '.') {
+                    unlink((m_directory + "/" + entry->d_name).c_str());
+                }
+            }
+            closedir(dir);
+        }
+        rmdir(m_directory.c_str());
+#endif
+    }
+
+  private:
+    static void setCacheDirectory(const std::string &directory) {
+#if defined(_WIN32)
+        _putenv_s("ADITOF_CALIBRATION_CACHE", directory.c_str());
+#else
+        setenv("ADITOF_CALIBRATION_CACHE", directory.c_str(), 1);
+#endif
+    }
+
+  private:
+    std::string m_directory;
+};
+
+static void benchmarkDeinterleave() {
+    std::vector<char> depthIr = packedFrame(skDepthIrWidth, skDepthIrHeight);
+    std::vector<uint16_t> depthIrFrame(skDepthIrWidth * skDepthIrHeight);
+    run("deinterleave/depth_ir", depthIr.size(), [&]() {
+        deinterleave(depthIr.data(), depthIrFrame.data(), depthIr.size(),
+                     skDepthIrWidth, skDepthIrHeight);
+    });
+
+    std::vector<char> raw = packedFrame(skRawWidth, skRawHeight);
+    std::vector<uint16_t> rawFrame(skRawWidth * skRawHeight);
+    run("deinterleave/raw", raw.size(), [&]() {
+        deinterleave(raw.data(), rawFrame.data(), raw.size(), skRawWidth,
+                     skRawHeight);
+    });
+}
+
+static void benchmarkCalibration() {
+    // Reading the calibration caches it, which must not touch the cache of
+    // the user
+    TemporaryCalibrationCache cache;
+
+    // A replay device without recording keeps the EEPROM in memory
+    DeviceConstructionData data;
+    data.deviceType = DeviceType::REPLAY;
+    std::shared_ptr<DeviceInterface> device = DeviceFactory::buildDevice(data);
+    writeCalibration(*device);
+
+    Calibration96Tof1 calibration;
+    if (calibration.readCalMap(device) != Status::OK ||
+        calibration.setMode("near", 800, skDepthIrWidth, skDepthIrHeight) !=
+            Status::OK) {
+        LOG(WARNING) << "Failed to set up the calibration";
+        return;
+    }
+
+    std::vector<char> packed = packedFrame(skDepthIrWidth, skDepthIrHeight);
+    std::vector<uint16_t> frame(skDepthIrWidth * skDepthIrHeight);
+    deinterleave(packed.data(), frame.data(), packed.size(), skDepthIrWidth,
+                 skDepthIrHeight);
+    const uint32_t depthSize = skDepthIrWidth * skDepthIrHeight / 2;
+
+    // The calibration runs in place, on data that stays in the sensor range
+    run("calibration/depth", packed.size(), [&]() {
+        calibration.calibrateDepth(frame.data(), depthSize);
+    });
+    run("calibration/geometry", packed.size(), [&]() {
+        calibration.calibrateCameraGeometry(frame.data(), depthSize);
+    });
+    run("calibration/depth_and_geometry", packed.size(), [&]() {
+        calibration.calibrateDepthAndGeometry(frame.data(), depthSize);
+    });
+}
+
+static void benchmarkUndistortion() {
+    IntrinsicParameters intrinsics;
+    intrinsics.cameraMatrix = {370.0f, 0.0f, 320.0f, 0.0f, 370.0f,
+                               240.0f, 0.0f, 0.0f,   1.0f};
+    intrinsics.distCoeffs = {-0.28f, 0.09f, 0.001f, -0.001f, -0.01f};
+
+    const unsigned int height = skDepthIrHeight / 2;
+    Undistortion undistortion;
+    undistortion.setIntrinsics(intrinsics, skDepthIrWidth, height);
+
+    std::vector<char> packed = packedFrame(skDepthIrWidth, skDepthIrHeight);
+    std::vector<uint16_t> frame(skDepthIrWidth * skDepthIrHeight);
+    deinterleave(packed.data(), frame.data(), packed.size(), skDepthIrWidth,
+                 skDepthIrHeight);
+    uint16_t *depth = frame.data();
+    uint16_t *ir = frame.data() + skDepthIrWidth * height;
+
+    // The images are undistorted again at every run, which costs the same
+    run("undistortion/depth_nearest", packed.size() / 2, [&]() {
+        undistortion.undistortDepth(depth, 4095, DepthInterpolation::NEAREST);
+    });
+    run("undistortion/depth_edge_aware", packed.size() / 2, [&]() {
+        undistortion.undistortDepth(depth, 4095,
+                                    DepthInterpolation::EDGE_AWARE);
+    });
+    run("undistortion/ir", packed.size() / 2,
+        [&]() { undistortion.undistortIr(ir); });
+}
+
+static void benchmarkFrame() {
+    FrameDetails depthIr;
+    depthIr.width = skDepthIrWidth;
+    depthIr.height = skDepthIrHeight;
+    depthIr.type = "depth_ir";
+
+    FrameDetails raw;
+    raw.width = skRawWidth;
+    raw.height = skRawHeight;
+    raw.type = "raw";
+
+    const size_t packedSize = skDepthIrWidth * skDepthIrHeight * 3 / 2;
+
+    Frame frame;
+    frame.setDetails(depthIr);
+    run("frame/copy", packedSize, [&]() {
+        Frame copy(frame);
+        (void)copy;
+    });
+
+    Frame source;
+    source.setDetails(depthIr);
+    run("frame/move", packedSize, [&]() {
+        Frame moved(std::move(source));
+        source = std::move(moved);
+    });
+
+    bool useRaw = false;
+    run("frame/set_details", packedSize, [&]() {
+        useRaw = !useRaw;
+        frame.setDetails(useRaw ? raw : depthIr);
+    });
+}
+
+static void benchmarkFilters() {
+    FrameDetails depthIr;
+    depthIr.width = skDepthIrWidth;
+    depthIr.height = skDepthIrHeight;
+    depthIr.type = "depth_ir";
+
+    std::vector<char> packed = packedFrame(skDepthIrWidth, skDepthIrHeight);
+    Frame frame;
+    frame.setDetails(depthIr);
+    uint16_t *data;
+    frame.getData(FrameDataType::RAW, &data);
+    deinterleave(packed.data(), data, packed.size(), skDepthIrWidth,
+                 skDepthIrHeight);
+
+    // In place, the way the filters are used on the frames of a camera
+    VarianceFilter variance;
+    run("filters/variance", packed.size() / 2,
+        [&]() { variance.processFrame(frame, frame); });
+
+    // Into another frame, so that every run filters the same data
+    Frame output;
+    MedianFilter median3(3);
+    run("filters/median_3x3", packed.size() / 2,
+        [&]() { median3.processFrame(frame, output); });
+    MedianFilter median5(5);
+    run("filters/median_5x5", packed.size() / 2,
+        [&]() { median5.processFrame(frame, output); });
+    BilateralFilter bilateral(5);
+    run("filters/bilateral_5x5", packed.size() / 2,
+        [&]() { bilateral.processFrame(frame, output); });
+    FlyingPixelFilter flyingPixel;
+    flyingPixel.setEdgeIrThreshold(100);
+    run("filters/flying_pixel", packed.size() / 2,
+        [&]() { flyingPixel.processFrame(frame, output); });
+}
+
+static void benchmarkPointCloud() {
+    const unsigned int width = skDepthIrWidth;
+    const unsigned int height = skDepthIrHeight / 2;
+    const size_t pointCount = width * height;
+    const size_t packedSize = width * skDepthIrHeight * 3 / 2;
+
+    IntrinsicParameters intrinsics;
+    intrinsics.cameraMatrix = {370.0f, 0.0f, 320.0f, 0.0f, 370.0f,
+                               240.0f, 0.0f, 0.0f,   1.0f};
+
+    std::mt19937 generator(0);
+    std::uniform_int_distribution<int> distance(0, 4000);
+    std::vector<uint16_t> depth(pointCount);
+    std::vector<uint16_t> ir(pointCount);
+    for (size_t i = 0; i < pointCount; ++i) {
+        depth[i] = static_cast<uint16_t>(distance(generator));
+        ir[i] = static_cast<uint16_t>(distance(generator));
+    }
+
+    // The per-pixel loop the bindings used before the SDK computed the points
+    std::vector<float> xyz(3 * pointCount);
+    run("point_cloud/reference", packedSize, [&]() {
+        const float fx = intrinsics.cameraMatrix[0];
+        const float fy = intrinsics.cameraMatrix[4];
+        const float x0 = intrinsics.cameraMatrix[2];
+        const float y0 = intrinsics.cameraMatrix[5];
+        for (unsigned int i = 0; i < height; ++i) {
+            for (unsigned int j = 0; j < width; ++j) {
+                size_t index = i * width + j;
+                float z = depth[index] / 1000.0f;
+                xyz[3 * index] = z * (j - x0) / fx;
+                xyz[3 * index + 1] = z * (i - y0) / fy;
+                xyz[3 * index + 2] = z;
+            }
+        }
+    });
+
+    PointCloudGenerator pointCloud;
+    pointCloud.setIntrinsics(intrinsics, width, height);
+
+    PointCloudBuffer floatOutput;
+    floatOutput.points = xyz.data();
+    run("point_cloud/float32", packedSize, [&]() {
+        pointCloud.compute(depth.data(), nullptr, floatOutput);
+    });
+
+    std::vector<int16_t> xyz16(3 * pointCount);
+    PointCloudBuffer int16Output;
+    int16Output.format = PointFormat::INT16;
+    int16Output.points = xyz16.data();
+    run("point_cloud/int16", packedSize, [&]() {
+        pointCloud.compute(depth.data(), nullptr, int16Output);
+    });
+
+    // The layout of the ROS PointCloud2 messages: x, y, z, intensity
+    const size_t pointStep = 3 * sizeof(float) + sizeof(uint16_t);
+    std::vector<uint8_t> message(pointStep * pointCount);
+    PointCloudBuffer messageOutput;
+    messageOutput.points = message.data();
+    messageOutput.pointStep = pointStep;
+    messageOutput.intensity =
+        reinterpret_cast<uint16_t *>(message.data() + 3 * sizeof(float));
+    messageOutput.intensityStep = pointStep;
+    run("point_cloud/pointcloud2", packedSize, [&]() {
+        pointCloud.compute(depth.data(), ir.data(), messageOutput);
+    });
+}
+
+static void benchmarkProtobuf() {
+    std::vector<char> packed = packedFrame(skDepthIrWidth, skDepthIrHeight);
+
+    payload::ServerResponse response;
+    response.set_status(payload::Status::OK);
+    response.add_bytes_payload(packed.data(), packed.size());
+
+    std::vector<uint8_t> message(response.ByteSizeLong());
+    run("protobuf/serialize", packed.size(), [&]() {
+        response.SerializeWithCachedSizesToArray(message.data());
+    });
+
+    payload::ServerResponse received;
+    run("protobuf/parse", packed.size(), [&]() {
+        received.ParseFromArray(message.data(),
+                                static_cast<int>(message.size()));
+    });
+}
+
+static void benchmarkCodec() {
+    std::vector<char> packed = packedFrame(skDepthIrWidth, skDepthIrHeight);
+    const uint8_t *source = reinterpret_cast<const uint8_t *>(packed.data());
+
+    std::vector<uint8_t> compressed(
+        compressedFrameBound(packed.size(), skDepthIrWidth));
+    size_t compressedSize = 0;
+    run("codec/compress", packed.size(), [&]() {
+        compressedSize = compressFrame(source, packed.size(), skDepthIrWidth,
+                                       compressed.data());
+    });
+
+    std::vector<uint8_t> decompressed(packed.size());
+    run("codec/decompress", packed.size(), [&]() {
+        decompressFrame(compressed.data(), compressedSize,
+                        decompressed.data());
+    });
+}
+
+int main(int argc, char *argv[]) {
+    google::InitGoogleLogging(argv[0]);
+
+    if (argc > 1) {
+        filter = argv[1];
+    }
+
+    benchmarkDeinterleave();
+    benchmarkCalibration();
+    benchmarkUndistortion();
+    benchmarkFrame();
+    benchmarkFilters();
+    benchmarkPointCloud();
+    benchmarkProtobuf();
+    benchmarkCodec();
+
+    return 0;
+}
@@ -0,0 +1,328 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "device_utils.h"
+
+#include <aditof/device_construction_data.h>
+#include <aditof/device_factory.h>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <glog/logging.h>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace aditof;
+
+static const unsigned int skWidth = 640;
+static const unsigned int skHeight = 960;
+static const unsigned int skRecordedFrames = 8;
+
+//! packedFrame - Builds a packed 12-bit frame with sensor-like content
+static std::vector<char> packedFrame(unsigned int width, unsigned int height,
+                                     unsigned int seed) {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> noise(-8, 8);
+    std::vector<char> frame(width * height * 3 / 2);
+
+    int pixel = 2048;
+    for (size_t i = 0; i + 2 < frame.size(); i += 3) {
+        uint16_t pixels[2];
+        for (uint16_t &value : pixels) {
+            pixel = std::min(std::max(pixel + noise(generator), 0), 4095);
+            value = static_cast<uint16_t>(pixel);
+        }
+        frame[i] = static_cast<char>(pixels[0] >> 4);
+        frame[i + 1] = static_cast<char>(pixels[1] >> 4);
+        frame[i + 2] =
+            static_cast<char>((pixels[0] & 0xF) | ((pixels[1] & 0xF) << 4));
+    }
+
+    return frame;
+}
+
+//! writeRecording - Writes a synthetic recording for the replay device
+/*!
+    \param directory - where the manifest and the frames are written
+    \param fps - the frame rate of the replayed sensor, 0 for no limit
+    \return the path to the manifest
+*/
+static std::string writeRecording(const std::string &directory, double fps) {
+    std::ofstream frames(directory + "/depth_ir.bin", std::ios::binary);
+    for (unsigned int i = 0; i < skRecordedFrames; ++i) {
+        std::vector<char> frame = packedFrame(skWidth, skHeight, i);
+        frames.write(frame.data(), frame.size());
+    }
+
+    std::string manifestPath = directory + "/manifest.txt";
+    std::ofstream manifest(manifestPath);
+    manifest << "sensor 96tof1\n";
+    manifest << "frame_type depth_ir " << skWidth << " " << skHeight
+             << " depth_ir.bin\n";
+    if (fps > 0.0) {
+        manifest << "fps " << fps << "\n";
+    }
+
+    return manifestPath;
+}
+
+//! processCpuTime - CPU time used so far by a process, in seconds
+static double processCpuTime(pid_t pid) {
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    std::getline(stat, line);
+
+    // utime and stime are the 12th and 13th fields after the command name,
+    // which is enclosed in parentheses and may contain spaces
+    size_t end = line.rfind(')');
+    if (end == std::string::npos) {
+        return 0.0;
+    }
+    std::istringstream fields(line.substr(end + 1));
+    std::string field;
+    unsigned long long utime = 0, stime = 0;
+    for (int i = 1; i <= 13 && fields >> field; ++i) {
+        if (i == 12) {
+            utime = std::stoull(field);
+        } else if (i == 13) {
+            stime = std::stoull(field);
+        }
+    }
+
+    return static_cast<double>(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+//! selfCpuTime - CPU time used so far by this process, in seconds
+static double selfCpuTime() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+//! percentile - Value below which the given fraction of the samples fall
+static double percentile(const std::vector<uint64_t> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+
+    return static_cast<double>(sorted[index]);
+}
+
+//! connect - Connects to the server, waiting for it to be up
+static std::unique_ptr<DeviceInterface>
+connect(const std::string &manifestPath, pid_t server) {
+    DeviceConstructionData devData;
+    devData.deviceType = DeviceType::ETHERNET;
+    devData.driverPath = manifestPath;
+    devData.ip = "127.0.0.1";
+
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        int serverStatus;
+        if (waitpid(server, &serverStatus, WNOHANG) == server) {
+            fprintf(stderr, "The server exited\n");
+            return nullptr;
+        }
+
+        std::unique_ptr<DeviceInterface> device =
+            DeviceFactory::buildDevice(devData);
+        if (device && device->open() == Status::OK) {
+            return device;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+
+    fprintf(stderr, "Cannot connect to the server\n");
+    return nullptr;
+}
+
+//! measure - Receives frames from the server and prints the statistics
+static int measure(DeviceInterface &device, pid_t server,
+                   unsigned int frameCount) {
+    using namespace std::chrono;
+
+    FrameDetails details;
+    details.width = skWidth;
+    details.height = skHeight;
+    details.type = "depth_ir";
+    if (device.setFrameType(details) != Status::OK ||
+        device.start() != Status::OK) {
+        fprintf(stderr, "Cannot start the device\n");
+        return 1;
+    }
+
+    std::vector<uint16_t> buffer(skWidth * skHeight);
+    std::vector<uint64_t> latencies;
+    latencies.reserve(frameCount);
+
+    // The first frames include the start of the stream
+    for (int i = 0; i < 10; ++i) {
+        device.getFrame(buffer.data());
+    }
+
+    FrameMetadata metadata;
+    uint32_t firstSequence = 0;
+    uint32_t lastSequence = 0;
+    double serverCpu = processCpuTime(server);
+    double clientCpu = selfCpuTime();
+    auto start = steady_clock::now();
+
+    for (unsigned int i = 0; i < frameCount; ++i) {
+        if (device.getFrame(buffer.data()) != Status::OK) {
+            fprintf(stderr, "Cannot get frame %u\n", i);
+            return 1;
+        }
+        uint64_t received = monotonicTimestamp();
+
+        // The server runs on this machine, so its timestamps are on the same
+        // clock as the ones of the client
+        device.getFrameMetadata(metadata);
+        latencies.push_back(received - metadata.sensorTimestamp);
+        if (i == 0) {
+            firstSequence = metadata.sequence;
+        }
+        lastSequence = metadata.sequence;
+    }
+
+    double seconds =
+        duration_cast<duration<double>>(steady_clock::now() - start).count();
+    serverCpu = processCpuTime(server) - serverCpu;
+    clientCpu = selfCpuTime() - clientCpu;
+
+    device.stop();
+
+    std::sort(latencies.begin(), latencies.end());
+    unsigned int skipped = lastSequence - firstSequence + 1 - frameCount;
+
+    printf("frames          %u (%u skipped by the server)\n", frameCount,
+           skipped);
+    printf("fps             %.1f\n", frameCount / seconds);
+    printf("throughput      %.1f MB/s\n",
+           frameCount * (skWidth * skHeight * 3 / 2) / seconds / 1e6);
+    printf("latency p50     %.2f ms\n", percentile(latencies, 0.50) / 1000);
+    printf("latency p90     %.2f ms\n", percentile(latencies, 0.90) / 1000);
+    printf("latency p99     %.2f ms\n", percentile(latencies, 0.99) / 1000);
+    printf("latency max     %.2f ms\n", latencies.back() / 1000.0);
+    printf("client cpu      %.3f ms/frame\n", clientCpu * 1000 / frameCount);
+    printf("server cpu      %.3f ms/frame\n", serverCpu * 1000 / frameCount);
+
+    return 0;
+}
+
+static void printUsage(const char *name) {
+    printf("Usage: %s [--frames <count>] [--fps <rate>] [--server <path>]\n",
+           name);
+    printf("  --frames <count>  frames to measure (default 300)\n");
+    printf("  --fps <rate>      frame rate of the sensor, 0 for no limit "
+           "(default 30)\n");
+    printf("  --server <path>   the aditof-server to run\n");
+}
+
+int main(int argc, char *argv[]) {
+    google::InitGoogleLogging(argv[0]);
+
+    unsigned int frameCount = 300;
+    double fps = 30.0;
+#ifdef ADITOF_SERVER_PATH
+    std::string serverPath = ADITOF_SERVER_PATH;
+#else
+    std::string serverPath = "aditof-server";
+#endif
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            frameCount = static_cast<unsigned int>(std::atoi(argv[++i]));
+        } else if (arg == "--fps" && i + 1 < argc) {
+            fps = std::atof(argv[++i]);
+        } else if (arg == "--server" && i + 1 < argc) {
+            serverPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (frameCount == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    char directory[] = "/tmp/aditof-network-benchmark-XXXXXX";
+    if (!mkdtemp(directory)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string manifestPath = writeRecording(directory, fps);
+
+    // The server runs in its own process, so that its CPU time is measured
+    // apart from the one of the client
+    pid_t server = fork();
+    if (server == -1) {
+        perror("fork");
+        return 1;
+    }
+    if (server == 0) {
+        execlp(serverPath.c_str(), serverPath.c_str(), "--replay",
+               manifestPath.c_str(), static_cast<char *>(nullptr));
+        perror(serverPath.c_str());
+        _exit(127);
+    }
+
+    int result = 1;
+    {
+        std::unique_ptr<DeviceInterface> device =
+            connect(manifestPath, server);
+        if (device) {
+            result = measure(*device, server, frameCount);
+        }
+    }
+
+    kill(server, SIGTERM);
+    waitpid(server, nullptr, 0);
+
+    unlink(manifestPath.c_str());
+    unlink((std::string(directory) + "/depth_ir.bin").c_str());
+    rmdir(directory);
+
+    return result;
+}
@@ -33,6 +33,7 @@
 #include <aditof/camera_96tof1_specifics.h>
 #include <aditof/device_interface.h>
 #include <aditof/frame.h>
+#include <aditof/point_cloud.h>
 #include <aditof/system.h>
 #include <glog/logging.h>
 
@@ -107,10 +108,6 @@ int main(int argc, char *argv[]) {
     int bitCount = cameraDetails.bitCount;
 
     aditof::IntrinsicParameters intrinsics = cameraDetails.intrinsics;
-    double fx = intrinsics.cameraMatrix.at(0);
-    double fy = intrinsics.cameraMatrix.at(4);
-    double cx = intrinsics.cameraMatrix.at(2);
-    double cy = intrinsics.cameraMatrix.at(5);
 
     /* Enable noise reduction for better results */
     const int smallSignalThreshold = 100;
@@ -131,6 +128,19 @@ int main(int argc, char *argv[]) {
     int frameHeight = static_cast<int>(frameDetails.height) / 2;
     int frameWidth = static_cast<int>(frameDetails.width);
 
+    /* The points are computed by the SDK, in meters */
+    PointCloudGenerator pointCloudGenerator;
+    status = pointCloudGenerator.setIntrinsics(intrinsics, frameWidth,
+                                               frameHeight);
+    if (status != Status::OK) {
+        LOG(ERROR) << "Could not set the intrinsic parameters!";
+        return 0;
+    }
+    std::vector<float> points(3 * frameWidth * frameHeight);
+    PointCloudBuffer pointCloudBuffer;
+    pointCloudBuffer.points = points.data();
+    const float maxPointDepth = 3.0f;
+
     /* Create visualizer for depth and IR images */
     auto visualized_ir_img = std::make_shared<geometry::Image>();
     visualized_ir_img->Prepare(frameWidth, frameHeight, 1, 1);
@@ -155,8 +165,6 @@ int main(int argc, char *argv[]) {
     Eigen::Matrix4d transformation = Eigen::Matrix4d::Identity();
     transformation.block<3, 3>(0, 0) = static_cast<Eigen::Matrix3d>(
         Eigen::AngleAxisd(PI_VALUE, Eigen::Vector3d::UnitX()));
-    camera::PinholeCameraIntrinsic intrinsicParameters(frameWidth, frameHeight,
-                                                       fx, fy, cx, cy);
 
     bool is_window_closed = true;
     while (true) {
@@ -173,12 +181,6 @@ int main(int argc, char *argv[]) {
             LOG(ERROR) << "Could not convert from frame to Image!";
         }
 
-        geometry::Image depth16bits_image;
-        status = fromFrameTo16bitsDepth(frame, depth16bits_image);
-        if (status != Status::OK) {
-            LOG(ERROR) << "Could not convert from frame to Image!";
-        }
-
         geometry::Image ir_image;
         status = fromFrameToIRImg(frame, bitCount, ir_image);
         if (status != Status::OK) {
@@ -231,11 +233,25 @@ int main(int argc, char *argv[]) {
         depth_vis.UpdateRender();
 
         /* create and show pointcloud */
-        auto rgbd_ptr = geometry::RGBDImage::CreateFromColorAndDepth(
-            color_image, depth16bits_image, 1000.0, 3.0, false);
+        status = pointCloudGenerator.compute(frame, pointCloudBuffer);
+        if (status != Status::OK) {
+            LOG(ERROR) << "Could not compute the pointcloud!";
+        }
+
+        auto temp = std::make_shared<geometry::PointCloud>();
+        for (int i = 0; i < frameHeight * frameWidth; i++) {
+            const float *point = &points[3 * i];
+            if (point[2] == 0.0f || point[2] > maxPointDepth) {
+                continue;
+            }
+            temp->points_.emplace_back(point[0], point[1], point[2]);
+            temp->colors_.emplace_back(color_image.data_[3 * i] / 255.0,
+                                       color_image.data_[3 * i + 1] / 255.0,
+                                       color_image.data_[3 * i + 2] / 255.0);
+        }
+
         if (!pointcloud_ptr) {
-            pointcloud_ptr = geometry::PointCloud::CreateFromRGBDImage(
-                *rgbd_ptr, intrinsicParameters);
+            pointcloud_ptr = temp;
 
             auto bounding_box = pointcloud_ptr->GetAxisAlignedBoundingBox();
             Eigen::Matrix4d trans_to_origin = Eigen::Matrix4d::Identity();
@@ -244,9 +260,6 @@ int main(int argc, char *argv[]) {
             pointcloud_ptr->Transform(trans_to_origin.inverse() *
                                       transformation * trans_to_origin);
         } else {
-            auto temp = geometry::PointCloud::CreateFromRGBDImage(
-                *rgbd_ptr, intrinsicParameters);
-
             auto bounding_box = temp->GetAxisAlignedBoundingBox();
             Eigen::Matrix4d trans_to_origin = Eigen::Matrix4d::Identity();
             trans_to_origin.block<3, 1>(0, 3) = bounding_box.GetCenter() * -1.0;
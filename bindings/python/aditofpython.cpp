@@ -66,6 +66,19 @@ PYBIND11_MODULE(aditofpython, m) {
         .def_readwrite("height", &aditof::FrameDetails::height)
         .def_readwrite("type", &aditof::FrameDetails::type);
 
+    py::class_<aditof::FrameMetadata>(m, "FrameMetadata")
+        .def(py::init<>())
+        .def_readwrite("sequence", &aditof::FrameMetadata::sequence)
+        .def_readwrite("sensorTimestamp",
+                       &aditof::FrameMetadata::sensorTimestamp)
+        .def_readwrite("dequeueTimestamp",
+                       &aditof::FrameMetadata::dequeueTimestamp)
+        .def_readwrite("readyTimestamp", &aditof::FrameMetadata::readyTimestamp)
+        .def_readwrite("transferTime", &aditof::FrameMetadata::transferTime)
+        .def_readwrite("unpackTime", &aditof::FrameMetadata::unpackTime)
+        .def_readwrite("calibrationTime",
+                       &aditof::FrameMetadata::calibrationTime);
+
     // Camera declarations
 
     py::enum_<aditof::ConnectionType>(m, "ConnectionType")
@@ -77,6 +90,10 @@ PYBIND11_MODULE(aditofpython, m) {
         .value("RevB", aditof::Revision::RevB)
         .value("RevC", aditof::Revision::RevC);
 
+    py::enum_<aditof::DepthInterpolation>(m, "DepthInterpolation")
+        .value("Nearest", aditof::DepthInterpolation::NEAREST)
+        .value("EdgeAware", aditof::DepthInterpolation::EDGE_AWARE);
+
     py::class_<aditof::IntrinsicParameters>(m, "IntrinsicParameters")
         .def(py::init<>())
         .def_readwrite("cameraMatrix",
@@ -143,7 +160,20 @@ PYBIND11_MODULE(aditofpython, m) {
 
                  return status;
              },
-             py::arg("cameras"), py::arg("ip"));
+             py::arg("cameras"), py::arg("ip"))
+        .def("getCameraListFromReplay",
+             [](aditof::System &system, py::list cameras, py::str manifest) {
+                 std::vector<std::shared_ptr<aditof::Camera>> cameraList;
+                 aditof::Status status =
+                     system.getCameraListFromReplay(cameraList, manifest);
+
+                 for (const auto &cam : cameraList) {
+                     cameras.append(cam);
+                 }
+
+                 return status;
+             },
+             py::arg("cameras"), py::arg("manifest"));
 
     py::class_<aditof::Camera, std::shared_ptr<aditof::Camera>>(m, "Camera")
         .def("initialize", &aditof::Camera::initialize)
@@ -200,6 +230,8 @@ PYBIND11_MODULE(aditofpython, m) {
         .def(py::init<>())
         .def("setDetails", &aditof::Frame::setDetails, py::arg("details"))
         .def("getDetails", &aditof::Frame::getDetails, py::arg("details"))
+        .def("setMetadata", &aditof::Frame::setMetadata, py::arg("metadata"))
+        .def("getMetadata", &aditof::Frame::getMetadata, py::arg("metadata"))
         .def("getData",
              [](aditof::Frame &frame,
                 aditof::FrameDataType dataType) -> frameData {
@@ -212,6 +244,78 @@ PYBIND11_MODULE(aditofpython, m) {
              },
              py::arg("dataType"));
 
+    // Recordings
+
+    py::class_<aditof::RecordedFrameInfo>(m, "RecordedFrameInfo")
+        .def(py::init<>())
+        .def_readwrite("metadata", &aditof::RecordedFrameInfo::metadata)
+        .def_readwrite("afeTemperature",
+                       &aditof::RecordedFrameInfo::afeTemperature)
+        .def_readwrite("laserTemperature",
+                       &aditof::RecordedFrameInfo::laserTemperature);
+
+    py::class_<aditof::RecordingWriter>(m, "RecordingWriter")
+        .def(py::init<>())
+        .def("open", &aditof::RecordingWriter::open, py::arg("fileName"),
+             py::arg("details"), py::arg("fps"))
+        .def("writeFrame", &aditof::RecordingWriter::writeFrame,
+             py::arg("frame"), py::arg("afeTemperature"),
+             py::arg("laserTemperature"))
+        .def("close", &aditof::RecordingWriter::close)
+        .def("isOpen", &aditof::RecordingWriter::isOpen)
+        .def("getFrameCount", &aditof::RecordingWriter::getFrameCount)
+        .def("getDroppedFrameCount",
+             &aditof::RecordingWriter::getDroppedFrameCount);
+
+    py::class_<aditof::RecordingReader>(m, "RecordingReader")
+        .def(py::init<>())
+        .def("open", &aditof::RecordingReader::open, py::arg("fileName"))
+        .def("close", &aditof::RecordingReader::close)
+        .def("isOpen", &aditof::RecordingReader::isOpen)
+        .def("getCameraDetails", &aditof::RecordingReader::getCameraDetails,
+             py::arg("details"))
+        .def("getFps", &aditof::RecordingReader::getFps)
+        .def("getFrameCount", &aditof::RecordingReader::getFrameCount)
+        .def("getFrameInfo", &aditof::RecordingReader::getFrameInfo,
+             py::arg("index"), py::arg("info"))
+        .def("readFrame", &aditof::RecordingReader::readFrame,
+             py::arg("index"), py::arg("frame"));
+
+    // Point clouds
+
+    py::class_<aditof::PointCloudGenerator>(m, "PointCloudGenerator")
+        .def(py::init<>())
+        .def("setIntrinsics", &aditof::PointCloudGenerator::setIntrinsics,
+             py::arg("intrinsics"), py::arg("width"), py::arg("height"))
+        .def("getPointCount", &aditof::PointCloudGenerator::getPointCount)
+        .def("compute",
+             [](aditof::PointCloudGenerator &generator, aditof::Frame &frame,
+                py::array points) {
+                 // float32 points are in meters, int16 points in millimeters
+                 py::buffer_info buffInfo = points.request(true);
+                 aditof::PointCloudBuffer output;
+
+                 const std::string &format = buffInfo.format;
+                 if (format == py::format_descriptor<float>::format()) {
+                     output.format = aditof::PointFormat::FLOAT32;
+                 } else if (format ==
+                            py::format_descriptor<int16_t>::format()) {
+                     output.format = aditof::PointFormat::INT16;
+                 } else {
+                     return aditof::Status::INVALID_ARGUMENT;
+                 }
+
+                 if (!(points.flags() & py::array::c_style) ||
+                     static_cast<size_t>(buffInfo.size) <
+                         3 * generator.getPointCount()) {
+                     return aditof::Status::INVALID_ARGUMENT;
+                 }
+
+                 output.points = buffInfo.ptr;
+                 return generator.compute(frame, output);
+             },
+             py::arg("frame"), py::arg("points"));
+
     py::class_<aditof::DeviceInterface,
                std::shared_ptr<aditof::DeviceInterface>>(m, "DeviceInterface")
         .def("open", &aditof::DeviceInterface::open)
@@ -248,6 +352,8 @@ PYBIND11_MODULE(aditofpython, m) {
                  return device.getFrame(ptr);
              },
              py::arg("buffer"))
+        .def("getFrameMetadata", &aditof::DeviceInterface::getFrameMetadata,
+             py::arg("metadata"))
         .def("readEeprom",
              [](aditof::DeviceInterface &device, uint32_t address,
                 py::array_t<uint8_t> data, size_t length) {
@@ -321,7 +427,17 @@ PYBIND11_MODULE(aditofpython, m) {
         .def("setCameraRevision",
              &aditof::Camera96Tof1Specifics::setCameraRevision,
              py::arg("revision"))
-        .def("getRevision", &aditof::Camera96Tof1Specifics::getRevision);
+        .def("getRevision", &aditof::Camera96Tof1Specifics::getRevision)
+        .def("enableUndistortion",
+             &aditof::Camera96Tof1Specifics::enableUndistortion,
+             py::arg("en"))
+        .def("undistortionEnabled",
+             &aditof::Camera96Tof1Specifics::undistortionEnabled)
+        .def("setDepthInterpolation",
+             &aditof::Camera96Tof1Specifics::setDepthInterpolation,
+             py::arg("interpolation"))
+        .def("depthInterpolation",
+             &aditof::Camera96Tof1Specifics::depthInterpolation);
 
     py::class_<aditof::CameraChiconySpecifics,
                std::shared_ptr<aditof::CameraChiconySpecifics>>(
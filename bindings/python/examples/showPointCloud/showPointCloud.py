@@ -105,11 +105,13 @@ if __name__ == "__main__":
 
     # Get intrinsic parameters from camera
     intrinsicParameters = camDetails.intrinsics
-    fx = intrinsicParameters.cameraMatrix[0]
-    fy = intrinsicParameters.cameraMatrix[4]
-    cx = intrinsicParameters.cameraMatrix[2]
-    cy = intrinsicParameters.cameraMatrix[5]
-    cameraIntrinsics = o3d.camera.PinholeCameraIntrinsic(width, height, fx, fy, cx, cy)
+
+    # The SDK computes the points, in meters
+    pointCloudGenerator = tof.PointCloudGenerator()
+    status = pointCloudGenerator.setIntrinsics(intrinsicParameters, width, height)
+    if not status:
+        print("pointCloudGenerator.setIntrinsics() failed with status: ", status)
+    points = np.zeros((width * height, 3), dtype="float32")
 
     # Get camera details for frame correction
     camera_range = camDetails.maxDepth
@@ -152,7 +154,7 @@ if __name__ == "__main__":
 
         # Create the Depth image
         new_shape = (int(depth_map.shape[0] / 2), depth_map.shape[1])
-        depth16bits_map = depth_map = np.resize(depth_map, new_shape)
+        depth_map = np.resize(depth_map, new_shape)
         depth_map = distance_scale * depth_map
         depth_map = np.uint8(depth_map)
         depth_map = cv.applyColorMap(depth_map, cv.COLORMAP_RAINBOW)
@@ -164,11 +166,15 @@ if __name__ == "__main__":
         # Create color image
         img_color = cv.addWeighted(ir_map, 0.4, depth_map, 0.6, 0)
 
-        color_image = o3d.geometry.Image(img_color)
-        depth16bits_image = o3d.geometry.Image(depth16bits_map)
-
-        rgbd_image = o3d.geometry.RGBDImage.create_from_color_and_depth(color_image, depth16bits_image, 1000.0, 3.0, False)
-        pcd = o3d.geometry.PointCloud.create_from_rgbd_image(rgbd_image, cameraIntrinsics)
+        # Create the point cloud, without the points that have no depth or are
+        # further than 3 meters
+        status = pointCloudGenerator.compute(frame, points)
+        if not status:
+            print("pointCloudGenerator.compute() failed with status: ", status)
+        valid = (points[:, 2] > 0) & (points[:, 2] <= 3.0)
+        pcd = o3d.geometry.PointCloud()
+        pcd.points = o3d.utility.Vector3dVector(points[valid])
+        pcd.colors = o3d.utility.Vector3dVector(img_color.reshape(-1, 3)[valid] / 255.0)
 
         # Flip it, otherwise the point cloud will be upside down
         pcd.transform([[1, 0, 0, 0], [0, -1, 0, 0], [0, 0, -1, 0], [0, 0, 0, 1]])
@@ -33,6 +33,7 @@
 #define POINTCLOUD2_MSG_H
 
 #include <aditof/frame.h>
+#include <aditof/point_cloud.h>
 
 #include "aditof_sensor_msg.h"
 #include "aditof_utils.h"
@@ -71,6 +72,9 @@ class PointCloud2Msg : public AditofSensorMsg {
 
   private:
     PointCloud2Msg();
+
+    // Keeps the rays of the pixels from one frame to the next
+    aditof::PointCloudGenerator m_pointCloud;
 };
 
 #endif // POINTCLOUD2_MSG_H
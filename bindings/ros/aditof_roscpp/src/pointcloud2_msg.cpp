@@ -74,38 +74,31 @@ void PointCloud2Msg::setDataMembers(const std::shared_ptr<Camera> &camera,
                                     aditof::Frame *frame) {
     IntrinsicParameters intr = getIntrinsics(camera);
 
-    float fx = intr.cameraMatrix[0];
-    float fy = intr.cameraMatrix[4];
-    float x0 = intr.cameraMatrix[2];
-    float y0 = intr.cameraMatrix[5];
-
-    sensor_msgs::PointCloud2Iterator<float> iter_x(msg, "x");
-    sensor_msgs::PointCloud2Iterator<float> iter_y(msg, "y");
-    sensor_msgs::PointCloud2Iterator<float> iter_z(msg, "z");
-    sensor_msgs::PointCloud2Iterator<uint16_t> iter_intensity(msg, "intensity");
-
     const int frameHeight = static_cast<int>(msg.height);
     const int frameWidth = static_cast<int>(msg.width);
 
-    uint16_t *frameDataDepth =
-        getFrameData(frame, aditof::FrameDataType::DEPTH);
-    uint16_t *frameDataIR = getFrameData(frame, aditof::FrameDataType::IR);
+    // Only computes the rays when the intrinsics or the size change
+    if (m_pointCloud.setIntrinsics(intr, msg.width, msg.height) !=
+        Status::OK) {
+        ROS_ERROR("Invalid intrinsic parameters");
+        return;
+    }
 
+    uint16_t *frameDataIR = getFrameData(frame, aditof::FrameDataType::IR);
     irTo16bitGrayscale(frameDataIR, frameWidth, frameHeight);
 
-    for (int i = 0; i < frameHeight; i++) {
-        for (int j = 0; j < frameWidth;
-             j++, ++iter_x, ++iter_y, ++iter_z, ++iter_intensity) {
-            int index = i * msg.width + j;
-            float z = static_cast<float>(frameDataDepth[index]) / 1000.0f;
-
-            *iter_x = z * (j - x0) / fx;
-            *iter_y = z * (i - y0) / fy;
-            *iter_z = z;
-
-            *iter_intensity = frameDataIR[index];
-        }
-    }
+    // x, y, z are the first fields of a point, the intensity comes after
+    PointCloudBuffer output;
+    output.format = PointFormat::FLOAT32;
+    output.points = msg.data.data();
+    output.pointStep = msg.point_step;
+    size_t intensityOffset =
+        3 * sizeOfPointField(sensor_msgs::PointField::FLOAT32);
+    output.intensity =
+        reinterpret_cast<uint16_t *>(msg.data.data() + intensityOffset);
+    output.intensityStep = msg.point_step;
+
+    m_pointCloud.compute(*frame, output);
 }
 
 void PointCloud2Msg::publishMsg(const ros::Publisher &pub) { pub.publish(msg); }
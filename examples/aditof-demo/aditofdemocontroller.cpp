@@ -36,8 +36,14 @@
 #include <glog/logging.h>
 #include <iostream>
 
+static const size_t skFramePoolSize = 4;
+static const size_t skDisplayQueueSize = 2;
+
 AdiTofDemoController::AdiTofDemoController()
-    : m_cameraInUse(-1), m_frameRequested(false),
+    : m_cameraInUse(-1),
+      m_queue(skDisplayQueueSize, aditof::OverflowPolicy::DROP_OLDEST),
+      m_framePool({0, 0, ""}, skFramePoolSize),
+      m_frameRequested(false),
       m_recorder(new AditofDemoRecorder()) {
     m_system = new aditof::System();
     m_system->initialize();
@@ -225,10 +231,15 @@ aditof::Status AdiTofDemoController::readAFEregister(uint16_t *address,
 }
 
 void AdiTofDemoController::startRecording(const std::string &fileName,
-                                          unsigned int height,
-                                          unsigned int width,
                                           unsigned int fps) {
-    m_recorder->startRecording(fileName, height, width, fps);
+    if (m_cameraInUse == -1) {
+        return;
+    }
+
+    aditof::CameraDetails cameraDetails;
+    m_cameras[static_cast<unsigned int>(m_cameraInUse)]->getDetails(
+        cameraDetails);
+    m_recorder->startRecording(fileName, cameraDetails, fps);
 }
 
 void AdiTofDemoController::stopRecording() { m_recorder->stopRecording(); }
@@ -247,7 +258,9 @@ std::shared_ptr<aditof::Frame> AdiTofDemoController::getFrame() {
     if (m_recorder->isPlaybackEnabled()) {
         return m_recorder->readNewFrame();
     }
-    return m_queue.dequeue();
+    std::shared_ptr<aditof::Frame> frame;
+    m_queue.pop(frame);
+    return frame;
 }
 
 void AdiTofDemoController::requestFrame() {
@@ -273,7 +286,11 @@ void AdiTofDemoController::captureFrames() {
         }
 
         auto camera = m_cameras[static_cast<unsigned int>(m_cameraInUse)];
-        auto frame = std::make_shared<aditof::Frame>();
+        aditof::CameraDetails cameraDetails;
+        camera->getDetails(cameraDetails);
+        m_framePool.setDetails(cameraDetails.frameType);
+
+        auto frame = m_framePool.acquire();
         aditof::Status status = camera->requestFrame(frame.get());
         if (status != aditof::Status::OK) {
             m_frameRequested = false;
@@ -281,10 +298,17 @@ void AdiTofDemoController::captureFrames() {
         }
 
         if (m_recorder->isRecordingEnabled()) {
-            m_recorder->recordNewFrame(frame);
+            // The temperatures are stored with the frames, but reading them
+            // for every frame would slow down the capture
+            auto now = std::chrono::steady_clock::now();
+            if (now - m_lastTemperatureRead >= std::chrono::seconds(1)) {
+                m_temperature = getTemperature();
+                m_lastTemperatureRead = now;
+            }
+            m_recorder->recordNewFrame(frame, m_temperature);
         }
 
-        m_queue.enqueue(frame);
+        m_queue.push(frame);
         m_frameRequested = false;
     }
 }
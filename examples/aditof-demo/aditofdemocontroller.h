@@ -35,15 +35,19 @@
 #include <aditof/camera.h>
 #include <aditof/device_interface.h>
 #include <aditof/frame.h>
+#include <aditof/frame_pool.h>
+#include <aditof/ring_buffer.h>
 #include <aditof/system.h>
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 #include "aditofdemorecorder.h"
-#include "safequeue.h"
 
 class AdiTofDemoController {
 
@@ -64,8 +68,7 @@ class AdiTofDemoController {
     aditof::Status readAFEregister(uint16_t *address, uint16_t *data,
                                    uint16_t noOfEntries = 1);
 
-    void startRecording(const std::string &fileName, unsigned int height,
-                        unsigned int width, unsigned int fps);
+    void startRecording(const std::string &fileName, unsigned int fps);
     void stopRecording();
     int startPlayback(const std::string &fileName, int &fps);
     void stopPlayback();
@@ -102,13 +105,17 @@ class AdiTofDemoController {
     int m_cameraInUse;
     std::thread m_workerThread;
     std::atomic<bool> m_stopFlag;
-    SafeQueue<std::shared_ptr<aditof::Frame>> m_queue;
+    // Only the latest frames are kept if the display falls behind
+    aditof::RingBuffer<std::shared_ptr<aditof::Frame>> m_queue;
+    aditof::FramePool m_framePool;
     std::mutex m_mutex;
     std::mutex m_requestMutex;
     std::condition_variable m_requestCv;
     bool m_frameRequested;
 
     std::unique_ptr<AditofDemoRecorder> m_recorder;
+    std::pair<float, float> m_temperature;
+    std::chrono::steady_clock::time_point m_lastTemperatureRead;
 
     bool m_IsEthernetConnection = false;
 };
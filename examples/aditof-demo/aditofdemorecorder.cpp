@@ -32,50 +32,90 @@
 #include "aditofdemorecorder.h"
 
 #include <functional>
+#include <glog/logging.h>
 #include <string.h>
 
+static const size_t skPlaybackQueueSize = 2;
+static const size_t skRecordQueueSize = 8;
+
 AditofDemoRecorder::AditofDemoRecorder()
-    : m_frameDetails{0, 0, ""}, m_recordTreadStop(true),
+    : m_playbackQueue(skPlaybackQueueSize, aditof::OverflowPolicy::BLOCK),
+      m_recordQueue(skRecordQueueSize, aditof::OverflowPolicy::DROP_NEWEST),
+      m_playbackIndex(0), m_frameDetails{0, 0, ""},
+      m_framePool(m_frameDetails, 0), m_recordStop(true),
       m_playbackThreadStop(true), m_shouldReadNewFrame(true),
       m_playBackEofReached(false), m_numberOfFrames(0) {}
 
 AditofDemoRecorder::~AditofDemoRecorder() {
-    if (m_recordFile.is_open()) {
+    if (m_recordWriter.isOpen()) {
         stopRecording();
     }
-    if (m_playbackFile.is_open()) {
+    if (m_playbackReader.isOpen() || m_playbackFile.is_open()) {
         stopPlayback();
     }
 }
 
-void AditofDemoRecorder::startRecording(const std::string &fileName,
-                                        unsigned int height, unsigned int width,
-                                        unsigned int fps) {
-    m_recordFile.open(fileName, std::ios::binary);
-    m_recordFile.write(reinterpret_cast<const char *>(&height),
-                       sizeof(unsigned int));
-    m_recordFile.write(reinterpret_cast<const char *>(&width),
-                       sizeof(unsigned int));
-    m_recordFile.write(reinterpret_cast<const char *>(&fps),
-                       sizeof(unsigned int));
+void AditofDemoRecorder::startRecording(
+    const std::string &fileName, const aditof::CameraDetails &cameraDetails,
+    unsigned int fps) {
+    if (m_recordWriter.open(fileName, cameraDetails, fps) !=
+        aditof::Status::OK) {
+        return;
+    }
 
-    m_frameDetails.height = height;
-    m_frameDetails.width = width;
+    // Frames pushed while the previous recording was being stopped
+    RecordedFrame stale;
+    while (m_recordQueue.tryPop(stale)) {
+    }
+    m_recordQueue.reopen();
 
-    m_recordTreadStop = false;
+    m_recordStop = false;
     m_recordThread =
         std::thread(std::bind(&AditofDemoRecorder::recordThread, this));
 }
 
 void AditofDemoRecorder::stopRecording() {
-    m_recordTreadStop = true;
+    m_recordStop = true;
+    m_recordQueue.close();
     if (m_recordThread.joinable()) {
         m_recordThread.join();
     }
-    m_recordFile.close();
+    if (m_recordQueue.droppedCount() > 0) {
+        LOG(WARNING) << m_recordQueue.droppedCount()
+                     << " frames were not recorded because the record "
+                        "thread could not keep up";
+    }
+    m_recordWriter.close();
 }
 
 int AditofDemoRecorder::startPlayback(const std::string &fileName, int &fps) {
+    if (m_playbackReader.open(fileName) == aditof::Status::OK) {
+        aditof::CameraDetails cameraDetails;
+        m_playbackReader.getCameraDetails(cameraDetails);
+        fps = static_cast<int>(m_playbackReader.getFps());
+        m_playbackIndex = 0;
+        m_numberOfFrames = static_cast<int>(m_playbackReader.getFrameCount());
+        m_frameDetails = cameraDetails.frameType;
+    } else {
+        startLegacyPlayback(fileName, fps);
+    }
+    m_framePool.setDetails(m_frameDetails);
+
+    std::shared_ptr<aditof::Frame> stale;
+    while (m_playbackQueue.tryPop(stale)) {
+    }
+    m_playbackQueue.reopen();
+
+    m_playbackThreadStop = false;
+    m_playBackEofReached = false;
+    m_playbackThread =
+        std::thread(std::bind(&AditofDemoRecorder::playbackThread, this));
+
+    return m_numberOfFrames;
+}
+
+void AditofDemoRecorder::startLegacyPlayback(const std::string &fileName,
+                                             int &fps) {
     unsigned int height = 0;
     unsigned int width = 0;
 
@@ -96,17 +136,11 @@ int AditofDemoRecorder::startPlayback(const std::string &fileName, int &fps) {
 
     m_frameDetails.height = height;
     m_frameDetails.width = width;
-
-    m_playbackThreadStop = false;
-    m_playBackEofReached = false;
-    m_playbackThread =
-        std::thread(std::bind(&AditofDemoRecorder::playbackThread, this));
-
-    return m_numberOfFrames;
 }
 
 void AditofDemoRecorder::stopPlayback() {
     m_playbackThreadStop = true;
+    m_playbackQueue.close();
     std::unique_lock<std::mutex> lock(m_playbackMutex);
     m_shouldReadNewFrame = true;
     lock.unlock();
@@ -114,15 +148,23 @@ void AditofDemoRecorder::stopPlayback() {
     if (m_playbackThread.joinable()) {
         m_playbackThread.join();
     }
+    m_playbackReader.close();
     m_playbackFile.close();
 }
 
-void AditofDemoRecorder::recordNewFrame(std::shared_ptr<aditof::Frame> frame) {
-    m_recordQueue.enqueue(frame);
+void AditofDemoRecorder::recordNewFrame(
+    std::shared_ptr<aditof::Frame> frame,
+    const std::pair<float, float> &temperature) {
+    if (m_recordStop) {
+        return;
+    }
+    m_recordQueue.push({frame, temperature});
 }
 
 std::shared_ptr<aditof::Frame> AditofDemoRecorder::readNewFrame() {
-    return m_playbackQueue.dequeue();
+    std::shared_ptr<aditof::Frame> frame;
+    m_playbackQueue.pop(frame);
+    return frame;
 }
 
 void AditofDemoRecorder::requestFrame() {
@@ -133,7 +175,7 @@ void AditofDemoRecorder::requestFrame() {
 }
 
 bool AditofDemoRecorder::isRecordingEnabled() const {
-    return !m_recordTreadStop;
+    return !m_recordStop;
 }
 
 bool AditofDemoRecorder::isPlaybackEnabled() const {
@@ -147,34 +189,21 @@ bool AditofDemoRecorder::isPlaybackFinished() const {
 int AditofDemoRecorder::getNumberOfFrames() const { return m_numberOfFrames; }
 
 void AditofDemoRecorder::recordThread() {
-    while (!m_recordTreadStop) {
-
-        if (!m_recordFile.is_open()) {
-            break;
-        }
-
-        if (m_recordQueue.empty()) {
-            continue;
-        }
-
-        auto frame = m_recordQueue.dequeue();
-
-        uint16_t *data;
-        frame->getData(aditof::FrameDataType::RAW, &data);
-
-        unsigned int width = m_frameDetails.width;
-        unsigned int height = m_frameDetails.height;
-
-        int size = static_cast<int>(sizeof(uint16_t) * width * height);
-
-        m_recordFile.write(reinterpret_cast<const char *>(data), size);
+    RecordedFrame recorded;
+
+    // pop() keeps returning the queued frames after the queue is closed, so
+    // everything captured before stopRecording() is written
+    while (m_recordQueue.pop(recorded)) {
+        m_recordWriter.writeFrame(*recorded.frame, recorded.temperature.first,
+                                  recorded.temperature.second);
+        recorded.frame.reset();
     }
 }
 
 void AditofDemoRecorder::playbackThread() {
     while (!m_playbackThreadStop) {
 
-        if (!m_playbackFile.is_open()) {
+        if (!m_playbackReader.isOpen() && !m_playbackFile.is_open()) {
             break;
         }
 
@@ -186,10 +215,7 @@ void AditofDemoRecorder::playbackThread() {
             break;
         }
 
-        std::shared_ptr<aditof::Frame> frame =
-            std::make_shared<aditof::Frame>();
-        ;
-        frame->setDetails(m_frameDetails);
+        std::shared_ptr<aditof::Frame> frame = m_framePool.acquire();
 
         uint16_t *frameDataLocation;
         frame->getData(aditof::FrameDataType::RAW, &frameDataLocation);
@@ -197,7 +223,15 @@ void AditofDemoRecorder::playbackThread() {
         unsigned int width = m_frameDetails.width;
         unsigned int height = m_frameDetails.height;
 
-        if (m_playbackFile.eof()) {
+        if (m_playbackReader.isOpen()) {
+            if (m_playbackIndex < m_playbackReader.getFrameCount()) {
+                m_playbackReader.readFrame(m_playbackIndex++, *frame);
+            } else {
+                memset(frameDataLocation, 0,
+                       sizeof(uint16_t) * width * height);
+                m_playBackEofReached = true;
+            }
+        } else if (m_playbackFile.eof()) {
             memset(frameDataLocation, 0, sizeof(uint16_t) * width * height);
             m_playBackEofReached = true;
         } else {
@@ -206,6 +240,6 @@ void AditofDemoRecorder::playbackThread() {
                                 size);
         }
 
-        m_playbackQueue.enqueue(frame);
+        m_playbackQueue.push(frame);
     }
 }
@@ -31,27 +31,33 @@
  */
 #ifndef ADITOFDEMORECORDER_H
 #define ADITOFDEMORECORDER_H
+#include <aditof/camera_definitions.h>
 #include <aditof/frame.h>
+#include <aditof/frame_pool.h>
+#include <aditof/recording.h>
+#include <aditof/ring_buffer.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
 #include <thread>
 
-#include "safequeue.h"
-
 class AditofDemoRecorder {
   public:
     AditofDemoRecorder();
     ~AditofDemoRecorder();
 
-    void startRecording(const std::string &fileName, unsigned int height,
-                        unsigned int width, unsigned int fps);
+    void startRecording(const std::string &fileName,
+                        const aditof::CameraDetails &cameraDetails,
+                        unsigned int fps);
     void stopRecording();
 
     int startPlayback(const std::string &fileName, int &fps);
     void stopPlayback();
 
-    void recordNewFrame(std::shared_ptr<aditof::Frame> frame);
+    void recordNewFrame(std::shared_ptr<aditof::Frame> frame,
+                        const std::pair<float, float> &temperature);
     std::shared_ptr<aditof::Frame> readNewFrame();
 
     void requestFrame();
@@ -64,21 +70,35 @@ class AditofDemoRecorder {
     int getNumberOfFrames() const;
 
   private:
+    void startLegacyPlayback(const std::string &fileName, int &fps);
     void recordThread();
     void playbackThread();
 
   private:
-    SafeQueue<std::shared_ptr<aditof::Frame>> m_recordQueue;
-    SafeQueue<std::shared_ptr<aditof::Frame>> m_playbackQueue;
+    struct RecordedFrame {
+        std::shared_ptr<aditof::Frame> frame;
+        std::pair<float, float> temperature;
+    };
+
+  private:
+    aditof::RingBuffer<std::shared_ptr<aditof::Frame>> m_playbackQueue;
 
-    std::ofstream m_recordFile;
+    // Frames are handed from the capture thread to the record thread, which
+    // hands them to the I/O thread of the writer. If the disk can't keep up
+    // the new frames are dropped instead of stalling the capture.
+    aditof::RingBuffer<RecordedFrame> m_recordQueue;
+    aditof::RecordingWriter m_recordWriter;
+    std::thread m_recordThread;
+    aditof::RecordingReader m_playbackReader;
+    size_t m_playbackIndex;
+    // Recordings made before the recording format was introduced
     std::ifstream m_playbackFile;
 
     aditof::FrameDetails m_frameDetails;
+    aditof::FramePool m_framePool;
 
-    std::thread m_recordThread;
     std::thread m_playbackThread;
-    std::atomic<bool> m_recordTreadStop;
+    std::atomic<bool> m_recordStop;
     std::atomic<bool> m_playbackThreadStop;
     bool m_shouldReadNewFrame;
     std::mutex m_playbackMutex;
@@ -205,8 +205,6 @@ void AdiTofDemoView::render() {
     bool recordEnabled = false;
     bool playbackEnabled = false;
 
-    unsigned int frameHeight = 0;
-    unsigned int frameWidth = 0;
 
     int numberOfFrames = 0;
 
@@ -458,8 +456,7 @@ void AdiTofDemoView::render() {
                     oldStatus = status;
                     status = "Recording into " + fileName;
                     m_ctrl->startRecording(
-                        fileName, frameHeight, frameWidth,
-                        static_cast<unsigned int>(displayFps));
+                        fileName, static_cast<unsigned int>(displayFps));
                 } else {
                     m_ctrl->stopRecording();
                     status = oldStatus;
@@ -778,11 +775,6 @@ void AdiTofDemoView::render() {
             } else if (!captureBlendedEnabled) {
                 m_capturedFrame = m_ctrl->getFrame();
 
-                aditof::FrameDetails frameDetails;
-                m_capturedFrame->getDetails(frameDetails);
-                frameWidth = frameDetails.width;
-                frameHeight = frameDetails.height;
-
                 std::unique_lock<std::mutex> lock(m_frameCapturedMutex);
                 m_depthFrameAvailable = true;
                 m_irFrameAvailable = true;
@@ -794,11 +786,6 @@ void AdiTofDemoView::render() {
 
         if (captureBlendedEnabled) {
             m_capturedFrame = m_ctrl->getFrame();
-
-            aditof::FrameDetails frameDetails;
-            m_capturedFrame->getDetails(frameDetails);
-            frameWidth = frameDetails.width;
-            frameHeight = frameDetails.height;
             m_ctrl->requestFrame();
         }
 
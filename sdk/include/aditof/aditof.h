@@ -34,7 +34,12 @@
 #include <aditof/device_interface.h>
 #include <aditof/frame.h>
 #include <aditof/frame_definitions.h>
+#include <aditof/frame_lease.h>
 #include <aditof/frame_operations.h>
+#include <aditof/frame_pool.h>
+#include <aditof/point_cloud.h>
+#include <aditof/recording.h>
+#include <aditof/ring_buffer.h>
 #include <aditof/status_definitions.h>
 #include <aditof/system.h>
 #include <aditof/version.h>
@@ -0,0 +1,146 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef BILATERAL_FILTER_H
+#define BILATERAL_FILTER_H
+
+#include <aditof/frame_processor.h>
+#include <aditof/sdk_exports.h>
+
+#include <memory>
+#include <stdint.h>
+
+class BilateralFilterImpl;
+
+namespace aditof {
+
+/**
+ * @class BilateralFilter
+ * @brief Smooths depth while keeping edges: each pixel becomes the average
+ * of the pixels of a 3x3 or 5x5 window around it, weighted by their distance
+ * to it (a Gaussian of spatialSigma pixels) and by how close their depth is
+ * to its depth. The noise of time of flight grows with the distance, so the
+ * range Gaussian has a standard deviation of rangeSigma times the depth of
+ * the pixel, and pixels more than 3 of them away are ignored.
+ *
+ * Pixels without depth (0) or saturated (maxDepth and above) are left as
+ * they are and are not averaged with their neighbors. The rows are split
+ * between the cores of the machine. The methods must not be called from
+ * several threads at once.
+ */
+class SDK_API BilateralFilter : public FrameProcessor {
+  public:
+    /**
+     * @brief Constructor, with a spatial sigma of 1.5 pixels and a range
+     * sigma of 2% of the depth
+     * @param kernelSize - 3 or 5
+     */
+    BilateralFilter(unsigned int kernelSize = 5);
+
+    /**
+     * @brief Destructor
+     */
+    ~BilateralFilter();
+
+    BilateralFilter(const BilateralFilter &) = delete;
+    BilateralFilter &operator=(const BilateralFilter &) = delete;
+
+  public: // implements FrameProcessor
+    /**
+     * @brief Filters the depth of a depth_ir or depth_only frame. inFrame
+     * and outFrame can be the same frame.
+     * @param inFrame - The frame which is used as input data
+     * @param[out] outFrame - A copy of inFrame, filtered
+     * @return Status - INVALID_ARGUMENT if the frame has no depth
+     */
+    Status processFrame(const Frame &inFrame, Frame &outFrame) override;
+
+  public:
+    /**
+     * @brief Sets the size of the window
+     * @param size - 3 or 5
+     * @return Status
+     */
+    Status setKernelSize(unsigned int size);
+
+    /**
+     * @brief Returns the size of the window
+     * @return unsigned int
+     */
+    unsigned int kernelSize() const;
+
+    /**
+     * @brief Sets the standard deviation of the spatial Gaussian
+     * @param sigma - in pixels, positive
+     * @return Status
+     */
+    Status setSpatialSigma(float sigma);
+
+    /**
+     * @brief Returns the standard deviation of the spatial Gaussian
+     * @return float
+     */
+    float spatialSigma() const;
+
+    /**
+     * @brief Sets the standard deviation of the range Gaussian
+     * @param sigma - relative to the depth of the pixel, positive
+     * @return Status
+     */
+    Status setRangeSigma(float sigma);
+
+    /**
+     * @brief Returns the standard deviation of the range Gaussian
+     * @return float
+     */
+    float rangeSigma() const;
+
+    /**
+     * @brief Sets the depth from which pixels are saturated, usually the
+     * maxDepth of the camera details. The default is 65535.
+     * @param maxDepth - at least 1
+     * @return Status
+     */
+    Status setMaxDepth(uint16_t maxDepth);
+
+    /**
+     * @brief Returns the depth from which pixels are saturated
+     * @return uint16_t
+     */
+    uint16_t maxDepth() const;
+
+  private:
+    std::unique_ptr<BilateralFilterImpl> m_impl;
+};
+
+} // namespace aditof
+
+#endif // BILATERAL_FILTER_H
@@ -47,6 +47,15 @@ namespace aditof {
  */
 enum class Revision { RevB, RevC };
 
+/**
+ * @enum DepthInterpolation
+ * @brief Enumerates the ways depth is resampled when undistorting
+ */
+enum class DepthInterpolation {
+    NEAREST,   //!< the depth of the nearest pixel
+    EDGE_AWARE //!< bilinear, except across edges and invalid pixels
+};
+
 /**
  * @class Camera96Tof1Specifics
  * @brief Implements the extened API that is specific for the 96 TOF1 camera.
@@ -113,6 +122,34 @@ class SDK_API Camera96Tof1Specifics : public CameraSpecifics {
     */
     float irGammaCorrection() const;
 
+    /**
+     * @brief Enables the removal of the lens distortion from the depth and
+     * IR images, with the distortion coefficients read from the EEPROM. The
+     * undistorted images follow the pinhole model of the camera matrix, which
+     * is what PointCloudGenerator expects.
+     * @return Status
+     */
+    Status enableUndistortion(bool en);
+
+    /**
+     * @brief Returns the last state that has been set for the undistortion.
+     * @return bool
+     */
+    bool undistortionEnabled() const;
+
+    /**
+     * @brief Sets how depth is resampled by the undistortion. IR is always
+     * interpolated bilinearly. The default is EDGE_AWARE.
+     * @return Status
+     */
+    Status setDepthInterpolation(DepthInterpolation interpolation);
+
+    /**
+     * @brief Returns the way depth is resampled by the undistortion.
+     * @return DepthInterpolation
+     */
+    DepthInterpolation depthInterpolation() const;
+
   private:
     Status setTresholdAndEnable(uint16_t treshold, bool en);
 
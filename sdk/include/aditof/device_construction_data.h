@@ -47,6 +47,7 @@ enum class DeviceType {
     LOCAL,    //!< on the target
     USB,      //!< connects to target via USB
     ETHERNET, //!< connects to target via Ethernet
+    REPLAY,   //!< plays back data recorded from a sensor
 };
 
 /**
@@ -61,7 +62,8 @@ struct DeviceConstructionData {
 
     /**
      * @brief The URL associated with the driver used by the device to talk to
-     * hardware
+     * hardware. For a replay device it is the path to the manifest of the
+     * recording.
      */
     std::string driverPath;
 
@@ -41,6 +41,8 @@
 
 namespace aditof {
 
+class FrameLease;
+
 /**
  * @class DeviceInterface
  * @brief Provides access to the low level functionality of the camera. This
@@ -104,6 +106,30 @@ class DeviceInterface {
      */
     virtual aditof::Status getFrame(uint16_t *buffer) = 0;
 
+    /**
+     * @brief Request a frame from the device without copying it out of the
+     * driver buffer. The buffer is given back to the driver when the lease is
+     * released. Devices that do not keep frames in driver buffers don't
+     * support this operation.
+     * @param[out] lease - a read-only view of the frame in the driver buffer
+     * @return Status
+     */
+    virtual aditof::Status getFrameLease(aditof::FrameLease & /*lease*/) {
+        return aditof::Status::UNAVAILABLE;
+    }
+
+    /**
+     * @brief Get the metadata (timestamps and stage durations) of the last
+     * frame returned by getFrame() or getFrameLease(). Devices that don't
+     * track it don't support this operation.
+     * @param[out] metadata - Object where the metadata is stored
+     * @return Status
+     */
+    virtual aditof::Status
+    getFrameMetadata(aditof::FrameMetadata & /*metadata*/) {
+        return aditof::Status::UNAVAILABLE;
+    }
+
     /**
      * @brief Read the EEPROM memory of the device starting from the given
      * address.
@@ -33,6 +33,7 @@
 #define FILTERS_FACTORY_H
 
 #include <aditof/frame_processor_factory.h>
+#include <aditof/sdk_exports.h>
 
 namespace aditof {
 
@@ -40,7 +41,7 @@ namespace aditof {
  * @class FiltersFactory
  * @brief A factory for creating filters
  */
-class FiltersFactory : public FrameProcessorFactory {
+class SDK_API FiltersFactory : public FrameProcessorFactory {
   public:
     virtual std::unique_ptr<FrameProcessor>
     createFrameProcessor(FrameProcessorType type) const override;
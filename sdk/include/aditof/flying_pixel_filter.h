@@ -0,0 +1,142 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef FLYING_PIXEL_FILTER_H
+#define FLYING_PIXEL_FILTER_H
+
+#include <aditof/frame_processor.h>
+#include <aditof/sdk_exports.h>
+
+#include <memory>
+#include <stdint.h>
+
+class FlyingPixelFilterImpl;
+
+namespace aditof {
+
+/**
+ * @class FlyingPixelFilter
+ * @brief Invalidates the flying pixels of a depth image: the pixels on a
+ * depth discontinuity, which see both the foreground and the background and
+ * get a depth in between, and the spikes that multipath creates along edges.
+ * It is meant to run before PointCloudGenerator.
+ *
+ * A neighbor is a jump from a pixel when their depth differs by more than
+ * depthJumpThreshold times the depth of the pixel. The depth of a pixel is
+ * set to 0 when:
+ *  - its left and right neighbors, or its top and bottom neighbors, are
+ *    both jumps from it, or
+ *  - one of these 4 neighbors is a jump and its IR value is below
+ *    edgeIrThreshold: a weak signal on an edge is mostly mixed light. This
+ *    test needs depth_ir frames.
+ * Neighbors without depth (0) and pixels outside of the image are never
+ * jumps. Pixels without depth or saturated (maxDepth and above) are left as
+ * they are. A thin object, one pixel wide, is seen as flying pixels.
+ *
+ * The frame is processed in one pass over the depth and IR images. The
+ * methods must not be called from several threads at once.
+ */
+class SDK_API FlyingPixelFilter : public FrameProcessor {
+  public:
+    /**
+     * @brief Constructor, with a depth jump threshold of 5% and no IR test
+     */
+    FlyingPixelFilter();
+
+    /**
+     * @brief Destructor
+     */
+    ~FlyingPixelFilter();
+
+    FlyingPixelFilter(const FlyingPixelFilter &) = delete;
+    FlyingPixelFilter &operator=(const FlyingPixelFilter &) = delete;
+
+  public: // implements FrameProcessor
+    /**
+     * @brief Filters the depth of a depth_ir or depth_only frame. inFrame
+     * and outFrame can be the same frame.
+     * @param inFrame - The frame which is used as input data
+     * @param[out] outFrame - A copy of inFrame, filtered
+     * @return Status - INVALID_ARGUMENT if the frame has no depth
+     */
+    Status processFrame(const Frame &inFrame, Frame &outFrame) override;
+
+  public:
+    /**
+     * @brief Sets the depth difference between two neighbors, relative to
+     * the depth of the pixel, above which they are on different surfaces
+     * @param threshold - in (0, 1)
+     * @return Status
+     */
+    Status setDepthJumpThreshold(float threshold);
+
+    /**
+     * @brief Returns the relative depth difference of a jump
+     * @return float
+     */
+    float depthJumpThreshold() const;
+
+    /**
+     * @brief Sets the IR value below which pixels next to a jump are
+     * invalidated. 0 disables the test.
+     * @param threshold - the IR value
+     * @return Status
+     */
+    Status setEdgeIrThreshold(uint16_t threshold);
+
+    /**
+     * @brief Returns the IR value below which pixels next to a jump are
+     * invalidated
+     * @return uint16_t
+     */
+    uint16_t edgeIrThreshold() const;
+
+    /**
+     * @brief Sets the depth from which pixels are saturated, usually the
+     * maxDepth of the camera details. The default is 65535.
+     * @param maxDepth - at least 1
+     * @return Status
+     */
+    Status setMaxDepth(uint16_t maxDepth);
+
+    /**
+     * @brief Returns the depth from which pixels are saturated
+     * @return uint16_t
+     */
+    uint16_t maxDepth() const;
+
+  private:
+    std::unique_ptr<FlyingPixelFilterImpl> m_impl;
+};
+
+} // namespace aditof
+
+#endif // FLYING_PIXEL_FILTER_H
@@ -92,6 +92,21 @@ class SDK_API Frame {
      */
     Status getDetails(FrameDetails &details) const;
 
+    /**
+     * @brief Sets the metadata of the frame
+     * @param metadata
+     * @return Status
+     */
+    Status setMetadata(const FrameMetadata &metadata);
+
+    /**
+     * @brief Gets the metadata of the frame, which tells when it was captured
+     * and how long its acquisition took
+     * @param[out] metadata
+     * @return Status
+     */
+    Status getMetadata(FrameMetadata &metadata) const;
+
     /**
      * @brief Gets the address where the specified data is being stored
      * @param dataType
@@ -32,6 +32,7 @@
 #ifndef FRAME_DEFINITIONS_H
 #define FRAME_DEFINITIONS_H
 
+#include <stdint.h>
 #include <string>
 
 /**
@@ -71,6 +72,57 @@ struct FrameDetails {
     std::string type;
 };
 
+/**
+ * @struct FrameMetadata
+ * @brief Describes when a frame was captured and how long each stage of its
+ * acquisition took. Timestamps are in microseconds of the monotonic clock of
+ * the machine they were taken on, durations are in microseconds. Fields that
+ * are not known are 0.
+ */
+struct FrameMetadata {
+    /**
+     * @brief The number of the frame, as counted by the driver of the sensor
+     * (or by the network server for remote cameras).
+     */
+    uint32_t sequence = 0;
+
+    /**
+     * @brief When the driver received the frame from the sensor. Taken on the
+     * machine the sensor is attached to, which is the target for remote
+     * cameras.
+     */
+    uint64_t sensorTimestamp = 0;
+
+    /**
+     * @brief When the packed frame became available to the SDK (dequeued
+     * from the driver or received from the network).
+     */
+    uint64_t dequeueTimestamp = 0;
+
+    /**
+     * @brief When the frame was ready to be used by the application.
+     */
+    uint64_t readyTimestamp = 0;
+
+    /**
+     * @brief Time spent waiting for the packed frame to be available, from
+     * the driver or from the network.
+     */
+    uint32_t transferTime = 0;
+
+    /**
+     * @brief Time spent unpacking (decompressing and deinterleaving) the
+     * frame.
+     */
+    uint32_t unpackTime = 0;
+
+    /**
+     * @brief Time spent calibrating depth and geometry, which are applied in
+     * a single pass.
+     */
+    uint32_t calibrationTime = 0;
+};
+
 } // namespace aditof
 
 #endif // FRAME_DEFINITIONS_H
@@ -0,0 +1,130 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef FRAME_LEASE_H
+#define FRAME_LEASE_H
+
+#include "frame_definitions.h"
+#include "sdk_exports.h"
+#include "status_definitions.h"
+
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+
+class FrameLeaseImpl;
+
+namespace aditof {
+
+/**
+ * @class FrameLease
+ * @brief Read-only view of a frame that still resides in a buffer owned by
+ * the device driver. No copy is made when the lease is obtained. The buffer
+ * is handed back to the driver when the lease is released or destroyed.
+ * While a lease is held the driver has one buffer less to capture into, so
+ * leases should be short lived and must be released before the device is
+ * reconfigured or destroyed.
+ */
+class SDK_API FrameLease {
+  public:
+    /**
+     * @brief Constructor. Creates an empty (invalid) lease.
+     */
+    FrameLease();
+
+    /**
+     * @brief Constructor used by the devices to hand out a buffer.
+     * @param impl - the internal description of the leased buffer
+     */
+    explicit FrameLease(std::unique_ptr<FrameLeaseImpl> impl);
+
+    /**
+     * @brief Destructor. Releases the leased buffer.
+     */
+    ~FrameLease();
+
+    /**
+     * @brief Move constructor
+     */
+    FrameLease(FrameLease &&) noexcept;
+
+    /**
+     * @brief Move assignment. Releases the currently leased buffer.
+     */
+    FrameLease &operator=(FrameLease &&) noexcept;
+
+    FrameLease(const FrameLease &) = delete;
+    FrameLease &operator=(const FrameLease &) = delete;
+
+  public:
+    /**
+     * @brief Tells if the lease currently holds a buffer
+     * @return bool
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Gets the details of the leased frame
+     * @param[out] details
+     * @return Status
+     */
+    Status getDetails(FrameDetails &details) const;
+
+    /**
+     * @brief Gets the data of the frame as it was received from the sensor
+     * (12 bits per pixel, two pixels packed in three bytes).
+     * @param[out] data - location of the packed data in the driver buffer
+     * @param[out] size - the size of the packed data in bytes
+     * @return Status
+     */
+    Status getPackedData(const uint8_t **data, size_t &size) const;
+
+    /**
+     * @brief Gets the address of the specified data in 16 bits per pixel
+     * format. The packed data is unpacked only on the first call.
+     * @param dataType
+     * @param[out] dataPtr
+     * @return Status
+     */
+    Status getData(FrameDataType dataType, const uint16_t **dataPtr);
+
+    /**
+     * @brief Hands the buffer back to the driver. The lease becomes invalid.
+     */
+    void release();
+
+  private:
+    std::unique_ptr<FrameLeaseImpl> m_impl;
+};
+
+} // namespace aditof
+
+#endif // FRAME_LEASE_H
@@ -0,0 +1,98 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include "frame.h"
+#include "frame_definitions.h"
+#include "sdk_exports.h"
+
+#include <cstddef>
+#include <memory>
+
+class FramePoolImpl;
+
+namespace aditof {
+
+/**
+ * @class FramePool
+ * @brief Pool of pre-allocated frames. A frame taken from the pool goes back
+ * to it when the last reference to it is dropped, so frames can be requested
+ * from a camera at frame rate without allocating memory. Frames that are
+ * still in use when the pool is destroyed are freed normally.
+ */
+class SDK_API FramePool {
+  public:
+    /**
+     * @brief Constructor
+     * @param details - the details the frames of the pool are configured with
+     * @param size - how many frames to pre-allocate
+     */
+    FramePool(const FrameDetails &details, size_t size);
+
+    /**
+     * @brief Destructor
+     */
+    ~FramePool();
+
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+  public:
+    /**
+     * @brief Takes a frame from the pool. If all the frames are in use a new
+     * one is created, which joins the pool when released.
+     * @return std::shared_ptr<Frame>
+     */
+    std::shared_ptr<Frame> acquire();
+
+    /**
+     * @brief Changes the details of the frames of the pool. Frames that are in
+     * use are updated when they come back to the pool.
+     * @param details
+     * @return Status
+     */
+    Status setDetails(const FrameDetails &details);
+
+    /**
+     * @brief Gets the number of frames that are ready to be acquired
+     * @return size_t
+     */
+    size_t available() const;
+
+  private:
+    std::shared_ptr<FramePoolImpl> m_impl;
+};
+
+} // namespace aditof
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,169 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef FRAME_PROCESSING_PIPELINE_H
+#define FRAME_PROCESSING_PIPELINE_H
+
+#include <aditof/frame_processor.h>
+#include <aditof/sdk_exports.h>
+#include <aditof/status_definitions.h>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class FrameProcessingPipelineImpl;
+
+namespace aditof {
+
+/**
+ * @enum StageMode
+ * @brief How a stage of a FrameProcessingPipeline gets the frame it writes to
+ */
+enum class StageMode {
+    COPY,    //!< processFrame(input, output), into a frame of the pipeline
+    IN_PLACE //!< processFrame(frame, frame), on the frame of its input
+};
+
+/**
+ * @brief Callback for when a frame has been through all the stages of a
+ * FrameProcessingPipeline. It receives the first error of a stage, if any,
+ * and the output frames.
+ */
+typedef std::function<void(Status, const std::vector<Frame *> &)>
+    PipelineCallback;
+
+/**
+ * @class FrameProcessingPipeline
+ * @brief Runs frames through a graph of FrameProcessor stages on a pool of
+ * worker threads.
+ *
+ * Each stage takes its input from the submitted frame or from the output of
+ * another stage, so the stages form a chain or a tree. The stages without
+ * children are the outputs of the pipeline. An IN_PLACE stage works on the
+ * frame of its input without copying it, unless other stages read the same
+ * frame, in which case it gets a copy.
+ *
+ * A stage processes one frame at a time, in the order the frames were
+ * submitted, so the processors can keep state between frames. Different
+ * stages run concurrently: while a frame is in the last stage the next one
+ * is already in the first stage, and the branches of a tree run in
+ * parallel. The callbacks are called from the worker threads, in the order
+ * the frames were submitted.
+ *
+ * If a stage fails, the stages after it are skipped for that frame.
+ */
+class SDK_API FrameProcessingPipeline {
+  public:
+    /**
+     * @brief The input of the stages that process the submitted frame
+     */
+    static const int SOURCE = -1;
+
+    /**
+     * @brief Constructor
+     * @param threadCount - the number of worker threads, 0 for one per core
+     * @param maxPendingFrames - how many frames can be in the pipeline
+     */
+    FrameProcessingPipeline(size_t threadCount = 0,
+                            size_t maxPendingFrames = 4);
+
+    /**
+     * @brief Destructor, waits for the frames in the pipeline
+     */
+    ~FrameProcessingPipeline();
+
+    FrameProcessingPipeline(const FrameProcessingPipeline &) = delete;
+    FrameProcessingPipeline &
+    operator=(const FrameProcessingPipeline &) = delete;
+
+  public:
+    /**
+     * @brief Adds a stage that processes the output of another stage
+     * @param processor - the processor run by the stage
+     * @param mode - whether the stage copies its input
+     * @param input - the stage whose output is processed, or SOURCE
+     * @param[out] stage - the identifier of the new stage
+     * @return Status - BUSY if frames are in the pipeline, INVALID_ARGUMENT
+     * if the input is not a stage
+     */
+    Status addStage(std::shared_ptr<FrameProcessor> processor, StageMode mode,
+                    int input, int &stage);
+
+    /**
+     * @brief Adds a stage after the last added stage, to build a chain
+     * @param processor - the processor run by the stage
+     * @param mode - whether the stage copies its input
+     * @return Status - BUSY if frames are in the pipeline
+     */
+    Status addStage(std::shared_ptr<FrameProcessor> processor,
+                    StageMode mode = StageMode::IN_PLACE);
+
+    /**
+     * @brief Removes all the stages
+     * @return Status - BUSY if frames are in the pipeline
+     */
+    Status clear();
+
+    /**
+     * @brief Sends a frame through the stages, without waiting
+     * @param frame - the input frame, which IN_PLACE stages may modify. It
+     * must stay alive until the callback is called.
+     * @param cb - called with the outputs, in the order of the stages, which
+     * are valid until it returns. The outputs of skipped stages are null.
+     * The output of a chain of IN_PLACE stages is the input frame.
+     * @return Status - BUSY if maxPendingFrames frames are in the pipeline,
+     * UNAVAILABLE if there are no stages
+     */
+    Status submit(Frame *frame, PipelineCallback cb);
+
+    /**
+     * @brief Sends a frame through the stages and waits for it. The frame is
+     * replaced by the first output of the pipeline.
+     * @param frame - the frame to process
+     * @return Status - the first error of a stage, if any
+     */
+    Status process(Frame &frame);
+
+    /**
+     * @brief Blocks until all the submitted frames have been processed. Must
+     * not be called from a callback.
+     */
+    void flush();
+
+  private:
+    std::unique_ptr<FrameProcessingPipelineImpl> m_impl;
+};
+
+} // namespace aditof
+
+#endif // FRAME_PROCESSING_PIPELINE_H
@@ -44,6 +44,10 @@ class FrameProcessor;
  */
 enum class FrameProcessorType {
     VARIANCE_FILTER,
+    MEDIAN_FILTER_3X3,
+    MEDIAN_FILTER_5X5,
+    BILATERAL_FILTER,
+    FLYING_PIXEL_FILTER,
 };
 
 /**
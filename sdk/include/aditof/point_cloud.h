@@ -0,0 +1,167 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef POINT_CLOUD_H
+#define POINT_CLOUD_H
+
+#include "camera_definitions.h"
+#include "frame.h"
+#include "sdk_exports.h"
+#include "status_definitions.h"
+
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+
+class PointCloudGeneratorImpl;
+
+namespace aditof {
+
+/**
+ * @enum PointFormat
+ * @brief Types of the coordinates of the points of a point cloud
+ */
+enum class PointFormat {
+    FLOAT32, //!< x, y, z as float, in meters
+    INT16    //!< x, y, z as int16_t, in millimeters
+};
+
+/**
+ * @struct PointCloudBuffer
+ * @brief Describes where the points of a point cloud are written. The buffers
+ * are allocated by the caller and must hold one point per depth pixel. Points
+ * can be interleaved with other fields, like in a ROS PointCloud2 message,
+ * by giving the distance in bytes between two consecutive points.
+ */
+struct PointCloudBuffer {
+    /**
+     * @brief The type of the coordinates
+     */
+    PointFormat format = PointFormat::FLOAT32;
+
+    /**
+     * @brief Where the x, y, z coordinates of the first point are written
+     */
+    void *points = nullptr;
+
+    /**
+     * @brief The number of bytes from a point to the next one. 0 means the
+     * points are packed (3 coordinates, then the next point).
+     */
+    size_t pointStep = 0;
+
+    /**
+     * @brief Where the IR value of the first point is written. Optional, the
+     * IR values are not written if null.
+     */
+    uint16_t *intensity = nullptr;
+
+    /**
+     * @brief The number of bytes from an IR value to the next one. 0 means
+     * the values are packed.
+     */
+    size_t intensityStep = 0;
+};
+
+/**
+ * @class PointCloudGenerator
+ * @brief Turns depth images into point clouds. The direction of the ray seen
+ * by each pixel is computed once from the intrinsic parameters of the camera,
+ * after which a point only costs two multiplications. The points are computed
+ * with the SIMD instructions of the machine when there are some.
+ *
+ * A point is (depth * rayX, depth * rayY, depth), so pixels without depth
+ * give the point (0, 0, 0). The methods must not be called from several
+ * threads at once.
+ */
+class SDK_API PointCloudGenerator {
+  public:
+    /**
+     * @brief Constructor
+     */
+    PointCloudGenerator();
+
+    /**
+     * @brief Destructor
+     */
+    ~PointCloudGenerator();
+
+    PointCloudGenerator(const PointCloudGenerator &) = delete;
+    PointCloudGenerator &operator=(const PointCloudGenerator &) = delete;
+
+  public:
+    /**
+     * @brief Computes the rays of the pixels of a depth image. Nothing is
+     * recomputed when the parameters and the size didn't change, so this
+     * can be called every time the mode of the camera changes.
+     * @param intrinsics - the intrinsic parameters of the camera
+     * @param width - the width of the depth image
+     * @param height - the height of the depth image
+     * @return Status - INVALID_ARGUMENT if the camera matrix is incomplete
+     */
+    Status setIntrinsics(const IntrinsicParameters &intrinsics,
+                         unsigned int width, unsigned int height);
+
+    /**
+     * @brief Computes the point cloud of a depth image
+     * @param depth - the depth image, with the size given to setIntrinsics()
+     * @param ir - the IR image matching the depth image, only needed when
+     * output.intensity is set
+     * @param output - where the points are written
+     * @return Status - UNAVAILABLE if setIntrinsics() was not called
+     */
+    Status compute(const uint16_t *depth, const uint16_t *ir,
+                   const PointCloudBuffer &output);
+
+    /**
+     * @brief Computes the point cloud of the depth data of a frame, using
+     * the IR data of the frame for the intensities
+     * @param frame - the frame, whose depth data must have the size given to
+     * setIntrinsics()
+     * @param output - where the points are written
+     * @return Status
+     */
+    Status compute(Frame &frame, const PointCloudBuffer &output);
+
+    /**
+     * @brief Gets the number of points of the point clouds, which is the
+     * number of pixels of the depth images
+     * @return size_t
+     */
+    size_t getPointCount() const;
+
+  private:
+    std::unique_ptr<PointCloudGeneratorImpl> m_impl;
+};
+
+} // namespace aditof
+
+#endif // POINT_CLOUD_H
@@ -0,0 +1,248 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include "camera_definitions.h"
+#include "frame.h"
+#include "frame_definitions.h"
+#include "sdk_exports.h"
+#include "status_definitions.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+class RecordingWriterImpl;
+class RecordingReaderImpl;
+
+namespace aditof {
+
+/**
+ * @struct RecordedFrameInfo
+ * @brief Describes a frame of a recording
+ */
+struct RecordedFrameInfo {
+    /**
+     * @brief When the frame was captured and how long its acquisition took
+     */
+    FrameMetadata metadata;
+
+    /**
+     * @brief The temperature of the AFE when the frame was recorded, in
+     * degrees Celsius. 0 if it was not known.
+     */
+    float afeTemperature = 0.0f;
+
+    /**
+     * @brief The temperature of the laser when the frame was recorded, in
+     * degrees Celsius. 0 if it was not known.
+     */
+    float laserTemperature = 0.0f;
+};
+
+/**
+ * @class RecordingWriter
+ * @brief Writes frames to a recording file. The file starts with the details
+ * of the camera (mode, frame type, intrinsic parameters) and stores every
+ * frame with its metadata. An index of the frames is added when the
+ * recording is closed, which gives RecordingReader random access to them.
+ *
+ * Frames are stored with 12 bits per pixel when their values allow it and
+ * are written to the file in large blocks by a separate thread. Frames that
+ * arrive while all the blocks are waiting for the storage are dropped and
+ * counted. The methods must not be called from several threads at once.
+ */
+class SDK_API RecordingWriter {
+  public:
+    /**
+     * @brief Constructor
+     */
+    RecordingWriter();
+
+    /**
+     * @brief Destructor. Closes the recording if it is still open.
+     */
+    ~RecordingWriter();
+
+    RecordingWriter(const RecordingWriter &) = delete;
+    RecordingWriter &operator=(const RecordingWriter &) = delete;
+
+  public:
+    /**
+     * @brief Creates the recording file, replacing any existing file.
+     * @param fileName - the path of the file
+     * @param details - the details of the camera the frames come from
+     * @param fps - the frame rate of the camera
+     * @return Status
+     */
+    Status open(const std::string &fileName, const CameraDetails &details,
+                unsigned int fps);
+
+    /**
+     * @brief Appends a frame to the recording. The frame must have the frame
+     * type of the camera details given to open(). Its data is copied, the
+     * frame can be reused as soon as the call returns.
+     * @param frame - the frame, along with its metadata
+     * @param afeTemperature - the temperature of the AFE, 0 if not known
+     * @param laserTemperature - the temperature of the laser, 0 if not known
+     * @return Status - BUSY if the frame was dropped because the storage
+     * is behind
+     */
+    Status writeFrame(Frame &frame, float afeTemperature,
+                      float laserTemperature);
+
+    /**
+     * @brief Writes the index of the frames and closes the file.
+     * @return Status
+     */
+    Status close();
+
+    /**
+     * @brief Tells if a recording is open
+     * @return bool
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Gets the number of frames written so far
+     * @return size_t
+     */
+    size_t getFrameCount() const;
+
+    /**
+     * @brief Gets the number of frames dropped so far because the storage
+     * could not keep up
+     * @return size_t
+     */
+    size_t getDroppedFrameCount() const;
+
+  private:
+    std::unique_ptr<RecordingWriterImpl> m_impl;
+};
+
+/**
+ * @class RecordingReader
+ * @brief Reads the frames of a file written by RecordingWriter. The file is
+ * mapped in memory and any frame can be accessed in constant time. A
+ * recording that was not closed properly (no index) can still be read, its
+ * frames being located when it is opened.
+ */
+class SDK_API RecordingReader {
+  public:
+    /**
+     * @brief Constructor
+     */
+    RecordingReader();
+
+    /**
+     * @brief Destructor
+     */
+    ~RecordingReader();
+
+    RecordingReader(const RecordingReader &) = delete;
+    RecordingReader &operator=(const RecordingReader &) = delete;
+
+  public:
+    /**
+     * @brief Opens a recording
+     * @param fileName - the path of the file
+     * @return Status
+     */
+    Status open(const std::string &fileName);
+
+    /**
+     * @brief Closes the recording. The data obtained with getFrameData()
+     * becomes invalid.
+     */
+    void close();
+
+    /**
+     * @brief Tells if a recording is open
+     * @return bool
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Gets the details of the camera the frames were recorded with
+     * @param[out] details
+     * @return Status
+     */
+    Status getCameraDetails(CameraDetails &details) const;
+
+    /**
+     * @brief Gets the frame rate of the camera the frames were recorded with
+     * @return unsigned int
+     */
+    unsigned int getFps() const;
+
+    /**
+     * @brief Gets the number of frames of the recording
+     * @return size_t
+     */
+    size_t getFrameCount() const;
+
+    /**
+     * @brief Gets the metadata of a frame
+     * @param index - the position of the frame in the recording
+     * @param[out] info
+     * @return Status
+     */
+    Status getFrameInfo(size_t index, RecordedFrameInfo &info) const;
+
+    /**
+     * @brief Gets the data of a frame, in the layout of Frame::getData() for
+     * FrameDataType::RAW. No copy is made, the data stays valid until the
+     * recording is closed. Frames stored with 12 bits per pixel can only be
+     * read with readFrame().
+     * @param index - the position of the frame in the recording
+     * @param[out] data
+     * @return Status - UNAVAILABLE if the frame is stored packed
+     */
+    Status getFrameData(size_t index, const uint16_t **data) const;
+
+    /**
+     * @brief Copies a frame of the recording, along with its metadata, into
+     * a frame. The details of the frame are changed if needed.
+     * @param index - the position of the frame in the recording
+     * @param[out] frame
+     * @return Status
+     */
+    Status readFrame(size_t index, Frame &frame) const;
+
+  private:
+    std::unique_ptr<RecordingReaderImpl> m_impl;
+};
+
+} // namespace aditof
+
+#endif // RECORDING_H
@@ -0,0 +1,281 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+namespace aditof {
+
+/**
+ * @enum OverflowPolicy
+ * @brief What RingBuffer::push() does when the ring is full
+ */
+enum class OverflowPolicy {
+    DROP_OLDEST, //!< the oldest item is dropped to make room for the new one
+    DROP_NEWEST, //!< the new item is dropped
+    BLOCK        //!< push() waits for the consumer to make room
+};
+
+/**
+ * @class RingBuffer
+ * @brief Bounded queue handing items from one producer thread to one
+ * consumer thread, for instance frames from a capture thread to a display or
+ * a recording thread. The memory used is fixed and the latency is bounded by
+ * the capacity.
+ *
+ * push() and tryPop() don't take any lock. A mutex is only used to put a
+ * thread to sleep in the blocking calls (pop() and push() with the BLOCK
+ * policy) and is only taken by the other side when a thread sleeps.
+ *
+ * With the DROP_OLDEST policy the producer removes the oldest item itself,
+ * so the type of the items should be cheap to move, like a std::shared_ptr.
+ * Items must be default constructible and move assignable.
+ */
+template <typename T> class RingBuffer {
+  public:
+    /**
+     * @brief Constructor
+     * @param capacity - the maximum number of items in the ring, at least 1
+     * @param policy - what to do when an item is pushed in a full ring
+     */
+    RingBuffer(size_t capacity, OverflowPolicy policy)
+        : m_capacity(capacity > 0 ? capacity : 1),
+          m_slots(new Slot[m_capacity]), m_policy(policy) {
+        for (size_t i = 0; i < m_capacity; ++i) {
+            m_slots[i].sequence.store(2 * i, std::memory_order_relaxed);
+        }
+    }
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    /**
+     * @brief Adds an item. Must only be called from the producer thread.
+     * @param item
+     * @return bool - false if the item was dropped (DROP_NEWEST policy) or
+     * the ring was closed while waiting for room (BLOCK policy)
+     */
+    bool push(T item) {
+        const uint64_t pos = m_tail.load(std::memory_order_relaxed);
+        Slot &slot = m_slots[pos % m_capacity];
+
+        while (slot.sequence.load(std::memory_order_acquire) != 2 * pos) {
+            // The slot still holds the item pushed one lap ago. If the
+            // consumer has claimed it, it is being moved out right now.
+            if (m_head.load(std::memory_order_acquire) > pos - m_capacity) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            if (m_policy == OverflowPolicy::DROP_NEWEST) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            if (m_policy == OverflowPolicy::DROP_OLDEST) {
+                T oldest;
+                if (tryPop(oldest)) {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+                continue;
+            }
+
+            if (!wait([&]() {
+                    return slot.sequence.load(std::memory_order_acquire) ==
+                           2 * pos;
+                })) {
+                return false;
+            }
+        }
+
+        slot.value = std::move(item);
+        slot.sequence.store(2 * pos + 1, std::memory_order_release);
+        m_tail.store(pos + 1, std::memory_order_release);
+        wakeUp();
+
+        return true;
+    }
+
+    /**
+     * @brief Takes the oldest item if there is one. Must only be called from
+     * the consumer thread.
+     * @param[out] item
+     * @return bool - false if the ring is empty
+     */
+    bool tryPop(T &item) {
+        uint64_t pos = m_head.load(std::memory_order_relaxed);
+        Slot *slot;
+
+        // The producer may be taking the oldest item at the same time to
+        // drop it, so the item is claimed before being moved out
+        while (true) {
+            slot = &m_slots[pos % m_capacity];
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            if (sequence != 2 * pos + 1) {
+                if (static_cast<int64_t>(sequence - (2 * pos + 1)) < 0) {
+                    return false;
+                }
+                pos = m_head.load(std::memory_order_relaxed);
+            } else if (m_head.compare_exchange_weak(
+                           pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        item = std::move(slot->value);
+        slot->value = T();
+        slot->sequence.store(2 * (pos + m_capacity),
+                             std::memory_order_release);
+        wakeUp();
+
+        return true;
+    }
+
+    /**
+     * @brief Takes the oldest item, waiting for one if the ring is empty.
+     * Must only be called from the consumer thread.
+     * @param[out] item
+     * @return bool - false if the ring was closed and is empty
+     */
+    bool pop(T &item) {
+        while (!tryPop(item)) {
+            if (!wait([this]() { return !empty(); }) && empty()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Wakes up the threads waiting in pop() or push() and makes
+     * further waits return immediately. Items can still be popped.
+     */
+    void close() {
+        m_closed.store(true);
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+        m_waitCv.notify_all();
+    }
+
+    /**
+     * @brief Undoes close()
+     */
+    void reopen() { m_closed.store(false); }
+
+    /**
+     * @brief Tells if the ring has no item
+     * @return bool
+     */
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) ==
+               m_tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Gets the number of items in the ring. Only exact when called
+     * from the producer or the consumer while the other side is idle.
+     * @return size_t
+     */
+    size_t size() const {
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        uint64_t tail = m_tail.load(std::memory_order_acquire);
+        return tail > head ? static_cast<size_t>(tail - head) : 0;
+    }
+
+    /**
+     * @brief Gets the maximum number of items of the ring
+     * @return size_t
+     */
+    size_t capacity() const { return m_capacity; }
+
+    /**
+     * @brief Gets how many items were dropped because the ring was full
+     * @return size_t
+     */
+    size_t droppedCount() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Slot {
+        // 2 * pos when the slot is free for the item pos, 2 * pos + 1 once it
+        // holds that item. The factor 2 keeps both states apart when the
+        // capacity is 1.
+        std::atomic<uint64_t> sequence;
+        T value;
+    };
+
+    template <typename Predicate> bool wait(Predicate ready) {
+        m_waiters.fetch_add(1);
+        std::unique_lock<std::mutex> lock(m_waitMutex);
+        m_waitCv.wait(lock, [&]() { return ready() || m_closed.load(); });
+        m_waiters.fetch_sub(1);
+
+        return !m_closed.load();
+    }
+
+    void wakeUp() {
+        // Pairs with the increment of m_waiters in wait(): either the waiter
+        // sees the new state or this sees the waiter
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load() == 0) {
+            return;
+        }
+        { std::lock_guard<std::mutex> lock(m_waitMutex); }
+        m_waitCv.notify_all();
+    }
+
+  private:
+    const size_t m_capacity;
+    std::unique_ptr<Slot[]> m_slots;
+    const OverflowPolicy m_policy;
+
+    std::atomic<uint64_t> m_head{0};
+    std::atomic<uint64_t> m_tail{0};
+    std::atomic<size_t> m_dropped{0};
+
+    std::atomic<bool> m_closed{false};
+    std::atomic<int> m_waiters{0};
+    std::mutex m_waitMutex;
+    std::condition_variable m_waitCv;
+};
+
+} // namespace aditof
+
+#endif // RING_BUFFER_H
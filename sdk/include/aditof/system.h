@@ -100,6 +100,19 @@ class SDK_API System {
     Status getCameraListAtIp(std::vector<std::shared_ptr<Camera>> &cameraList,
                              const std::string &ip) const;
 
+    /**
+     * @brief Populates the given list with a Camera object that plays back a
+     * recording instead of talking to a sensor. Useful to run the SDK on
+     * machines that have no camera attached.
+     * @param[out] cameraList - A container to be set with the replay camera
+     * @param manifest - The path to the manifest describing the recording
+     * (see sdk/src/replay_device.h for its format)
+     * @return Status
+     */
+    Status
+    getCameraListFromReplay(std::vector<std::shared_ptr<Camera>> &cameraList,
+                            const std::string &manifest) const;
+
   private:
     std::unique_ptr<SystemImpl> m_impl;
 };
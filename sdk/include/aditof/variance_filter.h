@@ -33,16 +33,92 @@
 #define VARIANCE_FILTER_H
 
 #include <aditof/frame_processor.h>
+#include <aditof/sdk_exports.h>
+
+#include <memory>
+
+class VarianceFilterImpl;
 
 namespace aditof {
 
 /**
  * @class VarianceFilter
- * @brief Detects edges
+ * @brief Invalidates the depth pixels that are too noisy over time. The mean
+ * and the variance of every depth pixel are updated with each frame, the
+ * Welford way, over a window of the last frames: exactly over the first
+ * frames, then as exponential moving averages with the weight of the window.
+ * The depth of the pixels whose variance is above the threshold is set to 0,
+ * in the output frame only. A pixel that flickers between a depth and no
+ * depth has a high variance and is invalidated too.
+ *
+ * The filter keeps its state between frames, it is reset when the size of
+ * the frames changes or by reset(). The methods must not be called from
+ * several threads at once.
  */
-class VarianceFilter : public FrameProcessor {
+class SDK_API VarianceFilter : public FrameProcessor {
   public:
+    /**
+     * @brief Constructor, with a window of 8 frames and a threshold of
+     * 400 mm^2 (a standard deviation of 20 mm)
+     */
+    VarianceFilter();
+
+    /**
+     * @brief Destructor
+     */
+    ~VarianceFilter();
+
+    VarianceFilter(const VarianceFilter &) = delete;
+    VarianceFilter &operator=(const VarianceFilter &) = delete;
+
+  public: // implements FrameProcessor
+    /**
+     * @brief Updates the statistics with the depth of a depth_ir or
+     * depth_only frame and writes it to outFrame with the noisy pixels
+     * invalidated. inFrame and outFrame can be the same frame.
+     * @param inFrame - The frame which is used as input data
+     * @param[out] outFrame - A copy of inFrame, filtered
+     * @return Status - INVALID_ARGUMENT if the frame has no depth
+     */
     Status processFrame(const Frame &inFrame, Frame &outFrame) override;
+
+  public:
+    /**
+     * @brief Sets the number of frames over which the variance is computed
+     * and resets the statistics.
+     * @param frames - at least 1
+     * @return Status
+     */
+    Status setWindowSize(unsigned int frames);
+
+    /**
+     * @brief Returns the number of frames over which the variance is computed
+     * @return unsigned int
+     */
+    unsigned int windowSize() const;
+
+    /**
+     * @brief Sets the variance, in mm^2, above which the depth of a pixel is
+     * invalidated.
+     * @param threshold - a positive value
+     * @return Status
+     */
+    Status setVarianceThreshold(float threshold);
+
+    /**
+     * @brief Returns the variance above which the depth of a pixel is
+     * invalidated
+     * @return float
+     */
+    float varianceThreshold() const;
+
+    /**
+     * @brief Forgets the frames processed so far
+     */
+    void reset();
+
+  private:
+    std::unique_ptr<VarianceFilterImpl> m_impl;
 };
 
 } // namespace aditof
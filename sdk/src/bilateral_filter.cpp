@@ -0,0 +1,260 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "depth_filter.h"
+#include "thread_pool.h"
+
+#include <aditof/bilateral_filter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <glog/logging.h>
+#include <vector>
+
+using namespace aditof;
+
+// The rows are split in bands of this many rows between the threads
+static const size_t skRowsPerBand = 16;
+
+// The range Gaussian is tabulated over 3 standard deviations
+static const int skRangeTableSize = 256;
+static const float skRangeTableSigmas = 3.0f;
+
+class BilateralFilterImpl {
+  public:
+    BilateralFilterImpl()
+        : kernelSize(5), spatialSigma(1.5f), rangeSigma(0.02f),
+          maxDepth(0xFFFF) {
+        updateTables();
+    }
+
+    void updateTables() {
+        const int radius = static_cast<int>(kernelSize) / 2;
+        const int size = static_cast<int>(kernelSize);
+
+        spatialWeights.resize(size * size);
+        for (int j = -radius; j <= radius; ++j) {
+            for (int i = -radius; i <= radius; ++i) {
+                float d2 = static_cast<float>(i * i + j * j);
+                spatialWeights[(j + radius) * size + i + radius] =
+                    std::exp(-d2 / (2.0f * spatialSigma * spatialSigma));
+            }
+        }
+
+        // The last entry is for the pixels that are not averaged
+        rangeWeights.resize(skRangeTableSize + 1);
+        for (int i = 0; i < skRangeTableSize; ++i) {
+            float sigmas = i * skRangeTableSigmas / skRangeTableSize;
+            rangeWeights[i] = std::exp(-0.5f * sigmas * sigmas);
+        }
+        rangeWeights[skRangeTableSize] = 0.0f;
+
+        // Maps a depth difference, divided by the depth, to the table
+        rangeTableScale = skRangeTableSize / (skRangeTableSigmas * rangeSigma);
+    }
+
+    void filterRow(const uint16_t *src, uint16_t *dst, int width, int height,
+                   int y) const {
+        if (kernelSize == 3) {
+            filterRow<1>(src, dst, width, height, y);
+        } else {
+            filterRow<2>(src, dst, width, height, y);
+        }
+    }
+
+  private:
+    //! rangeIndex - The entry of the range table of a neighbor, the last one
+    //! (a weight of 0) for invalid neighbors and those too far in depth
+    int rangeIndex(int depth, int center, float scale) const {
+        float index = std::min(std::abs(depth - center) * scale,
+                               static_cast<float>(skRangeTableSize));
+        bool valid = depth != 0 && depth < maxDepth;
+        return valid ? static_cast<int>(index) : skRangeTableSize;
+    }
+
+    template <int Radius>
+    void filterRow(const uint16_t *src, uint16_t *dst, int width, int height,
+                   int y) const {
+        const int size = 2 * Radius + 1;
+        const uint16_t *srcRow = src + static_cast<size_t>(y) * width;
+        uint16_t *dstRow = dst + static_cast<size_t>(y) * width;
+        // Where the window is in the image, so that it needs no clipping
+        const bool interiorRow = y >= Radius && y + Radius < height;
+
+        for (int x = 0; x < width; ++x) {
+            const int center = srcRow[x];
+            if (center == 0 || center >= maxDepth) {
+                dstRow[x] = static_cast<uint16_t>(center);
+                continue;
+            }
+
+            const float scale = rangeTableScale / center;
+            float weightSum = 0.0f;
+            float depthSum = 0.0f;
+
+            if (interiorRow && x >= Radius && x + Radius < width) {
+                const uint16_t *window = srcRow - Radius * width - Radius;
+                for (int j = 0; j < size; ++j) {
+                    for (int i = 0; i < size; ++i) {
+                        int depth = window[j * width + x + i];
+                        float weight =
+                            spatialWeights[j * size + i] *
+                            rangeWeights[rangeIndex(depth, center, scale)];
+                        weightSum += weight;
+                        depthSum += weight * depth;
+                    }
+                }
+            } else {
+                const int top = std::max(y - Radius, 0);
+                const int bottom = std::min(y + Radius, height - 1);
+                const int left = std::max(x - Radius, 0);
+                const int right = std::min(x + Radius, width - 1);
+                for (int j = top; j <= bottom; ++j) {
+                    const uint16_t *row = src + static_cast<size_t>(j) * width;
+                    for (int i = left; i <= right; ++i) {
+                        int depth = row[i];
+                        float weight =
+                            spatialWeights[(j - y + Radius) * size + i - x +
+                                           Radius] *
+                            rangeWeights[rangeIndex(depth, center, scale)];
+                        weightSum += weight;
+                        depthSum += weight * depth;
+                    }
+                }
+            }
+
+            // The center pixel has a weight of 1
+            dstRow[x] = static_cast<uint16_t>(depthSum / weightSum + 0.5f);
+        }
+    }
+
+  public:
+    unsigned int kernelSize;
+    float spatialSigma;
+    float rangeSigma;
+    uint16_t maxDepth;
+
+    std::vector<float> spatialWeights;
+    std::vector<float> rangeWeights;
+    float rangeTableScale;
+
+    // The input depth image, the frame being the output
+    std::vector<uint16_t> source;
+};
+
+BilateralFilter::BilateralFilter(unsigned int kernelSize)
+    : m_impl(new BilateralFilterImpl) {
+    setKernelSize(kernelSize);
+}
+
+BilateralFilter::~BilateralFilter() = default;
+
+Status BilateralFilter::processFrame(const Frame &inFrame, Frame &outFrame) {
+    DepthPlane depth;
+    Status status = prepareDepthFilter(inFrame, outFrame, "bilateral", depth);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    size_t pixelCount = static_cast<size_t>(depth.width) * depth.height;
+    m_impl->source.assign(depth.data, depth.data + pixelCount);
+    const uint16_t *src = m_impl->source.data();
+
+    ThreadPool::instance().parallelFor(
+        0, depth.height, skRowsPerBand, [&](size_t first, size_t last) {
+            for (size_t y = first; y < last; ++y) {
+                m_impl->filterRow(src, depth.data,
+                                  static_cast<int>(depth.width),
+                                  static_cast<int>(depth.height),
+                                  static_cast<int>(y));
+            }
+        });
+
+    return Status::OK;
+}
+
+Status BilateralFilter::setKernelSize(unsigned int size) {
+    if (size != 3 && size != 5) {
+        LOG(WARNING) << "Unsupported bilateral kernel size: " << size;
+        return Status::INVALID_ARGUMENT;
+    }
+
+    m_impl->kernelSize = size;
+    m_impl->updateTables();
+
+    return Status::OK;
+}
+
+unsigned int BilateralFilter::kernelSize() const {
+    return m_impl->kernelSize;
+}
+
+Status BilateralFilter::setSpatialSigma(float sigma) {
+    if (!(sigma > 0.0f)) {
+        LOG(WARNING) << "Invalid spatial sigma: " << sigma;
+        return Status::INVALID_ARGUMENT;
+    }
+
+    m_impl->spatialSigma = sigma;
+    m_impl->updateTables();
+
+    return Status::OK;
+}
+
+float BilateralFilter::spatialSigma() const { return m_impl->spatialSigma; }
+
+Status BilateralFilter::setRangeSigma(float sigma) {
+    if (!(sigma > 0.0f)) {
+        LOG(WARNING) << "Invalid range sigma: " << sigma;
+        return Status::INVALID_ARGUMENT;
+    }
+
+    m_impl->rangeSigma = sigma;
+    m_impl->updateTables();
+
+    return Status::OK;
+}
+
+float BilateralFilter::rangeSigma() const { return m_impl->rangeSigma; }
+
+Status BilateralFilter::setMaxDepth(uint16_t maxDepth) {
+    if (maxDepth == 0) {
+        LOG(WARNING) << "The maximum depth must be at least 1";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    m_impl->maxDepth = maxDepth;
+
+    return Status::OK;
+}
+
+uint16_t BilateralFilter::maxDepth() const { return m_impl->maxDepth; }
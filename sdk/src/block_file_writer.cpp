@@ -0,0 +1,208 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "block_file_writer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+// Writes still go through the page cache, the file is not opened for direct
+// I/O. Page aligned blocks only let the kernel copy whole pages out of them.
+static const size_t skBlockAlignment = 4096;
+
+static uint8_t *alignedAlloc(size_t size) {
+    void *ptr = nullptr;
+#if defined(_WIN32)
+    ptr = _aligned_malloc(size, skBlockAlignment);
+#else
+    if (posix_memalign(&ptr, skBlockAlignment, size) != 0) {
+        ptr = nullptr;
+    }
+#endif
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return static_cast<uint8_t *>(ptr);
+}
+
+static void alignedFree(uint8_t *ptr) {
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+BlockFileWriter::BlockFileWriter(size_t blockSize, size_t blockCount)
+    : m_blockSize(blockSize), m_blocks(blockCount) {}
+
+BlockFileWriter::~BlockFileWriter() { close(); }
+
+bool BlockFileWriter::open(const std::string &fileName) {
+    close();
+
+    m_file = std::fopen(fileName.c_str(), "wb");
+    if (!m_file) {
+        return false;
+    }
+    // Whole blocks are written at once, buffering would only copy them
+    std::setvbuf(m_file, nullptr, _IONBF, 0);
+
+    m_offset = 0;
+    m_current = nullptr;
+    m_stop = false;
+    m_failed = false;
+    m_freeBlocks.clear();
+    m_fullBlocks.clear();
+    for (Block &block : m_blocks) {
+        block.data = alignedAlloc(m_blockSize);
+        block.used = 0;
+        m_freeBlocks.push_back(&block);
+    }
+
+    m_thread = std::thread(&BlockFileWriter::writeBlocks, this);
+
+    return true;
+}
+
+bool BlockFileWriter::close() {
+    if (!m_file) {
+        return true;
+    }
+
+    if (m_current && m_current->used > 0) {
+        submitCurrentBlock();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+
+    if (std::fclose(m_file) != 0) {
+        m_failed = true;
+    }
+    m_file = nullptr;
+    m_current = nullptr;
+
+    // The blocks are only kept while a file is being written
+    m_freeBlocks.clear();
+    for (Block &block : m_blocks) {
+        alignedFree(block.data);
+        block.data = nullptr;
+    }
+
+    return !m_failed;
+}
+
+void BlockFileWriter::append(const void *data, size_t size) {
+    const uint8_t *src = static_cast<const uint8_t *>(data);
+
+    while (size > 0) {
+        if (!m_current) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_freeBlocks.empty(); });
+            m_current = m_freeBlocks.front();
+            m_freeBlocks.pop_front();
+        }
+
+        size_t count = std::min(size, m_blockSize - m_current->used);
+        memcpy(m_current->data + m_current->used, src, count);
+        m_current->used += count;
+        m_offset += count;
+        src += count;
+        size -= count;
+
+        if (m_current->used == m_blockSize) {
+            submitCurrentBlock();
+        }
+    }
+}
+
+uint64_t BlockFileWriter::available() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint64_t space = static_cast<uint64_t>(m_freeBlocks.size()) * m_blockSize;
+    if (m_current) {
+        space += m_blockSize - m_current->used;
+    }
+
+    return space;
+}
+
+bool BlockFileWriter::failed() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_failed;
+}
+
+void BlockFileWriter::submitCurrentBlock() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fullBlocks.push_back(m_current);
+    }
+    m_current = nullptr;
+    m_cv.notify_all();
+}
+
+void BlockFileWriter::writeBlocks() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_cv.wait(lock, [this]() { return m_stop || !m_fullBlocks.empty(); });
+        if (m_fullBlocks.empty()) {
+            break;
+        }
+
+        Block *block = m_fullBlocks.front();
+        m_fullBlocks.pop_front();
+        lock.unlock();
+
+        bool written =
+            std::fwrite(block->data, 1, block->used, m_file) == block->used;
+
+        lock.lock();
+        if (!written) {
+            m_failed = true;
+        }
+        block->used = 0;
+        m_freeBlocks.push_back(block);
+        m_cv.notify_all();
+    }
+}
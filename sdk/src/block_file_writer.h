@@ -0,0 +1,112 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef BLOCK_FILE_WRITER_H
+#define BLOCK_FILE_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! BlockFileWriter - Writes a file in large blocks from an I/O thread
+/*!
+    Data appended to the writer is copied into page aligned blocks of a fixed
+    size, which are allocated when a file is opened and freed when it is
+    closed. Full blocks are written by a dedicated thread, one write per block,
+    while the caller keeps filling the next free block. The thread sleeps
+    while there is nothing to write. Only blockCount blocks are allocated, so
+    when the storage is slower than the producer the free space runs out:
+    available() tells how much can be appended without waiting for it.
+    The methods are not meant to be called from several threads at once.
+*/
+class BlockFileWriter {
+  public:
+    BlockFileWriter(size_t blockSize, size_t blockCount);
+    ~BlockFileWriter();
+
+    BlockFileWriter(const BlockFileWriter &) = delete;
+    BlockFileWriter &operator=(const BlockFileWriter &) = delete;
+
+    //! open - Create the file (replacing any existing one) and start writing
+    bool open(const std::string &fileName);
+
+    //! close - Write what was appended and close the file
+    //! \return false if any of the writes failed
+    bool close();
+
+    bool isOpen() const { return m_file != nullptr; }
+
+    //! append - Copy data at the end of the file. Waits for the I/O thread
+    //! if more than available() bytes are appended.
+    void append(const void *data, size_t size);
+
+    //! available - Bytes that can be appended without waiting
+    uint64_t available();
+
+    //! offset - Bytes appended so far, which is the size of the file once
+    //! closed
+    uint64_t offset() const { return m_offset; }
+
+    //! failed - Tells if a write to the file failed
+    bool failed();
+
+  private:
+    struct Block {
+        uint8_t *data;
+        size_t used;
+    };
+
+    void writeBlocks();
+    void submitCurrentBlock();
+
+  private:
+    const size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    Block *m_current = nullptr;
+    uint64_t m_offset = 0;
+
+    std::FILE *m_file = nullptr;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Block *> m_freeBlocks;
+    std::deque<Block *> m_fullBlocks;
+    bool m_stop = false;
+    bool m_failed = false;
+};
+
+#endif // BLOCK_FILE_WRITER_H
@@ -30,14 +30,178 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include "calibration_96tof1.h"
+#include "calibration_cache.h"
+#include "cpu_features.h"
 
+#include <algorithm>
+#include <cstring>
 #include <glog/logging.h>
 #include <math.h>
 
+#if defined(ADITOF_X86)
+#include <immintrin.h>
+#endif
+
+#if defined(ADITOF_NEON)
+#include <arm_neon.h>
+#endif
+
 #define EEPROM_SIZE 131072
 
+// The calibration data is read in chunks of this size until the packets that
+// identify it, the key of the calibration cache, are found
+#define CALIBRATION_READ_CHUNK_SIZE 256
+
+// The raw depth values have 12 bits
+#define DEPTH_PIXEL_MASK 0x0FFF
+
+/* The fused calibration kernels compute, for each depth pixel:
+ * value = depthCache[pixel];
+ * if (value != range) value = min(value * geometryCache[i], range);
+ * which is what calibrateDepth() followed by calibrateCameraGeometry() do.
+ * The kernels process frame_size - frame_size % 8 pixels. The table lookups
+ * stay scalar: the depth cache fits in L1 and eight loads are faster than a
+ * hardware gather on most machines.
+ */
+
+static inline uint16_t calibratePixel(uint16_t pixel,
+                                      const uint16_t *depthCache,
+                                      float geometry, uint16_t range) {
+    uint16_t value = depthCache[pixel & DEPTH_PIXEL_MASK];
+    if (value != range) {
+        uint32_t corrected = static_cast<uint32_t>(value * geometry);
+        value = corrected > range ? range : static_cast<uint16_t>(corrected);
+    }
+    return value;
+}
+
+static void fusedCalibrationScalar(uint16_t *frame, uint32_t frame_size,
+                                   const uint16_t *depthCache,
+                                   const float *geometryCache,
+                                   uint16_t range) {
+    uint32_t end = frame_size - frame_size % 8;
+    for (uint32_t i = 0; i < end; ++i) {
+        frame[i] = calibratePixel(frame[i], depthCache, geometryCache[i], range);
+    }
+}
+
+#if defined(ADITOF_X86)
+// Requires range < 32768 because of the signed 16 bit saturation and min
+ADITOF_TARGET("sse2")
+static void fusedCalibrationSse2(uint16_t *frame, uint32_t frame_size,
+                                 const uint16_t *depthCache,
+                                 const float *geometryCache, uint16_t range) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rangeVec = _mm_set1_epi16(static_cast<short>(range));
+    uint16_t values[8];
+
+    uint32_t end = frame_size - frame_size % 8;
+    for (uint32_t i = 0; i < end; i += 8) {
+        for (int k = 0; k < 8; ++k) {
+            values[k] = depthCache[frame[i + k] & DEPTH_PIXEL_MASK];
+        }
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values));
+
+        __m128 lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)),
+                               _mm_loadu_ps(geometryCache + i));
+        __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)),
+                               _mm_loadu_ps(geometryCache + i + 4));
+        __m128i corrected = _mm_min_epi16(
+            _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi)),
+            rangeVec);
+
+        __m128i isRange = _mm_cmpeq_epi16(v, rangeVec);
+        __m128i result = _mm_or_si128(_mm_and_si128(isRange, rangeVec),
+                                      _mm_andnot_si128(isRange, corrected));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(frame + i), result);
+    }
+}
+
+ADITOF_TARGET("avx2")
+static void fusedCalibrationAvx2(uint16_t *frame, uint32_t frame_size,
+                                 const uint16_t *depthCache,
+                                 const float *geometryCache, uint16_t range) {
+    const __m256i rangeVec = _mm256_set1_epi32(range);
+    uint16_t values[8];
+
+    uint32_t end = frame_size - frame_size % 8;
+    for (uint32_t i = 0; i < end; i += 8) {
+        for (int k = 0; k < 8; ++k) {
+            values[k] = depthCache[frame[i + k] & DEPTH_PIXEL_MASK];
+        }
+        __m256i v = _mm256_cvtepu16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(values)));
+
+        __m256 product = _mm256_mul_ps(_mm256_cvtepi32_ps(v),
+                                       _mm256_loadu_ps(geometryCache + i));
+        __m256i corrected =
+            _mm256_min_epi32(_mm256_cvttps_epi32(product), rangeVec);
+        __m256i result = _mm256_blendv_epi8(corrected, rangeVec,
+                                            _mm256_cmpeq_epi32(v, rangeVec));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(frame + i),
+                         _mm_packus_epi32(_mm256_castsi256_si128(result),
+                                          _mm256_extracti128_si256(result, 1)));
+    }
+}
+#endif // ADITOF_X86
+
+#if defined(ADITOF_NEON)
+static void fusedCalibrationNeon(uint16_t *frame, uint32_t frame_size,
+                                 const uint16_t *depthCache,
+                                 const float *geometryCache, uint16_t range) {
+    const uint16x8_t rangeVec = vdupq_n_u16(range);
+    uint16_t values[8];
+
+    uint32_t end = frame_size - frame_size % 8;
+    for (uint32_t i = 0; i < end; i += 8) {
+        for (int k = 0; k < 8; ++k) {
+            values[k] = depthCache[frame[i + k] & DEPTH_PIXEL_MASK];
+        }
+        uint16x8_t v = vld1q_u16(values);
+
+        float32x4_t lo = vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))),
+                                   vld1q_f32(geometryCache + i));
+        float32x4_t hi = vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))),
+                                   vld1q_f32(geometryCache + i + 4));
+        uint16x8_t corrected =
+            vminq_u16(vcombine_u16(vmovn_u32(vcvtq_u32_f32(lo)),
+                                   vmovn_u32(vcvtq_u32_f32(hi))),
+                      rangeVec);
+
+        vst1q_u16(frame + i,
+                  vbslq_u16(vceqq_u16(v, rangeVec), rangeVec, corrected));
+    }
+}
+#endif // ADITOF_NEON
+
+static FusedCalibrationKernel selectFusedCalibrationKernel(int range) {
+    const aditof::CpuFeatures &features = aditof::cpuFeatures();
+
+#if defined(ADITOF_X86)
+    if (features.avx2) {
+        return fusedCalibrationAvx2;
+    }
+    if (features.sse2 && range < 32768) {
+        return fusedCalibrationSse2;
+    }
+#endif
+
+#if defined(ADITOF_NEON)
+    if (features.neon) {
+        return fusedCalibrationNeon;
+    }
+#endif
+
+    (void)features;
+    (void)range;
+    return fusedCalibrationScalar;
+}
+
 Calibration96Tof1::Calibration96Tof1()
-    : m_depth_cache(nullptr), m_geometry_cache(nullptr), m_range(16000) {
+    : m_depth_cache(nullptr), m_geometry_cache(nullptr), m_range(16000),
+      m_fusedKernel(selectFusedCalibrationKernel(m_range)) {
     std::unordered_map<float, param_struct> Header;
     Header[EEPROM_VERSION].value = {0};
     Header[EEPROM_VERSION].size =
@@ -108,6 +272,47 @@ aditof::Status Calibration96Tof1::displayCalMap() const {
     return Status::OK;
 }
 
+//! identifyingSize - The size of the data that identifies a calibration
+/*!
+identifyingSize - The calibration data up to the end of its header and camera
+intrinsic packets, which hold its EEPROM version, serial number, calibration
+date and checksum, identifies a calibration.
+\param data - The calibration data, without its size
+\param available - The size of the data read so far
+\param size - The size of the data
+\return A size larger than available when more data is needed to find it
+*/
+static size_t identifyingSize(const uint8_t *data, size_t available,
+                              size_t size) {
+    bool header = false;
+    bool intrinsic = false;
+    size_t j = 0;
+
+    while (j + 8 <= size) {
+        if (j + 8 > available) {
+            return j + 8;
+        }
+
+        float key;
+        float packetSize;
+        memcpy(&key, data + j, 4);
+        memcpy(&packetSize, data + j + 4, 4);
+        if (!(packetSize >= 0) || packetSize > size - j - 8) {
+            break;
+        }
+
+        j += 8 + static_cast<size_t>(packetSize);
+        header = header || key == HEADER;
+        intrinsic = intrinsic || key == CAMERA_INTRINSIC;
+        if (header && intrinsic) {
+            return j;
+        }
+    }
+
+    // Data without these packets is identified by all of it
+    return size;
+}
+
 //! SaveCalMap - Save the entire calibration map
 /*!
 SaveCalMap - Saves the entire calibration map as binary to a file.
@@ -136,15 +341,36 @@ Calibration96Tof1::saveCalMap(std::shared_ptr<aditof::DeviceInterface> device) {
     }
 
     float size = static_cast<float>(data.size() * sizeof(uint32_t));
-    device->writeEeprom((uint32_t)0, (uint8_t *)&size, (size_t)4);
-    device->writeEeprom((uint32_t)4, (uint8_t *)data.data(), (size_t)size);
+    Status status =
+        device->writeEeprom((uint32_t)0, (uint8_t *)&size, (size_t)4);
+    if (status == Status::OK) {
+        status = device->writeEeprom((uint32_t)4, (uint8_t *)data.data(),
+                                     (size_t)size);
+    }
+    if (status != Status::OK) {
+        LOG(WARNING) << "Failed to write to eeprom";
+        return status;
+    }
+
+    // Cache the new calibration, so that the next read finds it
+    std::vector<uint8_t> eeprom(4 + data.size() * sizeof(float));
+    memcpy(eeprom.data(), &size, 4);
+    memcpy(eeprom.data() + 4, data.data(), eeprom.size() - 4);
+    size_t keySize =
+        4 + identifyingSize(eeprom.data() + 4, eeprom.size() - 4,
+                            eeprom.size() - 4);
+    CalibrationCache().store(eeprom.data(), keySize, eeprom.data() + 4,
+                             eeprom.size() - 4);
 
     return Status::OK;
 }
 
 //! ReadCalMap - Read the entire calibration map
 /*!
-ReadCalMap - Read the entire calibration map from a binary file
+ReadCalMap - Read the entire calibration map from a binary file. The data is
+loaded from the calibration cache when its size, header and camera intrinsic
+packets, read from the EEPROM, match an entry, and read entirely from the
+EEPROM then cached otherwise.
 \device - Pointer to a device instance
 */
 aditof::Status
@@ -152,61 +378,111 @@ Calibration96Tof1::readCalMap(std::shared_ptr<aditof::DeviceInterface> device) {
     using namespace aditof;
 
     Status status = Status::OK;
-    uint8_t *data;
     float read_size = 100;
-    uint32_t j = 0;
-    float key;
 
+    // A short write ends any EEPROM write left incomplete on the device
     device->writeEeprom(EEPROM_SIZE - 5, (uint8_t *)&read_size, 4);
 
-    device->readEeprom(0, (uint8_t *)&read_size, 4);
+    // The size of the data and its first packets
+    uint8_t chunk[CALIBRATION_READ_CHUNK_SIZE];
+    status = device->readEeprom(0, chunk, CALIBRATION_READ_CHUNK_SIZE);
+    if (status != Status::OK) {
+        LOG(WARNING) << "Failed to read from eeprom";
+        return status;
+    }
+    memcpy(&read_size, chunk, 4);
     LOG(INFO) << "EEPROM calibration data size " << read_size << " bytes";
 
-    if (read_size > EEPROM_SIZE) {
+    if (!(read_size >= 0) || read_size > EEPROM_SIZE - 4) {
         LOG(WARNING) << "Invalid calibration data size";
         return Status::GENERIC_ERROR;
     }
 
-    data = (uint8_t *)malloc((size_t)read_size);
+    // The content of the EEPROM: the size of the data, then the data
+    size_t size = static_cast<size_t>(read_size);
+    std::vector<uint8_t> eeprom(4 + size);
+    size_t available = std::min(eeprom.size(), sizeof(chunk));
+    memcpy(eeprom.data(), chunk, available);
+
+    // The size and the packets identifying the calibration are the key of the
+    // cache
+    size_t keySize;
+    while ((keySize = 4 + identifyingSize(eeprom.data() + 4, available - 4,
+                                          size)) > available) {
+        size_t end = std::min(
+            std::max(keySize, available + CALIBRATION_READ_CHUNK_SIZE),
+            eeprom.size());
+        status = device->readEeprom(static_cast<uint32_t>(available),
+                                    eeprom.data() + available, end - available);
+        if (status != Status::OK) {
+            LOG(WARNING) << "Failed to read from eeprom";
+            return status;
+        }
+        available = end;
+    }
 
-    status = device->readEeprom(4, data, (size_t)read_size);
-    if (status != Status::OK) {
-        free(data);
-        LOG(WARNING) << "Failed to read from eeprom";
-        return status;
+    CalibrationCache cache;
+    std::unique_ptr<CalibrationCache::Entry> entry =
+        cache.load(eeprom.data(), keySize);
+    if (entry && entry->size() == size) {
+        LOG(INFO) << "Loaded the calibration data from the cache";
+        parseCalMap(entry->data(), entry->size());
+        return Status::OK;
+    }
+
+    if (available < eeprom.size()) {
+        status = device->readEeprom(static_cast<uint32_t>(available),
+                                    eeprom.data() + available,
+                                    eeprom.size() - available);
+        if (status != Status::OK) {
+            LOG(WARNING) << "Failed to read from eeprom";
+            return status;
+        }
     }
 
-    while (j < read_size) {
-        key = *(float *)(data + j);
+    parseCalMap(eeprom.data() + 4, size);
+    cache.store(eeprom.data(), keySize, eeprom.data() + 4, size);
+
+    return Status::OK;
+}
+
+//! parseCalMap - Parse the calibration map
+/*!
+parseCalMap - Fill the calibration map from its binary form
+\param data - The calibration data, without its size
+\param size - The size of the data
+*/
+void Calibration96Tof1::parseCalMap(const uint8_t *data, size_t size) {
+    uint32_t j = 0;
+    float key;
+
+    while (j < size) {
+        key = *(const float *)(data + j);
         j += 4;
 
         packet_struct sub_packet_map;
 
-        sub_packet_map.size = (uint32_t) * (float *)(data + j);
+        sub_packet_map.size = (uint32_t) * (const float *)(data + j);
         j += 4;
 
-        for (unsigned int i = 0;
-             i < sub_packet_map.size /
-                     (sizeof(float));) // Parse all the sub-packets
-        {
-            float parameter_key;
-            parameter_key =
-                *(float *)(data + j); // Parse key of parameter from sub packet
+        // Parse all the sub-packets
+        for (unsigned int i = 0; i < sub_packet_map.size / (sizeof(float));) {
+            // Parse key of parameter from sub packet
+            float parameter_key = *(const float *)(data + j);
             j += 4;
             i++;
+            // Parse size of parameter from sub packet
             sub_packet_map.packet[parameter_key].size =
-                (uint32_t) *
-                (float *)(data + j); // Parse size of parameter from sub packet
+                (uint32_t) * (const float *)(data + j);
             j += 4;
             i++;
 
             uint32_t number_elements =
                 sub_packet_map.packet[parameter_key].size / sizeof(float);
-            std::list<float> elements;
             for (unsigned int k = 0; k < number_elements; k++) {
+                // Parse value of parameter from sub packet
                 sub_packet_map.packet[parameter_key].value.push_back(
-                    *(float *)(data +
-                               j)); // Parse size of parameter from sub packet
+                    *(const float *)(data + j));
                 j += 4;
                 i++;
             }
@@ -214,10 +490,6 @@ Calibration96Tof1::readCalMap(std::shared_ptr<aditof::DeviceInterface> device) {
         m_calibration_map[key].size = sub_packet_map.size;
         m_calibration_map[key].packet = sub_packet_map.packet;
     }
-
-    free(data);
-
-    return Status::OK;
 }
 
 //! getAfeFirmware - Get the firmware for a mode
@@ -379,6 +651,7 @@ aditof::Status Calibration96Tof1::setMode(const std::string &mode, int range,
     }
     buildDepthCalibrationCache(gain, offset, pixelMaxValue, range);
     m_range = range;
+    m_fusedKernel = selectFusedCalibrationKernel(m_range);
 
     status = getIntrinsic(INTRINSIC, cameraMatrix);
     if (status != Status::OK) {
@@ -453,6 +726,34 @@ aditof::Status Calibration96Tof1::calibrateCameraGeometry(uint16_t *frame,
     return Status::OK;
 }
 
+//! calibrateDepthAndGeometry - Calibrate the depth data in a single pass
+/*!
+calibrateDepthAndGeometry - Does the same as calibrateDepth() followed by
+calibrateCameraGeometry() but reads and writes the frame only once
+\param frame - Buffer with the depth data, used to return the calibrated data
+\param frame_size - Number of samples in the frame data
+*/
+aditof::Status
+Calibration96Tof1::calibrateDepthAndGeometry(uint16_t *frame,
+                                             uint32_t frame_size) {
+    using namespace aditof;
+
+    if (!m_depth_cache || !m_geometry_cache) {
+        LOG(WARNING) << "Calibration mode is not set";
+        return Status::GENERIC_ERROR;
+    }
+
+    uint16_t range = static_cast<uint16_t>(m_range);
+    m_fusedKernel(frame, frame_size, m_depth_cache, m_geometry_cache, range);
+
+    for (uint32_t i = frame_size - frame_size % 8; i < frame_size; ++i) {
+        frame[i] =
+            calibratePixel(frame[i], m_depth_cache, m_geometry_cache[i], range);
+    }
+
+    return Status::OK;
+}
+
 // Create a cache to speed up depth calibration computation
 void Calibration96Tof1::buildDepthCalibrationCache(float gain, float offset,
                                                    int16_t maxPixelValue,
@@ -483,15 +784,15 @@ void Calibration96Tof1::buildGeometryCalibrationCache(
         delete[] m_geometry_cache;
     }
 
-    m_geometry_cache = new double[width * height];
+    m_geometry_cache = new float[width * height];
     for (uint16_t i = 0; i < height; i++) {
         for (uint16_t j = 0; j < width; j++) {
 
             double tanXAngle = (x0 - j) / fx;
             double tanYAngle = (y0 - i) / fy;
 
-            m_geometry_cache[i * width + j] =
-                1.0 / sqrt(1 + tanXAngle * tanXAngle + tanYAngle * tanYAngle);
+            m_geometry_cache[i * width + j] = static_cast<float>(
+                1.0 / sqrt(1 + tanXAngle * tanXAngle + tanYAngle * tanYAngle));
         }
     }
 }
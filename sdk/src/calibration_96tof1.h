@@ -80,6 +80,13 @@ struct packet_struct {
     std::unordered_map<float, param_struct> packet;
 };
 
+//! FusedCalibrationKernel - Does the depth and geometry calibration of a frame
+//! in one pass, with the instructions of the cpu
+typedef void (*FusedCalibrationKernel)(uint16_t *frame, uint32_t frame_size,
+                                       const uint16_t *depthCache,
+                                       const float *geometryCache,
+                                       uint16_t range);
+
 class Calibration96Tof1 {
   public:
     Calibration96Tof1();
@@ -99,8 +106,11 @@ class Calibration96Tof1 {
     aditof::Status calibrateDepth(uint16_t *frame, uint32_t frame_size);
     aditof::Status calibrateCameraGeometry(uint16_t *frame,
                                            uint32_t frame_size);
+    aditof::Status calibrateDepthAndGeometry(uint16_t *frame,
+                                             uint32_t frame_size);
 
   private:
+    void parseCalMap(const uint8_t *data, size_t size);
     float getMapSize(
         const std::unordered_map<float, packet_struct> &calibration_map) const;
     float
@@ -113,8 +123,10 @@ class Calibration96Tof1 {
   private:
     std::unordered_map<float, packet_struct> m_calibration_map;
     uint16_t *m_depth_cache;
-    double *m_geometry_cache;
+    float *m_geometry_cache;
     int m_range;
+    // Picked when the range is set, not for every frame
+    FusedCalibrationKernel m_fusedKernel;
 };
 
 #endif /*CALIBRATION_96TOF1_H*/
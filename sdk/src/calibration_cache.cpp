@@ -0,0 +1,225 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "calibration_cache.h"
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <glog/logging.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static const char skMagic[8] = {'A', 'D', 'I', 'C', 'A', 'L', '0', '1'};
+
+//! CalibrationCacheHeader - The start of a cache file, followed by the key and
+//! the data
+struct CalibrationCacheHeader {
+    char magic[8];
+    uint32_t keySize;
+    uint32_t dataSize;
+    uint64_t dataChecksum;
+};
+
+// 64 bit FNV-1a, for the file names and to detect damaged files
+static uint64_t fnv1a(const uint8_t *data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static bool makeDirectories(const std::string &path) {
+    for (size_t pos = 1; pos <= path.size(); ++pos) {
+        if (pos != path.size() && path[pos] != '/' && path[pos] != '\\') {
+            continue;
+        }
+        std::string parent = path.substr(0, pos);
+#if defined(_WIN32)
+        if (!CreateDirectoryA(parent.c_str(), nullptr) &&
+            GetLastError() != ERROR_ALREADY_EXISTS) {
+            // Drive letters can't be created
+            if (parent.back() != ':') {
+                return false;
+            }
+        }
+#else
+        if (mkdir(parent.c_str(), 0755) == -1 && errno != EEXIST) {
+            return false;
+        }
+#endif
+    }
+    return true;
+}
+
+class MappedEntry : public CalibrationCache::Entry {
+  public:
+    MappedFile file;
+
+    void setData(size_t offset, size_t size) {
+        m_data = file.data() + offset;
+        m_size = size;
+    }
+
+  public: // implements Entry
+    const uint8_t *data() const override { return m_data; }
+    size_t size() const override { return m_size; }
+
+  private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+CalibrationCache::CalibrationCache() : m_directory(defaultDirectory()) {}
+
+CalibrationCache::CalibrationCache(const std::string &directory)
+    : m_directory(directory) {}
+
+std::string CalibrationCache::defaultDirectory() {
+    const char *directory = std::getenv("ADITOF_CALIBRATION_CACHE");
+    if (directory) {
+        return directory;
+    }
+
+#if defined(_WIN32)
+    const char *localAppData = std::getenv("LOCALAPPDATA");
+    if (localAppData && *localAppData) {
+        return std::string(localAppData) + "\\aditof\\calibration";
+    }
+#else
+    const char *cacheHome = std::getenv("XDG_CACHE_HOME");
+    if (cacheHome && *cacheHome) {
+        return std::string(cacheHome) + "/aditof/calibration";
+    }
+    const char *home = std::getenv("HOME");
+    if (home && *home) {
+        return std::string(home) + "/.cache/aditof/calibration";
+    }
+#endif
+
+    return "";
+}
+
+std::string CalibrationCache::fileName(const uint8_t *key,
+                                       size_t keySize) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.cal",
+             static_cast<unsigned long long>(fnv1a(key, keySize)));
+
+    return m_directory + "/" + name;
+}
+
+std::unique_ptr<CalibrationCache::Entry>
+CalibrationCache::load(const uint8_t *key, size_t keySize) const {
+    if (m_directory.empty()) {
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedEntry> entry(new MappedEntry);
+    if (!entry->file.open(fileName(key, keySize))) {
+        return nullptr;
+    }
+
+    CalibrationCacheHeader header;
+    if (entry->file.size() < sizeof(header)) {
+        return nullptr;
+    }
+    memcpy(&header, entry->file.data(), sizeof(header));
+
+    size_t dataOffset = sizeof(header) + keySize;
+    if (memcmp(header.magic, skMagic, sizeof(skMagic)) != 0 ||
+        header.keySize != keySize ||
+        entry->file.size() != dataOffset + header.dataSize ||
+        memcmp(entry->file.data() + sizeof(header), key, keySize) != 0) {
+        return nullptr;
+    }
+
+    entry->setData(dataOffset, header.dataSize);
+    if (fnv1a(entry->data(), entry->size()) != header.dataChecksum) {
+        LOG(WARNING) << "Ignoring the damaged calibration cache file "
+                     << fileName(key, keySize);
+        return nullptr;
+    }
+
+    return std::unique_ptr<Entry>(entry.release());
+}
+
+bool CalibrationCache::store(const uint8_t *key, size_t keySize,
+                             const uint8_t *data, size_t size) const {
+    if (m_directory.empty()) {
+        return false;
+    }
+
+    if (!makeDirectories(m_directory)) {
+        LOG(WARNING) << "Failed to create the calibration cache directory "
+                     << m_directory;
+        return false;
+    }
+
+    CalibrationCacheHeader header;
+    memcpy(header.magic, skMagic, sizeof(skMagic));
+    header.keySize = static_cast<uint32_t>(keySize);
+    header.dataSize = static_cast<uint32_t>(size);
+    header.dataChecksum = fnv1a(data, size);
+
+    // Written aside and renamed, so that a reader never maps a partial file
+    std::string name = fileName(key, keySize);
+    std::string temporaryName = name + ".tmp";
+    std::FILE *file = std::fopen(temporaryName.c_str(), "wb");
+    if (!file) {
+        LOG(WARNING) << "Failed to create " << temporaryName;
+        return false;
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(key, 1, keySize, file) == keySize &&
+                   std::fwrite(data, 1, size, file) == size;
+    written = std::fclose(file) == 0 && written;
+
+#if defined(_WIN32)
+    // rename() doesn't replace existing files on Windows
+    std::remove(name.c_str());
+#endif
+    if (!written || std::rename(temporaryName.c_str(), name.c_str()) != 0) {
+        LOG(WARNING) << "Failed to write " << name;
+        std::remove(temporaryName.c_str());
+        return false;
+    }
+
+    return true;
+}
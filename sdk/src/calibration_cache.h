@@ -0,0 +1,88 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CALIBRATION_CACHE_H
+#define CALIBRATION_CACHE_H
+
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+//! CalibrationCache - Copies on disk of the calibration data of cameras
+/*!
+    Reading the calibration data from the EEPROM of a camera takes seconds
+    over USB. An entry of the cache is keyed by the part of that data which
+    identifies a calibration, chosen by the camera: for the 96tof1 its size
+    and the whole header and camera intrinsic packets, with the EEPROM
+    version, serial number, calibration date and checksum. One file per entry
+    holds a header, the key and the data. Files are checked against the key
+    and a checksum of the data, and read through a memory mapping.
+    The directory is given by the ADITOF_CALIBRATION_CACHE environment
+    variable, by default the cache directory of the user. An empty directory
+    disables the cache.
+*/
+class CalibrationCache {
+  public:
+    //! Entry - The data of an entry, mapped until the entry is destroyed
+    class Entry {
+      public:
+        virtual ~Entry() = default;
+        virtual const uint8_t *data() const = 0;
+        virtual size_t size() const = 0;
+    };
+
+  public:
+    //! CalibrationCache - Use the default directory
+    CalibrationCache();
+    explicit CalibrationCache(const std::string &directory);
+
+    //! defaultDirectory - The directory used when none is given
+    static std::string defaultDirectory();
+
+    //! load - The data stored for a key
+    //! \return nullptr if there is none or its file is damaged
+    std::unique_ptr<Entry> load(const uint8_t *key, size_t keySize) const;
+
+    //! store - Store the data of a key, replacing the previous one
+    //! \return false if the file could not be written
+    bool store(const uint8_t *key, size_t keySize, const uint8_t *data,
+               size_t size) const;
+
+  private:
+    std::string fileName(const uint8_t *key, size_t keySize) const;
+
+  private:
+    std::string m_directory;
+};
+
+#endif // CALIBRATION_CACHE_H
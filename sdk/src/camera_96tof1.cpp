@@ -30,6 +30,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include "camera_96tof1.h"
+#include "device_utils.h"
 
 #include <aditof/camera_96tof1_specifics.h>
 #include <aditof/device_interface.h>
@@ -39,6 +40,7 @@
 #include <algorithm>
 #include <array>
 #include <fstream>
+#include <functional>
 #include <glog/logging.h>
 #include <iterator>
 #include <map>
@@ -59,10 +61,15 @@ static const std::map<aditof::Revision, std::array<rangeStruct, 3>>
 
 static const std::string skCustomMode = "custom";
 
+// Matches the number of buffers requested from the video driver
+static const size_t skMaxPendingFrameRequests = 4;
+
 Camera96Tof1::Camera96Tof1(std::unique_ptr<aditof::DeviceInterface> device)
     : m_specifics(std::make_shared<aditof::Camera96Tof1Specifics>(
           aditof::Camera96Tof1Specifics(this))),
-      m_device(std::move(device)), m_devStarted(false) {
+      m_device(std::move(device)), m_devStarted(false),
+      m_undistortionEnabled(false),
+      m_depthInterpolation(aditof::DepthInterpolation::EDGE_AWARE) {
 
     // initialize range values with the default data for revision C
     auto cam96tof1Specifics =
@@ -110,6 +117,7 @@ aditof::Status Camera96Tof1::start() {
 }
 
 aditof::Status Camera96Tof1::stop() {
+    flushFrameRequests();
     // return m_device->stop(); // For now we keep the device open all the time
     return aditof::Status::OK;
 }
@@ -119,6 +127,8 @@ aditof::Status Camera96Tof1::setMode(const std::string &mode,
     using namespace aditof;
     Status status = Status::OK;
 
+    flushFrameRequests();
+
     // Set the values specific to the Revision requested
     auto cam96tof1Specifics =
         std::dynamic_pointer_cast<Camera96Tof1Specifics>(m_specifics);
@@ -240,6 +250,8 @@ aditof::Status Camera96Tof1::setFrameType(const std::string &frameType) {
     using namespace aditof;
     Status status = Status::OK;
 
+    flushFrameRequests();
+
     std::vector<FrameDetails> detailsList;
     status = m_device->getAvailableFrameTypes(detailsList);
     if (status != Status::OK) {
@@ -297,7 +309,7 @@ aditof::Status Camera96Tof1::getAvailableFrameTypes(
 }
 
 aditof::Status Camera96Tof1::requestFrame(aditof::Frame *frame,
-                                          aditof::FrameUpdateCallback /*cb*/) {
+                                          aditof::FrameUpdateCallback cb) {
     using namespace aditof;
     Status status = Status::OK;
 
@@ -308,6 +320,32 @@ aditof::Status Camera96Tof1::requestFrame(aditof::Frame *frame,
         frame->setDetails(m_details.frameType);
     }
 
+    if (cb) {
+        if (!m_capturePipeline) {
+            m_capturePipeline.reset(new FrameCapturePipeline(
+                std::bind(&Camera96Tof1::captureFrame, this,
+                          std::placeholders::_1),
+                std::bind(&Camera96Tof1::processFrame, this,
+                          std::placeholders::_1),
+                skMaxPendingFrameRequests));
+        }
+        return m_capturePipeline->enqueue(frame, cb);
+    }
+
+    flushFrameRequests();
+
+    status = captureFrame(frame);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    return processFrame(frame);
+}
+
+aditof::Status Camera96Tof1::captureFrame(aditof::Frame *frame) {
+    using namespace aditof;
+    Status status = Status::OK;
+
     uint16_t *frameDataLocation;
     frame->getData(FrameDataType::RAW, &frameDataLocation);
 
@@ -317,20 +355,71 @@ aditof::Status Camera96Tof1::requestFrame(aditof::Frame *frame,
         return status;
     }
 
+    // Devices that don't track the metadata leave it empty
+    FrameMetadata metadata;
+    m_device->getFrameMetadata(metadata);
+    frame->setMetadata(metadata);
+
+    return Status::OK;
+}
+
+aditof::Status Camera96Tof1::processFrame(aditof::Frame *frame) {
+    using namespace aditof;
+
+    FrameMetadata metadata;
+    frame->getMetadata(metadata);
+    uint64_t calibrationStart = monotonicTimestamp();
+
     if (m_details.mode != skCustomMode &&
         (m_details.frameType.type == "depth_ir" ||
          m_details.frameType.type == "depth_only")) {
-        m_calibration.calibrateDepth(frameDataLocation,
-                                     m_details.frameType.width *
-                                         m_details.frameType.height / 2);
-        m_calibration.calibrateCameraGeometry(
+        uint16_t *frameDataLocation;
+        frame->getData(FrameDataType::RAW, &frameDataLocation);
+
+        m_calibration.calibrateDepthAndGeometry(
             frameDataLocation,
             m_details.frameType.width * m_details.frameType.height / 2);
+
+        if (m_undistortionEnabled) {
+            undistortFrame(frameDataLocation);
+        }
     }
 
+    metadata.readyTimestamp = monotonicTimestamp();
+    metadata.calibrationTime =
+        static_cast<uint32_t>(metadata.readyTimestamp - calibrationStart);
+    frame->setMetadata(metadata);
+
     return Status::OK;
 }
 
+void Camera96Tof1::undistortFrame(uint16_t *data) {
+    using namespace aditof;
+
+    // The depth and IR planes are stacked, each one is half of the frame
+    unsigned int width = m_details.frameType.width;
+    unsigned int height = m_details.frameType.height / 2;
+
+    Status status =
+        m_undistortion.setIntrinsics(m_details.intrinsics, width, height);
+    if (status != Status::OK) {
+        return;
+    }
+
+    m_undistortion.undistortDepth(data,
+                                  static_cast<uint16_t>(m_details.maxDepth),
+                                  m_depthInterpolation);
+    if (m_details.frameType.type == "depth_ir") {
+        m_undistortion.undistortIr(data + width * height);
+    }
+}
+
+void Camera96Tof1::flushFrameRequests() {
+    if (m_capturePipeline) {
+        m_capturePipeline->flush();
+    }
+}
+
 aditof::Status Camera96Tof1::getDetails(aditof::CameraDetails &details) const {
     using namespace aditof;
     Status status = Status::OK;
@@ -33,7 +33,10 @@
 #define CAMERA_96TOF1_H
 
 #include "calibration_96tof1.h"
+#include "frame_capture_pipeline.h"
+#include "undistortion.h"
 
+#include <atomic>
 #include <memory>
 
 #include <aditof/camera.h>
@@ -61,12 +64,22 @@ class Camera96Tof1 : public aditof::Camera {
     std::shared_ptr<aditof::CameraSpecifics> getSpecifics();
     std::shared_ptr<aditof::DeviceInterface> getDevice();
 
+  private:
+    aditof::Status captureFrame(aditof::Frame *frame);
+    aditof::Status processFrame(aditof::Frame *frame);
+    void undistortFrame(uint16_t *data);
+    void flushFrameRequests();
+
   private:
     aditof::CameraDetails m_details;
     std::shared_ptr<aditof::CameraSpecifics> m_specifics;
     std::shared_ptr<aditof::DeviceInterface> m_device;
     bool m_devStarted;
     Calibration96Tof1 m_calibration;
+    std::unique_ptr<FrameCapturePipeline> m_capturePipeline;
+    Undistortion m_undistortion;
+    std::atomic<bool> m_undistortionEnabled;
+    std::atomic<aditof::DepthInterpolation> m_depthInterpolation;
 
   public:
     friend class aditof::Camera96Tof1Specifics;
@@ -136,3 +136,29 @@ Status Camera96Tof1Specifics::setIrGammaCorrection(float gamma) {
 float Camera96Tof1Specifics::irGammaCorrection() const {
     return m_irGammaCorrection;
 }
+
+Status Camera96Tof1Specifics::enableUndistortion(bool en) {
+    if (en && m_camera->m_details.intrinsics.distCoeffs.empty()) {
+        LOG(WARNING) << "No distortion coefficients, the camera must be "
+                        "initialized first";
+        return Status::UNAVAILABLE;
+    }
+
+    m_camera->m_undistortionEnabled = en;
+
+    return Status::OK;
+}
+
+bool Camera96Tof1Specifics::undistortionEnabled() const {
+    return m_camera->m_undistortionEnabled;
+}
+
+Status
+Camera96Tof1Specifics::setDepthInterpolation(DepthInterpolation interpolation) {
+    m_camera->m_depthInterpolation = interpolation;
+    return Status::OK;
+}
+
+DepthInterpolation Camera96Tof1Specifics::depthInterpolation() const {
+    return m_camera->m_depthInterpolation;
+}
@@ -30,6 +30,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include "camera_chicony.h"
+#include "device_utils.h"
 
 #include <aditof/device_interface.h>
 #include <aditof/frame.h>
@@ -38,6 +39,7 @@
 #include <algorithm>
 #include <array>
 #include <fstream>
+#include <functional>
 #include <glog/logging.h>
 #include <iterator>
 
@@ -45,6 +47,9 @@ using namespace std;
 
 static const std::string skCustomMode = "custom";
 
+// Matches the number of buffers requested from the video driver
+static const size_t skMaxPendingFrameRequests = 4;
+
 CameraChicony::CameraChicony(std::unique_ptr<aditof::DeviceInterface> device)
     : m_specifics(std::make_shared<aditof::CameraChiconySpecifics>(
           aditof::CameraChiconySpecifics(this))),
@@ -79,6 +84,7 @@ aditof::Status CameraChicony::start() {
 }
 
 aditof::Status CameraChicony::stop() {
+    flushFrameRequests();
     // return m_device->stop(); // For now we keep the device open all the time
     return aditof::Status::OK;
 }
@@ -88,6 +94,8 @@ aditof::Status CameraChicony::setMode(const std::string &mode,
     using namespace aditof;
     Status status = Status::OK;
 
+    flushFrameRequests();
+
     LOG(INFO) << "Chosen mode: " << mode.c_str();
     if ((mode != skCustomMode) ^ (modeFilename.empty())) {
         LOG(WARNING) << " mode must be set to: '" << skCustomMode
@@ -195,6 +203,8 @@ aditof::Status CameraChicony::setFrameType(const std::string &frameType) {
     using namespace aditof;
     Status status = Status::OK;
 
+    flushFrameRequests();
+
     std::vector<FrameDetails> detailsList;
     status = m_device->getAvailableFrameTypes(detailsList);
     if (status != Status::OK) {
@@ -252,7 +262,7 @@ aditof::Status CameraChicony::getAvailableFrameTypes(
 }
 
 aditof::Status CameraChicony::requestFrame(aditof::Frame *frame,
-                                           aditof::FrameUpdateCallback /*cb*/) {
+                                           aditof::FrameUpdateCallback cb) {
     using namespace aditof;
     Status status = Status::OK;
 
@@ -263,6 +273,32 @@ aditof::Status CameraChicony::requestFrame(aditof::Frame *frame,
         frame->setDetails(m_details.frameType);
     }
 
+    if (cb) {
+        if (!m_capturePipeline) {
+            m_capturePipeline.reset(new FrameCapturePipeline(
+                std::bind(&CameraChicony::captureFrame, this,
+                          std::placeholders::_1),
+                std::bind(&CameraChicony::processFrame, this,
+                          std::placeholders::_1),
+                skMaxPendingFrameRequests));
+        }
+        return m_capturePipeline->enqueue(frame, cb);
+    }
+
+    flushFrameRequests();
+
+    status = captureFrame(frame);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    return processFrame(frame);
+}
+
+aditof::Status CameraChicony::captureFrame(aditof::Frame *frame) {
+    using namespace aditof;
+    Status status = Status::OK;
+
     uint16_t *frameDataLocation;
     frame->getData(FrameDataType::RAW, &frameDataLocation);
 
@@ -272,9 +308,32 @@ aditof::Status CameraChicony::requestFrame(aditof::Frame *frame,
         return status;
     }
 
+    // Devices that don't track the metadata leave it empty
+    FrameMetadata metadata;
+    m_device->getFrameMetadata(metadata);
+    frame->setMetadata(metadata);
+
     return Status::OK;
 }
 
+aditof::Status CameraChicony::processFrame(aditof::Frame *frame) {
+    using namespace aditof;
+
+    // No processing is done on the host for this camera
+    FrameMetadata metadata;
+    frame->getMetadata(metadata);
+    metadata.readyTimestamp = monotonicTimestamp();
+    frame->setMetadata(metadata);
+
+    return Status::OK;
+}
+
+void CameraChicony::flushFrameRequests() {
+    if (m_capturePipeline) {
+        m_capturePipeline->flush();
+    }
+}
+
 aditof::Status CameraChicony::getDetails(aditof::CameraDetails &details) const {
     using namespace aditof;
     Status status = Status::OK;
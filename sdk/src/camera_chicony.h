@@ -32,6 +32,8 @@
 #ifndef CAMERA_CHICONY_H
 #define CAMERA_CHICONY_H
 
+#include "frame_capture_pipeline.h"
+
 #include <memory>
 
 #include <aditof/camera.h>
@@ -59,11 +61,17 @@ class CameraChicony : public aditof::Camera {
     std::shared_ptr<aditof::CameraSpecifics> getSpecifics();
     std::shared_ptr<aditof::DeviceInterface> getDevice();
 
+  private:
+    aditof::Status captureFrame(aditof::Frame *frame);
+    aditof::Status processFrame(aditof::Frame *frame);
+    void flushFrameRequests();
+
   private:
     aditof::CameraDetails m_details;
     std::shared_ptr<aditof::CameraSpecifics> m_specifics;
     std::shared_ptr<aditof::DeviceInterface> m_device;
     bool m_devStarted;
+    std::unique_ptr<FrameCapturePipeline> m_capturePipeline;
 
   public:
     friend class aditof::CameraChiconySpecifics;
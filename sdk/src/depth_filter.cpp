@@ -29,40 +29,35 @@
  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
-#ifndef SAFEQUEUE_H
-#define SAFEQUEUE_H
+#include "depth_filter.h"
 
-#include <condition_variable>
-#include <mutex>
-#include <queue>
+#include <glog/logging.h>
 
-template <class T>
-class SafeQueue {
-  public:
-    SafeQueue() {}
-    ~SafeQueue() {}
+using namespace aditof;
 
-    void enqueue(T element) {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_queue.push(element);
-        lock.unlock();
-        m_cv.notify_one();
+Status prepareDepthFilter(const Frame &inFrame, Frame &outFrame,
+                          const char *filterName, DepthPlane &depth) {
+    FrameDetails details;
+    inFrame.getDetails(details);
+    if (details.type != "depth_ir" && details.type != "depth_only") {
+        LOG(WARNING) << "The " << filterName
+                     << " filter needs frames with depth, not "
+                     << details.type;
+        return Status::INVALID_ARGUMENT;
     }
 
-    T dequeue() {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_cv.wait(lock, [&] { return !empty(); });
-        T element = m_queue.front();
-        m_queue.pop();
-        return element;
+    if (&inFrame != &outFrame) {
+        outFrame = inFrame;
     }
 
-    bool empty() const { return m_queue.empty(); }
-
-  private:
-    std::queue<T> m_queue;
-    std::mutex m_mutex;
-    std::condition_variable m_cv;
-};
+    // The depth is the first half of the frame
+    outFrame.getData(FrameDataType::DEPTH, &depth.data);
+    depth.width = details.width;
+    depth.height = details.height / 2;
+    depth.ir = nullptr;
+    if (details.type == "depth_ir") {
+        outFrame.getData(FrameDataType::IR, &depth.ir);
+    }
 
-#endif // SAFEQUEUE_H
+    return Status::OK;
+}
@@ -0,0 +1,62 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef DEPTH_FILTER_H
+#define DEPTH_FILTER_H
+
+#include <aditof/frame.h>
+#include <aditof/status_definitions.h>
+
+#include <stdint.h>
+
+//! DepthPlane - The depth image of a frame
+struct DepthPlane {
+    uint16_t *data;
+    unsigned int width;
+    unsigned int height;
+    // The IR image of the same size, null for depth_only frames
+    uint16_t *ir;
+};
+
+//! prepareDepthFilter - Copy the input of a filter to its output frame and
+//! find the depth image in it, which the filter then modifies
+/*!
+    \param inFrame - the input of the filter
+    \param outFrame - the output of the filter, can be inFrame
+    \param filterName - the name of the filter, for the log
+    \param[out] depth - the depth image of outFrame
+    \return Status::INVALID_ARGUMENT if the frame has no depth
+*/
+aditof::Status prepareDepthFilter(const aditof::Frame &inFrame,
+                                  aditof::Frame &outFrame,
+                                  const char *filterName, DepthPlane &depth);
+
+#endif // DEPTH_FILTER_H
@@ -31,6 +31,7 @@
  */
 #include "ethernet_device.h"
 #include "local_device.h"
+#include "replay_device.h"
 #include "usb_device.h"
 
 #include <aditof/device_factory.h>
@@ -51,6 +52,9 @@ DeviceFactory::buildDevice(const aditof::DeviceConstructionData &data) {
     case DeviceType::LOCAL: {
         return std::unique_ptr<DeviceInterface>(new LocalDevice(data));
     }
+    case DeviceType::REPLAY: {
+        return std::unique_ptr<DeviceInterface>(new ReplayDevice(data));
+    }
     }
 
     return nullptr;
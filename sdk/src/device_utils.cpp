@@ -0,0 +1,268 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "device_utils.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(ADITOF_X86)
+#include <immintrin.h>
+#endif
+
+#if defined(ADITOF_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/videodev2.h>
+#endif
+
+/* Every 3 bytes (a, b, c) of the packed data hold 2 pixels of 12 bits:
+ * p1 = (a << 4) | (c & 0x000F) and p2 = (b << 4) | ((c & 0x00F0) >> 4).
+ * The row unpackers below convert one row of packed data. They only read
+ * inside [source, source + len) and write len / 3 * 2 pixels.
+ */
+typedef void (*RowUnpacker)(const uint8_t *source, size_t len,
+                            uint16_t *destination);
+
+static void unpackRowScalar(const uint8_t *source, size_t len,
+                            uint16_t *destination) {
+    for (size_t i = 0; i + 2 < len; i += 3) {
+        uint16_t a = source[i];
+        uint16_t b = source[i + 1];
+        uint16_t c = source[i + 2];
+
+        *destination++ = (a << 4) | (c & 0x000F);
+        *destination++ = (b << 4) | ((c & 0x00F0) >> 4);
+    }
+}
+
+#if defined(ADITOF_X86)
+ADITOF_TARGET("sse2")
+static void unpackRowSse2(const uint8_t *source, size_t len,
+                          uint16_t *destination) {
+    const __m128i lowByte = _mm_set1_epi32(0x000000FF);
+    const __m128i lowNibble = _mm_set1_epi32(0x0000000F);
+    const __m128i secondHigh = _mm_set1_epi32(0x0FF00000);
+    const __m128i secondLow = _mm_set1_epi32(0x000F0000);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 12, destination += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+
+        // Move each group of 3 bytes in its own 32 bit lane: a | b << 8 | c << 16
+        __m128i g01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+        __m128i g23 =
+            _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+        __m128i g = _mm_unpacklo_epi64(g01, g23);
+
+        // Low half of the lane gets the first pixel, high half the second
+        __m128i p1 = _mm_or_si128(
+            _mm_slli_epi32(_mm_and_si128(g, lowByte), 4),
+            _mm_and_si128(_mm_srli_epi32(g, 16), lowNibble));
+        __m128i p2 =
+            _mm_or_si128(_mm_and_si128(_mm_slli_epi32(g, 12), secondHigh),
+                         _mm_and_si128(_mm_srli_epi32(g, 4), secondLow));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination),
+                         _mm_or_si128(p1, p2));
+    }
+
+    unpackRowScalar(source + i, len - i, destination);
+}
+
+ADITOF_TARGET("ssse3")
+static void unpackRowSsse3(const uint8_t *source, size_t len,
+                           uint16_t *destination) {
+    // Builds 16 bit words c | a << 8 for the first and c | b << 8 for the
+    // second pixel of each group of 3 bytes.
+    const __m128i shuffle =
+        _mm_setr_epi8(2, 0, 2, 1, 5, 3, 5, 4, 8, 6, 8, 7, 11, 9, 11, 10);
+    const __m128i shiftedMask =
+        _mm_setr_epi16(0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF,
+                       0x0FF0, 0x0FFF);
+    const __m128i nibbleMask = _mm_setr_epi16(0x000F, 0, 0x000F, 0, 0x000F,
+                                              0, 0x000F, 0);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 12, destination += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+        __m128i w = _mm_shuffle_epi8(v, shuffle);
+        __m128i p = _mm_or_si128(
+            _mm_and_si128(_mm_srli_epi16(w, 4), shiftedMask),
+            _mm_and_si128(w, nibbleMask));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination), p);
+    }
+
+    unpackRowScalar(source + i, len - i, destination);
+}
+
+ADITOF_TARGET("avx2")
+static void unpackRowAvx2(const uint8_t *source, size_t len,
+                          uint16_t *destination) {
+    const __m256i shuffle = _mm256_setr_epi8(
+        2, 0, 2, 1, 5, 3, 5, 4, 8, 6, 8, 7, 11, 9, 11, 10, 2, 0, 2, 1, 5, 3, 5,
+        4, 8, 6, 8, 7, 11, 9, 11, 10);
+    const __m256i shiftedMask = _mm256_setr_epi16(
+        0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF,
+        0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF);
+    const __m256i nibbleMask =
+        _mm256_setr_epi16(0x000F, 0, 0x000F, 0, 0x000F, 0, 0x000F, 0, 0x000F,
+                          0, 0x000F, 0, 0x000F, 0, 0x000F, 0);
+
+    size_t i = 0;
+    for (; i + 28 <= len; i += 24, destination += 16) {
+        // 12 bytes (8 pixels) in each 128 bit lane
+        __m128i lo =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+        __m128i hi =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i + 12));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        __m256i w = _mm256_shuffle_epi8(v, shuffle);
+        __m256i p = _mm256_or_si256(
+            _mm256_and_si256(_mm256_srli_epi16(w, 4), shiftedMask),
+            _mm256_and_si256(w, nibbleMask));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(destination), p);
+    }
+
+    unpackRowSsse3(source + i, len - i, destination);
+}
+#endif // ADITOF_X86
+
+#if defined(ADITOF_NEON)
+static void unpackRowNeon(const uint8_t *source, size_t len,
+                          uint16_t *destination) {
+    const uint16x8_t lowMask = vdupq_n_u16(0x000F);
+    const uint16x8_t highMask = vdupq_n_u16(0x00F0);
+
+    size_t i = 0;
+    for (; i + 24 <= len; i += 24, destination += 16) {
+        uint8x8x3_t data = vld3_u8(source + i);
+        uint16x8_t aData = vmovl_u8(data.val[0]);
+        uint16x8_t bData = vmovl_u8(data.val[1]);
+        uint16x8_t cData = vmovl_u8(data.val[2]);
+
+        uint16x8x2_t pixels;
+        pixels.val[0] =
+            vorrq_u16(vshlq_n_u16(aData, 4), vandq_u16(cData, lowMask));
+        pixels.val[1] = vorrq_u16(vshlq_n_u16(bData, 4),
+                                  vshrq_n_u16(vandq_u16(cData, highMask), 4));
+        vst2q_u16(destination, pixels);
+    }
+
+    unpackRowScalar(source + i, len - i, destination);
+}
+#endif // ADITOF_NEON
+
+static RowUnpacker selectRowUnpacker() {
+    const aditof::CpuFeatures &features = aditof::cpuFeatures();
+
+#if defined(ADITOF_X86)
+    if (features.avx2) {
+        return unpackRowAvx2;
+    }
+    if (features.ssse3) {
+        return unpackRowSsse3;
+    }
+    if (features.sse2) {
+        return unpackRowSse2;
+    }
+#endif
+
+#if defined(ADITOF_NEON)
+    if (features.neon) {
+        return unpackRowNeon;
+    }
+#endif
+
+    (void)features;
+    return unpackRowScalar;
+}
+
+namespace aditof {
+
+void deinterleave(const char *source, uint16_t *destination, size_t source_len,
+                  size_t dest_width, size_t dest_height) {
+    static const RowUnpacker unpackRow = selectRowUnpacker();
+
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(source);
+
+    if (dest_width == 668) {
+        // Each row of the source holds 672 pixels, the last 4 of them are
+        // overwritten by the beginning of the next row.
+        const size_t rowLen = 336 * 3;
+        uint16_t *dst = destination;
+        for (size_t i = 0; i < source_len; i += rowLen) {
+            unpackRow(src + i, std::min(rowLen, source_len - i), dst);
+            dst += dest_width;
+        }
+    } else {
+        // Rows of the source alternate between depth and IR
+        const size_t rowLen = dest_width * 3 / 2;
+        uint16_t *dst[2] = {destination,
+                            destination + dest_height * dest_width / 2};
+        size_t row = 0;
+        for (size_t i = 0; i < source_len; i += rowLen, ++row) {
+            uint16_t *&rowDst = dst[row % 2];
+            unpackRow(src + i, std::min(rowLen, source_len - i), rowDst);
+            rowDst += dest_width;
+        }
+    }
+}
+
+uint64_t monotonicTimestamp() {
+    using namespace std::chrono;
+
+    return static_cast<uint64_t>(
+        duration_cast<microseconds>(steady_clock::now().time_since_epoch())
+            .count());
+}
+
+#if defined(__linux__)
+void setBufferMetadata(const struct v4l2_buffer &buf, uint64_t requestTimestamp,
+                       FrameMetadata &metadata) {
+    metadata = FrameMetadata();
+    metadata.sequence = buf.sequence;
+    metadata.sensorTimestamp =
+        static_cast<uint64_t>(buf.timestamp.tv_sec) * 1000000 +
+        buf.timestamp.tv_usec;
+    metadata.dequeueTimestamp = monotonicTimestamp();
+    metadata.transferTime =
+        static_cast<uint32_t>(metadata.dequeueTimestamp - requestTimestamp);
+}
+#endif
+
+} // namespace aditof
@@ -32,59 +32,52 @@
 #ifndef DEVICE_UTILS_H
 #define DEVICE_UTILS_H
 
+#include <aditof/frame_definitions.h>
 #include <cstddef>
 #include <inttypes.h>
 
-namespace aditof {
-static void deinterleave(const char *source, uint16_t *destination,
-                         size_t source_len, size_t dest_width,
-                         size_t dest_height) {
-
-    size_t offset[2] = {0, dest_height * dest_width / 2};
-    size_t offset_idx = 0;
-    size_t j = 0;
-
-    if (dest_width == 668) {
-        for (size_t i = 0; i < source_len; i += 3) {
-            if ((i != 0) & (i % (336 * 3) == 0)) {
-                j -= 4;
-            }
+#if defined(__linux__)
+struct v4l2_buffer;
+#endif
 
-            destination[j] =
-                (((unsigned short)*(((unsigned char *)source) + i)) << 4) |
-                (((unsigned short)*(((unsigned char *)source) + i + 2)) &
-                 0x000F);
-            j++;
-
-            destination[j] =
-                (((unsigned short)*(((unsigned char *)source) + i + 1)) << 4) |
-                ((((unsigned short)*(((unsigned char *)source) + i + 2)) &
-                  0x00F0) >>
-                 4);
-            j++;
-        }
-    } else {
-        for (size_t i = 0; i < source_len; i += 3) {
+namespace aditof {
 
-            offset_idx = ((j / dest_width) % 2);
+//! deinterleave - Converts a frame from the packed sensor format to 16 bits
+/*!
+    Every 3 bytes of the source hold 2 pixels of 12 bits. For the depth_ir
+    layout the rows of the source alternate between depth and IR, and they
+    are split in the two halves of the destination. For the 668 wide raw
+    layout each source row carries 4 extra pixels which get overwritten by
+    the next row. Uses the widest SIMD extension of the running machine.
+    \param source - the packed data
+    \param destination - location where the unpacked frame is written
+    \param source_len - size of the packed data in bytes
+    \param dest_width - width of the frame
+    \param dest_height - height of the frame
+*/
+void deinterleave(const char *source, uint16_t *destination, size_t source_len,
+                  size_t dest_width, size_t dest_height);
 
-            destination[offset[offset_idx]] =
-                (((unsigned short)*(((unsigned char *)source) + i)) << 4) |
-                (((unsigned short)*(((unsigned char *)source) + i + 2)) &
-                 0x000F);
-            offset[offset_idx]++;
+//! monotonicTimestamp - Current time of the monotonic clock in microseconds
+/*!
+    This is the clock used by V4L2 for the timestamps of the buffers, so the
+    result can be compared with them. Used for the metadata of the frames.
+*/
+uint64_t monotonicTimestamp();
 
-            destination[offset[offset_idx]] =
-                (((unsigned short)*(((unsigned char *)source) + i + 1)) << 4) |
-                ((((unsigned short)*(((unsigned char *)source) + i + 2)) &
-                  0x00F0) >>
-                 4);
-            offset[offset_idx]++;
+#if defined(__linux__)
+//! setBufferMetadata - Fills the metadata of a frame dequeued from V4L2
+/*!
+    Takes the sequence and the capture time of the frame from the buffer, and
+    measures the transfer time from when the frame was asked for.
+    \param buf - the buffer dequeued from the driver
+    \param requestTimestamp - monotonicTimestamp() when the frame was asked for
+    \param metadata - gets the metadata of the frame
+*/
+void setBufferMetadata(const struct v4l2_buffer &buf, uint64_t requestTimestamp,
+                       FrameMetadata &metadata);
+#endif
 
-            j += 2;
-        }
-    }
-}
 } // namespace aditof
 
 #endif // DEVICE_UTILS_H
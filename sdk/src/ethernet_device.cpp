@@ -31,6 +31,8 @@
  */
 #include "ethernet_device.h"
 #include "device_utils.h"
+#include "frame_codec.h"
+#include "frame_stream.h"
 #include "network.h"
 
 #include <glog/logging.h>
@@ -49,6 +51,12 @@ struct EthernetDevice::ImplData {
     aditof::FrameDetails frameDetails_cache;
     std::unordered_map<std::string, CalibrationData> calibration_cache;
     std::mutex net_mutex;
+    bool streamingSupported = true;
+    bool streaming = false;
+    std::vector<char> frameBuffer;
+    uint16_t frameCodec = 0;
+    std::vector<uint8_t> decodeBuffer;
+    aditof::FrameMetadata metadata;
 };
 
 EthernetDevice::EthernetDevice(const aditof::DeviceConstructionData &data)
@@ -67,6 +75,8 @@ EthernetDevice::EthernetDevice(const aditof::DeviceConstructionData &data)
 
     net->send_buff.set_func_name("InstantiateDevice");
     net->send_buff.mutable_device_data()->set_driver_path(data.driverPath);
+    net->send_buff.add_frame_codecs(
+        static_cast<uint32_t>(aditof::FrameStreamCodec::DELTA12));
     net->send_buff.set_expect_reply(true);
 
     if (net->SendCommand() != 0) {
@@ -89,6 +99,9 @@ EthernetDevice::EthernetDevice(const aditof::DeviceConstructionData &data)
     } else {
         m_deviceDetails.sensorType =
             static_cast<aditof::SensorType>(net->recv_buff.sensor_type());
+        // Servers that don't compress frames leave the codec unset (RAW12)
+        m_implData->frameCodec =
+            static_cast<uint16_t>(net->recv_buff.frame_codec());
     }
 }
 
@@ -216,6 +229,10 @@ aditof::Status EthernetDevice::stop() {
         return Status::GENERIC_ERROR;
     }
 
+    // The server stops streaming before stopping the device
+    m_implData->streaming = false;
+    net->drop_frames();
+
     if (net->recv_buff.server_status() !=
         payload::ServerStatus::REQUEST_ACCEPTED) {
         LOG(WARNING) << "API execution on Target Failed";
@@ -307,6 +324,10 @@ EthernetDevice::setFrameType(const aditof::FrameDetails &details) {
         return Status::GENERIC_ERROR;
     }
 
+    // The server stops streaming before changing the frame type
+    m_implData->streaming = false;
+    net->drop_frames();
+
     if (net->recv_buff.server_status() !=
         payload::ServerStatus::REQUEST_ACCEPTED) {
         LOG(WARNING) << "API execution on Target Failed";
@@ -370,9 +391,50 @@ aditof::Status EthernetDevice::getFrame(uint16_t *buffer) {
         return Status::UNREACHABLE;
     }
 
+    // Subscribe once to the frames pushed by the server. Servers that don't
+    // know about streaming get asked for every frame instead.
+    if (m_implData->streamingSupported && !m_implData->streaming) {
+        net->send_buff.set_func_name("StartStreaming");
+        net->send_buff.set_expect_reply(true);
+
+        if (net->SendCommand() != 0) {
+            LOG(WARNING) << "Send Command Failed";
+            return Status::INVALID_ARGUMENT;
+        }
+
+        if (net->recv_server_data() != 0) {
+            LOG(WARNING) << "Receive Data Failed";
+            return Status::GENERIC_ERROR;
+        }
+
+        if (net->recv_buff.server_status() ==
+            payload::ServerStatus::REQUEST_UNKNOWN) {
+            LOG(INFO) << "Server does not support streaming, frames will be "
+                         "requested one at a time";
+            m_implData->streamingSupported = false;
+        } else if (net->recv_buff.server_status() !=
+                   payload::ServerStatus::REQUEST_ACCEPTED) {
+            LOG(WARNING) << "API execution on Target Failed";
+            return Status::GENERIC_ERROR;
+        } else {
+            Status status = static_cast<Status>(net->recv_buff.status());
+            if (status != Status::OK) {
+                LOG(WARNING) << "Failed to start streaming on target";
+                return status;
+            }
+            m_implData->streaming = true;
+        }
+    }
+
+    if (m_implData->streaming) {
+        return getStreamedFrame(buffer);
+    }
+
     net->send_buff.set_func_name("GetFrame");
     net->send_buff.set_expect_reply(true);
 
+    uint64_t requestTimestamp = monotonicTimestamp();
+
     if (net->SendCommand() != 0) {
         LOG(WARNING) << "Send Command Failed";
         return Status::INVALID_ARGUMENT;
@@ -395,16 +457,133 @@ aditof::Status EthernetDevice::getFrame(uint16_t *buffer) {
         return status;
     }
 
+    if (net->recv_buff.bytes_payload_size() < 1) {
+        LOG(WARNING) << "Received no frame";
+        return Status::GENERIC_ERROR;
+    }
+
+    // Servers that don't send the capture time of the frames leave it at 0
+    setFrameMetadata(net->recv_buff.frame_sequence(),
+                     net->recv_buff.frame_timestamp(), requestTimestamp);
+
+    return unpackFrame(net->recv_buff.bytes_payload(0).c_str(),
+                       net->recv_buff.bytes_payload(0).length(),
+                       m_implData->frameCodec, buffer);
+}
+
+aditof::Status EthernetDevice::getStreamedFrame(uint16_t *buffer) {
+    using namespace aditof;
+
+    std::vector<char> &frame = m_implData->frameBuffer;
+    uint64_t requestTimestamp = monotonicTimestamp();
+
+    if (m_implData->net->recv_frame(frame) != 0) {
+        LOG(WARNING) << "Receive Frame Failed";
+        return Status::GENERIC_ERROR;
+    }
+
+    FrameStreamHeader header;
+    if (frame.size() < sizeof(header)) {
+        LOG(WARNING) << "Received frame is too short: " << frame.size();
+        return Status::GENERIC_ERROR;
+    }
+    memcpy(&header, frame.data(), sizeof(header));
+
+    if (header.magic != FRAME_STREAM_MAGIC ||
+        header.version != FRAME_STREAM_VERSION ||
+        header.headerSize < sizeof(header) ||
+        header.headerSize + header.payloadSize > frame.size()) {
+        LOG(WARNING) << "Received frame has an invalid header";
+        return Status::GENERIC_ERROR;
+    }
+
+    if (header.width != m_implData->frameDetails_cache.width ||
+        header.height != m_implData->frameDetails_cache.height) {
+        LOG(WARNING) << "Received frame of " << header.width << "x"
+                     << header.height << " instead of "
+                     << m_implData->frameDetails_cache.width << "x"
+                     << m_implData->frameDetails_cache.height;
+        return Status::GENERIC_ERROR;
+    }
+
+    setFrameMetadata(header.sequence, header.timestamp, requestTimestamp);
+
+    return unpackFrame(frame.data() + header.headerSize, header.payloadSize,
+                       header.codec, buffer);
+}
+
+void EthernetDevice::setFrameMetadata(uint32_t sequence,
+                                      uint64_t sensorTimestamp,
+                                      uint64_t requestTimestamp) {
+    using namespace aditof;
+
+    FrameMetadata &metadata = m_implData->metadata;
+    metadata = FrameMetadata();
+    metadata.sequence = sequence;
+    metadata.sensorTimestamp = sensorTimestamp;
+    metadata.dequeueTimestamp = monotonicTimestamp();
+    metadata.transferTime =
+        static_cast<uint32_t>(metadata.dequeueTimestamp - requestTimestamp);
+}
+
+aditof::Status EthernetDevice::unpackFrame(const char *data, size_t size,
+                                           uint16_t codec, uint16_t *buffer) {
+    using namespace aditof;
+
+    // The sizes come from the network, so the frame must have the packed
+    // 12-bit size of the current frame type before being decoded
+    const FrameDetails &details = m_implData->frameDetails_cache;
+    const size_t frameSize =
+        static_cast<size_t>(details.width) * details.height * 3 / 2;
+
+    if (codec == static_cast<uint16_t>(FrameStreamCodec::DELTA12)) {
+        const uint8_t *compressed = reinterpret_cast<const uint8_t *>(data);
+        size_t rawSize = decompressedFrameSize(compressed, size);
+        if (rawSize != frameSize) {
+            LOG(WARNING) << "Received frame decompresses to " << rawSize
+                         << " bytes instead of " << frameSize;
+            return Status::GENERIC_ERROR;
+        }
+
+        std::vector<uint8_t> &raw = m_implData->decodeBuffer;
+        raw.resize(rawSize);
+        if (!decompressFrame(compressed, size, raw.data())) {
+            LOG(WARNING) << "Received frame could not be decompressed";
+            return Status::GENERIC_ERROR;
+        }
+
+        data = reinterpret_cast<const char *>(raw.data());
+        size = raw.size();
+    } else if (codec != static_cast<uint16_t>(FrameStreamCodec::RAW12)) {
+        LOG(WARNING) << "Received frame has unsupported encoding: " << codec;
+        return Status::GENERIC_ERROR;
+    }
+
+    if (size != frameSize) {
+        LOG(WARNING) << "Received frame of " << size << " bytes instead of "
+                     << frameSize;
+        return Status::GENERIC_ERROR;
+    }
+
     // Deinterleave data. The server sends raw data (uninterleaved) for better
     // throughput (raw data chunck is smaller, deinterleaving is usually slower
     // on target).
-
-    aditof::deinterleave(net->recv_buff.bytes_payload(0).c_str(), buffer,
-                         net->recv_buff.bytes_payload(0).length(),
+    aditof::deinterleave(data, buffer, size,
                          m_implData->frameDetails_cache.width,
                          m_implData->frameDetails_cache.height);
 
-    return status;
+    FrameMetadata &metadata = m_implData->metadata;
+    metadata.unpackTime =
+        static_cast<uint32_t>(monotonicTimestamp() - metadata.dequeueTimestamp);
+
+    return Status::OK;
+}
+
+aditof::Status
+EthernetDevice::getFrameMetadata(aditof::FrameMetadata &metadata) {
+    metadata = m_implData->metadata;
+
+    return aditof::Status::OK;
 }
 
 aditof::Status EthernetDevice::readEeprom(uint32_t address, uint8_t *data,
@@ -51,6 +51,7 @@ class EthernetDevice : public aditof::DeviceInterface {
     virtual aditof::Status setFrameType(const aditof::FrameDetails &details);
     virtual aditof::Status program(const uint8_t *firmware, size_t size);
     virtual aditof::Status getFrame(uint16_t *buffer);
+    virtual aditof::Status getFrameMetadata(aditof::FrameMetadata &metadata);
     virtual aditof::Status readEeprom(uint32_t address, uint8_t *data,
                                       size_t length);
     virtual aditof::Status writeEeprom(uint32_t address, const uint8_t *data,
@@ -64,6 +65,13 @@ class EthernetDevice : public aditof::DeviceInterface {
     virtual aditof::Status readLaserTemp(float &temperature);
     virtual aditof::Status getDetails(aditof::DeviceDetails &details) const;
 
+  private:
+    aditof::Status getStreamedFrame(uint16_t *buffer);
+    void setFrameMetadata(uint32_t sequence, uint64_t sensorTimestamp,
+                          uint64_t requestTimestamp);
+    aditof::Status unpackFrame(const char *data, size_t size, uint16_t codec,
+                               uint16_t *buffer);
+
   private:
     struct ImplData;
 
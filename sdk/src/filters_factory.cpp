@@ -29,7 +29,10 @@
  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#include <aditof/bilateral_filter.h>
 #include <aditof/filters_factory.h>
+#include <aditof/flying_pixel_filter.h>
+#include <aditof/median_filter.h>
 #include <aditof/variance_filter.h>
 
 using namespace aditof;
@@ -40,6 +43,18 @@ FiltersFactory::createFrameProcessor(FrameProcessorType type) const {
 
     case FrameProcessorType::VARIANCE_FILTER:
         return std::unique_ptr<FrameProcessor>(new VarianceFilter());
+
+    case FrameProcessorType::MEDIAN_FILTER_3X3:
+        return std::unique_ptr<FrameProcessor>(new MedianFilter(3));
+
+    case FrameProcessorType::MEDIAN_FILTER_5X5:
+        return std::unique_ptr<FrameProcessor>(new MedianFilter(5));
+
+    case FrameProcessorType::BILATERAL_FILTER:
+        return std::unique_ptr<FrameProcessor>(new BilateralFilter());
+
+    case FrameProcessorType::FLYING_PIXEL_FILTER:
+        return std::unique_ptr<FrameProcessor>(new FlyingPixelFilter());
     }
 
     return nullptr;
@@ -0,0 +1,377 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "cpu_features.h"
+#include "depth_filter.h"
+
+#include <aditof/flying_pixel_filter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <glog/logging.h>
+#include <vector>
+
+#if defined(ADITOF_X86)
+#include <emmintrin.h>
+#endif
+
+#if defined(ADITOF_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace aditof;
+
+//! FlyingPixelParams - The thresholds, in the form used by the kernels
+struct FlyingPixelParams {
+    // The depth jump threshold in Q16: a jump is above (depth * jump) >> 16
+    uint16_t jump;
+    uint16_t edgeIr;
+    uint16_t maxDepth;
+};
+
+/* The kernels filter one row of the depth image. up, row and down are the
+ * original depth of the row and of the rows around it, zeros outside of the
+ * image, ir its IR values and out where the filtered depth goes. The SIMD
+ * kernels test 8 pixels at once and give the same values as the scalar
+ * kernel, which only does the first and last pixels of the rows then.
+ */
+typedef void (*FlyingPixelRowKernel)(const uint16_t *up, const uint16_t *row,
+                                     const uint16_t *down, const uint16_t *ir,
+                                     uint16_t *out, unsigned int width,
+                                     const FlyingPixelParams &params);
+
+static inline bool isJump(uint16_t neighbor, uint16_t depth,
+                          uint16_t threshold) {
+    int difference = std::abs(static_cast<int>(neighbor) - depth);
+    return neighbor != 0 && difference > threshold;
+}
+
+static inline uint16_t filterPixel(uint16_t depth, uint16_t left,
+                                   uint16_t right, uint16_t up, uint16_t down,
+                                   uint16_t ir,
+                                   const FlyingPixelParams &params) {
+    if (depth == 0 || depth >= params.maxDepth) {
+        return depth;
+    }
+
+    uint16_t threshold =
+        static_cast<uint16_t>((static_cast<uint32_t>(depth) * params.jump) >>
+                              16);
+    bool jumpLeft = isJump(left, depth, threshold);
+    bool jumpRight = isJump(right, depth, threshold);
+    bool jumpUp = isJump(up, depth, threshold);
+    bool jumpDown = isJump(down, depth, threshold);
+
+    bool flying = (jumpLeft && jumpRight) || (jumpUp && jumpDown);
+    bool edge = jumpLeft || jumpRight || jumpUp || jumpDown;
+
+    return flying || (edge && ir < params.edgeIr) ? 0 : depth;
+}
+
+static inline void filterPixelAt(const uint16_t *up, const uint16_t *row,
+                                 const uint16_t *down, const uint16_t *ir,
+                                 uint16_t *out, unsigned int width,
+                                 unsigned int x,
+                                 const FlyingPixelParams &params) {
+    uint16_t left = x > 0 ? row[x - 1] : 0;
+    uint16_t right = x + 1 < width ? row[x + 1] : 0;
+    out[x] = filterPixel(row[x], left, right, up[x], down[x], ir[x], params);
+}
+
+static void flyingPixelRowScalar(const uint16_t *up, const uint16_t *row,
+                                 const uint16_t *down, const uint16_t *ir,
+                                 uint16_t *out, unsigned int width,
+                                 const FlyingPixelParams &params) {
+    for (unsigned int x = 0; x < width; ++x) {
+        filterPixelAt(up, row, down, ir, out, width, x, params);
+    }
+}
+
+#if defined(ADITOF_X86)
+ADITOF_TARGET("sse2")
+static inline __m128i jumpSse2(__m128i neighbor, __m128i depth,
+                               __m128i threshold, __m128i zero) {
+    __m128i difference = _mm_or_si128(_mm_subs_epu16(neighbor, depth),
+                                      _mm_subs_epu16(depth, neighbor));
+    // All ones where the difference is not above the threshold or the
+    // neighbor has no depth
+    __m128i noJump =
+        _mm_or_si128(_mm_cmpeq_epi16(_mm_subs_epu16(difference, threshold),
+                                     zero),
+                     _mm_cmpeq_epi16(neighbor, zero));
+    return _mm_andnot_si128(noJump, _mm_cmpeq_epi16(zero, zero));
+}
+
+ADITOF_TARGET("sse2")
+static void flyingPixelRowSse2(const uint16_t *up, const uint16_t *row,
+                               const uint16_t *down, const uint16_t *ir,
+                               uint16_t *out, unsigned int width,
+                               const FlyingPixelParams &params) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+    const __m128i jump = _mm_set1_epi16(static_cast<short>(params.jump));
+    const __m128i edgeIr = _mm_set1_epi16(static_cast<short>(params.edgeIr));
+    // Valid pixels are in [1, maxDepth - 1]: depth - 1 < maxDepth - 1, in the
+    // signed range SSE2 compares
+    const __m128i limit =
+        _mm_set1_epi16(static_cast<short>((params.maxDepth - 1) ^ 0x8000));
+
+    filterPixelAt(up, row, down, ir, out, width, 0, params);
+
+    unsigned int x = 1;
+    for (; x + 8 < width; x += 8) {
+        __m128i depth =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+        __m128i threshold = _mm_mulhi_epu16(depth, jump);
+
+        __m128i jumpLeft = jumpSse2(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x - 1)),
+            depth, threshold, zero);
+        __m128i jumpRight = jumpSse2(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x + 1)),
+            depth, threshold, zero);
+        __m128i jumpUp = jumpSse2(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(up + x)), depth,
+            threshold, zero);
+        __m128i jumpDown = jumpSse2(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(down + x)),
+            depth, threshold, zero);
+
+        __m128i flying = _mm_or_si128(_mm_and_si128(jumpLeft, jumpRight),
+                                      _mm_and_si128(jumpUp, jumpDown));
+        __m128i edge = _mm_or_si128(_mm_or_si128(jumpLeft, jumpRight),
+                                    _mm_or_si128(jumpUp, jumpDown));
+        // ir < edgeIr, when edgeIr - ir doesn't saturate to 0
+        __m128i lowIr = _mm_cmpeq_epi16(
+            _mm_cmpeq_epi16(
+                _mm_subs_epu16(edgeIr, _mm_loadu_si128(
+                                           reinterpret_cast<const __m128i *>(
+                                               ir + x))),
+                zero),
+            zero);
+        __m128i valid = _mm_cmplt_epi16(
+            _mm_xor_si128(_mm_sub_epi16(depth, one), bias), limit);
+
+        __m128i invalidate = _mm_and_si128(
+            _mm_or_si128(flying, _mm_and_si128(edge, lowIr)), valid);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x),
+                         _mm_andnot_si128(invalidate, depth));
+    }
+
+    for (; x < width; ++x) {
+        filterPixelAt(up, row, down, ir, out, width, x, params);
+    }
+}
+#endif // ADITOF_X86
+
+#if defined(ADITOF_NEON)
+static inline uint16x8_t jumpNeon(uint16x8_t neighbor, uint16x8_t depth,
+                                  uint16x8_t threshold) {
+    return vandq_u16(vcgtq_u16(vabdq_u16(neighbor, depth), threshold),
+                     vtstq_u16(neighbor, neighbor));
+}
+
+static void flyingPixelRowNeon(const uint16_t *up, const uint16_t *row,
+                               const uint16_t *down, const uint16_t *ir,
+                               uint16_t *out, unsigned int width,
+                               const FlyingPixelParams &params) {
+    const uint16x8_t one = vdupq_n_u16(1);
+    const uint16x4_t jump = vdup_n_u16(params.jump);
+    const uint16x8_t edgeIr = vdupq_n_u16(params.edgeIr);
+    // Valid pixels are in [1, maxDepth - 1]: depth - 1 < maxDepth - 1
+    const uint16x8_t limit = vdupq_n_u16(params.maxDepth - 1);
+
+    filterPixelAt(up, row, down, ir, out, width, 0, params);
+
+    unsigned int x = 1;
+    for (; x + 8 < width; x += 8) {
+        uint16x8_t depth = vld1q_u16(row + x);
+        uint16x8_t threshold = vcombine_u16(
+            vshrn_n_u32(vmull_u16(vget_low_u16(depth), jump), 16),
+            vshrn_n_u32(vmull_u16(vget_high_u16(depth), jump), 16));
+
+        uint16x8_t jumpLeft =
+            jumpNeon(vld1q_u16(row + x - 1), depth, threshold);
+        uint16x8_t jumpRight =
+            jumpNeon(vld1q_u16(row + x + 1), depth, threshold);
+        uint16x8_t jumpUp = jumpNeon(vld1q_u16(up + x), depth, threshold);
+        uint16x8_t jumpDown = jumpNeon(vld1q_u16(down + x), depth, threshold);
+
+        uint16x8_t flying = vorrq_u16(vandq_u16(jumpLeft, jumpRight),
+                                      vandq_u16(jumpUp, jumpDown));
+        uint16x8_t edge = vorrq_u16(vorrq_u16(jumpLeft, jumpRight),
+                                    vorrq_u16(jumpUp, jumpDown));
+        uint16x8_t lowIr = vcltq_u16(vld1q_u16(ir + x), edgeIr);
+        uint16x8_t valid = vcltq_u16(vsubq_u16(depth, one), limit);
+
+        uint16x8_t invalidate =
+            vandq_u16(vorrq_u16(flying, vandq_u16(edge, lowIr)), valid);
+        vst1q_u16(out + x, vbicq_u16(depth, invalidate));
+    }
+
+    for (; x < width; ++x) {
+        filterPixelAt(up, row, down, ir, out, width, x, params);
+    }
+}
+#endif // ADITOF_NEON
+
+static FlyingPixelRowKernel selectFlyingPixelKernel() {
+    const CpuFeatures &features = cpuFeatures();
+
+#if defined(ADITOF_X86)
+    if (features.sse2) {
+        return flyingPixelRowSse2;
+    }
+#endif
+
+#if defined(ADITOF_NEON)
+    if (features.neon) {
+        return flyingPixelRowNeon;
+    }
+#endif
+
+    (void)features;
+    return flyingPixelRowScalar;
+}
+
+class FlyingPixelFilterImpl {
+  public:
+    FlyingPixelFilterImpl()
+        : depthJumpThreshold(0.05f), edgeIrThreshold(0), maxDepth(0xFFFF),
+          kernel(selectFlyingPixelKernel()) {}
+
+  public:
+    float depthJumpThreshold;
+    uint16_t edgeIrThreshold;
+    uint16_t maxDepth;
+
+    // The original depth of the previous and current rows, the frame being
+    // overwritten as the rows are filtered, and a row of zeros for what is
+    // outside of the image
+    std::vector<uint16_t> previousRow;
+    std::vector<uint16_t> currentRow;
+    std::vector<uint16_t> zeros;
+
+    FlyingPixelRowKernel kernel;
+};
+
+FlyingPixelFilter::FlyingPixelFilter() : m_impl(new FlyingPixelFilterImpl) {}
+
+FlyingPixelFilter::~FlyingPixelFilter() = default;
+
+Status FlyingPixelFilter::processFrame(const Frame &inFrame, Frame &outFrame) {
+    DepthPlane depth;
+    Status status =
+        prepareDepthFilter(inFrame, outFrame, "flying pixel", depth);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    const unsigned int width = depth.width;
+    const unsigned int height = depth.height;
+    if (width == 0 || height == 0) {
+        return Status::OK;
+    }
+
+    FlyingPixelParams params;
+    params.jump = static_cast<uint16_t>(
+        std::min(std::lround(m_impl->depthJumpThreshold * 65536.0f), 65535L));
+    // Without IR, the test is disabled and the IR values are the zeros
+    params.edgeIr = depth.ir ? m_impl->edgeIrThreshold : 0;
+    params.maxDepth = m_impl->maxDepth;
+
+    m_impl->previousRow.resize(width);
+    m_impl->currentRow.resize(width);
+    m_impl->zeros.assign(width, 0);
+
+    const uint16_t *zeros = m_impl->zeros.data();
+    uint16_t *previous = m_impl->previousRow.data();
+    uint16_t *current = m_impl->currentRow.data();
+    std::copy(depth.data, depth.data + width, current);
+
+    for (unsigned int y = 0; y < height; ++y) {
+        uint16_t *out = depth.data + static_cast<size_t>(y) * width;
+        // The next row is not filtered yet
+        const uint16_t *down = y + 1 < height ? out + width : zeros;
+        const uint16_t *ir =
+            depth.ir ? depth.ir + static_cast<size_t>(y) * width : zeros;
+
+        m_impl->kernel(y > 0 ? previous : zeros, current, down, ir, out,
+                       width, params);
+
+        std::swap(previous, current);
+        if (y + 1 < height) {
+            std::copy(down, down + width, current);
+        }
+    }
+
+    return Status::OK;
+}
+
+Status FlyingPixelFilter::setDepthJumpThreshold(float threshold) {
+    if (!(threshold > 0.0f && threshold < 1.0f)) {
+        LOG(WARNING) << "The depth jump threshold must be in (0, 1): "
+                     << threshold;
+        return Status::INVALID_ARGUMENT;
+    }
+
+    m_impl->depthJumpThreshold = threshold;
+
+    return Status::OK;
+}
+
+float FlyingPixelFilter::depthJumpThreshold() const {
+    return m_impl->depthJumpThreshold;
+}
+
+Status FlyingPixelFilter::setEdgeIrThreshold(uint16_t threshold) {
+    m_impl->edgeIrThreshold = threshold;
+
+    return Status::OK;
+}
+
+uint16_t FlyingPixelFilter::edgeIrThreshold() const {
+    return m_impl->edgeIrThreshold;
+}
+
+Status FlyingPixelFilter::setMaxDepth(uint16_t maxDepth) {
+    if (maxDepth == 0) {
+        LOG(WARNING) << "The maximum depth must be at least 1";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    m_impl->maxDepth = maxDepth;
+
+    return Status::OK;
+}
+
+uint16_t FlyingPixelFilter::maxDepth() const { return m_impl->maxDepth; }
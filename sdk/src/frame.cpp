@@ -46,7 +46,12 @@ Frame::Frame(const Frame &op) : m_impl(new FrameImpl(*op.m_impl)) {}
 
 Frame &Frame::operator=(const Frame &op) {
     if (this != &op) {
-        m_impl.reset(new FrameImpl(*op.m_impl));
+        if (m_impl) {
+            // Reuses the data buffer when the sizes match
+            *m_impl = *op.m_impl;
+        } else {
+            m_impl.reset(new FrameImpl(*op.m_impl));
+        }
     }
 
     return *this;
@@ -60,6 +65,14 @@ Status Frame::getDetails(FrameDetails &details) const {
     return m_impl->getDetails(details);
 }
 
+Status Frame::setMetadata(const FrameMetadata &metadata) {
+    return m_impl->setMetadata(metadata);
+}
+
+Status Frame::getMetadata(FrameMetadata &metadata) const {
+    return m_impl->getMetadata(metadata);
+}
+
 Status Frame::getData(FrameDataType dataType, uint16_t **dataPtr) {
     return m_impl->getData(dataType, dataPtr);
 }
@@ -0,0 +1,111 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "frame_buffer_allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+static const size_t skCacheLineSize = 64;
+
+// How many released buffers of the same size are kept for reuse
+static const size_t skMaxFreeBuffersPerSize = 8;
+
+static uint16_t *alignedAlloc(size_t size) {
+    void *ptr = nullptr;
+#if defined(_WIN32)
+    ptr = _aligned_malloc(size, skCacheLineSize);
+#else
+    if (posix_memalign(&ptr, skCacheLineSize, size) != 0) {
+        ptr = nullptr;
+    }
+#endif
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return static_cast<uint16_t *>(ptr);
+}
+
+static void alignedFree(uint16_t *ptr) {
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+FrameBufferAllocator &FrameBufferAllocator::instance() {
+    // Never destroyed: frames with static storage duration may give their
+    // buffers back after the other statics are gone.
+    static FrameBufferAllocator *allocator = new FrameBufferAllocator;
+    return *allocator;
+}
+
+uint16_t *FrameBufferAllocator::allocate(size_t pixelCount) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_freeBuffers.find(pixelCount);
+        if (it != m_freeBuffers.end() && !it->second.empty()) {
+            uint16_t *buffer = it->second.back();
+            it->second.pop_back();
+            return buffer;
+        }
+    }
+
+    // Round up to whole cache lines. A zero sized frame gets one, so that it
+    // still has a valid pointer.
+    size_t size = std::max<size_t>(pixelCount * sizeof(uint16_t), 1);
+    size = (size + skCacheLineSize - 1) & ~(skCacheLineSize - 1);
+
+    return alignedAlloc(size);
+}
+
+void FrameBufferAllocator::release(uint16_t *buffer, size_t pixelCount) {
+    if (!buffer) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<uint16_t *> &freeBuffers = m_freeBuffers[pixelCount];
+        if (freeBuffers.size() < skMaxFreeBuffersPerSize) {
+            freeBuffers.push_back(buffer);
+            return;
+        }
+    }
+
+    alignedFree(buffer);
+}
@@ -0,0 +1,69 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef FRAME_BUFFER_ALLOCATOR_H
+#define FRAME_BUFFER_ALLOCATOR_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+//! FrameBufferAllocator - Recycles the pixel buffers of the frames
+/*!
+    FrameBufferAllocator hands out cache-line aligned pixel buffers and keeps
+    the released ones (up to a limit per size) to give them out again. Frames
+    that are created and destroyed at frame rate don't go through the system
+    allocator and don't page-fault on freshly mapped memory every time.
+*/
+class FrameBufferAllocator {
+  public:
+    static FrameBufferAllocator &instance();
+
+    //! allocate - Get a buffer that can hold the given number of pixels
+    uint16_t *allocate(size_t pixelCount);
+
+    //! release - Give back a buffer obtained with allocate()
+    void release(uint16_t *buffer, size_t pixelCount);
+
+  private:
+    FrameBufferAllocator() = default;
+
+    FrameBufferAllocator(const FrameBufferAllocator &) = delete;
+    FrameBufferAllocator &operator=(const FrameBufferAllocator &) = delete;
+
+  private:
+    std::mutex m_mutex;
+    std::map<size_t, std::vector<uint16_t *>> m_freeBuffers;
+};
+
+#endif // FRAME_BUFFER_ALLOCATOR_H
@@ -0,0 +1,148 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "frame_capture_pipeline.h"
+
+#include <glog/logging.h>
+
+FrameCapturePipeline::FrameCapturePipeline(Stage captureStage,
+                                           Stage processStage,
+                                           size_t maxPendingRequests)
+    : m_captureStage(captureStage), m_processStage(processStage),
+      m_maxPendingRequests(maxPendingRequests), m_pendingRequests(0),
+      m_callbackRunning(false), m_stopRequested(false) {
+    m_captureThread = std::thread(&FrameCapturePipeline::captureThread, this);
+    m_processThread = std::thread(&FrameCapturePipeline::processThread, this);
+}
+
+FrameCapturePipeline::~FrameCapturePipeline() {
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = true;
+    }
+    m_captureCv.notify_one();
+    m_processCv.notify_one();
+
+    m_captureThread.join();
+    m_processThread.join();
+}
+
+aditof::Status FrameCapturePipeline::enqueue(aditof::Frame *frame,
+                                             aditof::FrameUpdateCallback cb) {
+    using namespace aditof;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pendingRequests >= m_maxPendingRequests) {
+            LOG(WARNING) << "Too many frame requests in flight ("
+                         << m_pendingRequests << ")";
+            return Status::BUSY;
+        }
+        m_captureQueue.push_back({frame, cb, Status::OK});
+        ++m_pendingRequests;
+    }
+    m_captureCv.notify_one();
+
+    return Status::OK;
+}
+
+void FrameCapturePipeline::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idleCv.wait(lock, [this]() {
+        return m_pendingRequests == 0 && !m_callbackRunning;
+    });
+}
+
+void FrameCapturePipeline::captureThread() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_captureCv.wait(lock, [this]() {
+                return m_stopRequested || !m_captureQueue.empty();
+            });
+            if (m_captureQueue.empty()) {
+                return;
+            }
+            request = m_captureQueue.front();
+            m_captureQueue.pop_front();
+        }
+
+        request.status = m_captureStage(request.frame);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_processQueue.push_back(request);
+        }
+        m_processCv.notify_one();
+    }
+}
+
+void FrameCapturePipeline::processThread() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_processCv.wait(lock, [this]() {
+                return m_stopRequested || !m_processQueue.empty();
+            });
+            if (m_processQueue.empty()) {
+                return;
+            }
+            request = m_processQueue.front();
+            m_processQueue.pop_front();
+        }
+
+        if (request.status == aditof::Status::OK) {
+            request.status = m_processStage(request.frame);
+        }
+
+        // The request is done before its callback runs, so that the callback
+        // can make the next request
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_pendingRequests;
+            m_callbackRunning = true;
+        }
+
+        if (request.cb) {
+            request.cb(request.status, request.frame);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_callbackRunning = false;
+        }
+        m_idleCv.notify_all();
+    }
+}
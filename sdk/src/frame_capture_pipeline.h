@@ -0,0 +1,115 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef FRAME_CAPTURE_PIPELINE_H
+#define FRAME_CAPTURE_PIPELINE_H
+
+#include <aditof/camera_definitions.h>
+#include <aditof/frame.h>
+#include <aditof/status_definitions.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+//! FrameCapturePipeline - Serves non-blocking frame requests of a camera
+/*!
+    FrameCapturePipeline runs the capture stage (reading data from the device)
+    and the processing stage (e.g. calibration) of a frame request on two
+    internal threads. While a frame is being processed the next one is
+    already being read from the device, so the driver always has buffers to
+    fill. Requests are completed in the order they were made and the callback
+    of each request is called from the processing thread.
+*/
+class FrameCapturePipeline {
+  public:
+    typedef std::function<aditof::Status(aditof::Frame *)> Stage;
+
+    FrameCapturePipeline(Stage captureStage, Stage processStage,
+                         size_t maxPendingRequests);
+    ~FrameCapturePipeline();
+
+    FrameCapturePipeline(const FrameCapturePipeline &) = delete;
+    FrameCapturePipeline &operator=(const FrameCapturePipeline &) = delete;
+
+    //! enqueue - Queue a request to fill the given frame
+    /*!
+        \param frame - the frame to be filled. It must stay alive until the
+                       callback is called.
+        \param cb - the callback to be called once the frame is ready
+        \return Status::BUSY if maxPendingRequests requests are in flight. A
+                request is not in flight anymore when its callback is called,
+                so the callback can make the next request.
+    */
+    aditof::Status enqueue(aditof::Frame *frame,
+                           aditof::FrameUpdateCallback cb);
+
+    //! flush - Block until all the queued requests have been completed and
+    //! their callbacks returned
+    /*!
+        Must be called before reconfiguring the device so that the capture
+        thread does not access it concurrently. Must not be called from a
+        frame callback.
+    */
+    void flush();
+
+  private:
+    struct Request {
+        aditof::Frame *frame;
+        aditof::FrameUpdateCallback cb;
+        aditof::Status status;
+    };
+
+    void captureThread();
+    void processThread();
+
+  private:
+    Stage m_captureStage;
+    Stage m_processStage;
+    size_t m_maxPendingRequests;
+
+    std::mutex m_mutex;
+    std::condition_variable m_captureCv;
+    std::condition_variable m_processCv;
+    std::condition_variable m_idleCv;
+    std::deque<Request> m_captureQueue;
+    std::deque<Request> m_processQueue;
+    size_t m_pendingRequests;
+    bool m_callbackRunning;
+    bool m_stopRequested;
+
+    std::thread m_captureThread;
+    std::thread m_processThread;
+};
+
+#endif // FRAME_CAPTURE_PIPELINE_H
@@ -0,0 +1,231 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "frame_codec.h"
+
+#include <cstring>
+
+namespace {
+
+const size_t kHeaderSize = 8;
+const size_t kBlockLength = 16;
+
+inline void writeU32(uint8_t *p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+inline uint32_t readU32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Every 3 bytes a, b, c hold the pixels a << 4 | c & 0xF and b << 4 | c >> 4
+inline uint16_t getPixel(const uint8_t *packed, size_t i) {
+    const uint8_t *p = packed + (i >> 1) * 3;
+    if (i & 1) {
+        return (p[1] << 4) | (p[2] >> 4);
+    }
+    return (p[0] << 4) | (p[2] & 0x0F);
+}
+
+// Pixels must be set in order, the second pixel of a group completes its
+// third byte.
+inline void setPixel(uint8_t *packed, size_t i, uint16_t value) {
+    uint8_t *p = packed + (i >> 1) * 3;
+    if (i & 1) {
+        p[1] = static_cast<uint8_t>(value >> 4);
+        p[2] |= static_cast<uint8_t>((value & 0x0F) << 4);
+    } else {
+        p[0] = static_cast<uint8_t>(value >> 4);
+        p[2] = static_cast<uint8_t>(value & 0x0F);
+    }
+}
+
+// Maps the difference between two 12-bit pixels (modulo 4096) to 0..4095,
+// small differences of both signs giving small values
+inline uint16_t zigzag(uint16_t pixel, uint16_t previous) {
+    int delta = (pixel - previous) & 0x0FFF;
+    if (delta >= 0x0800) {
+        delta -= 0x1000;
+    }
+    return static_cast<uint16_t>((delta << 1) ^ (delta >> 31));
+}
+
+inline uint16_t unzigzag(uint16_t value, uint16_t previous) {
+    int delta = (value >> 1) ^ -(value & 1);
+    return static_cast<uint16_t>((previous + delta) & 0x0FFF);
+}
+
+inline unsigned bitWidth(uint16_t value) {
+    unsigned bits = 0;
+    while (value >> bits) {
+        ++bits;
+    }
+    return bits;
+}
+
+} // namespace
+
+namespace aditof {
+
+size_t compressedFrameBound(size_t sourceLen, size_t rowLength) {
+    size_t pixels = sourceLen / 3 * 2;
+    size_t rows = rowLength ? (pixels + rowLength - 1) / rowLength : 1;
+    size_t blocks = pixels / kBlockLength + rows;
+
+    // A block never takes more than 12 bits per pixel, plus the byte holding
+    // its bit width and the byte its last bits are rounded up to
+    return kHeaderSize + sourceLen + 2 * blocks;
+}
+
+size_t compressFrame(const uint8_t *source, size_t sourceLen, size_t rowLength,
+                     uint8_t *destination) {
+    size_t pixels = sourceLen / 3 * 2;
+    if (rowLength == 0 || rowLength > pixels) {
+        rowLength = pixels ? pixels : 1;
+    }
+
+    writeU32(destination, static_cast<uint32_t>(sourceLen));
+    writeU32(destination + 4, static_cast<uint32_t>(rowLength));
+    uint8_t *out = destination + kHeaderSize;
+
+    uint16_t values[kBlockLength];
+
+    for (size_t row = 0; row < pixels; row += rowLength) {
+        size_t rowEnd = row + rowLength < pixels ? row + rowLength : pixels;
+        uint16_t previous = 0;
+
+        for (size_t block = row; block < rowEnd; block += kBlockLength) {
+            size_t n = rowEnd - block < kBlockLength ? rowEnd - block
+                                                     : kBlockLength;
+            uint16_t all = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint16_t pixel = getPixel(source, block + i);
+                values[i] = zigzag(pixel, previous);
+                all |= values[i];
+                previous = pixel;
+            }
+
+            unsigned bits = bitWidth(all);
+            *out++ = static_cast<uint8_t>(bits);
+
+            uint32_t acc = 0;
+            unsigned accBits = 0;
+            for (size_t i = 0; bits && i < n; ++i) {
+                acc |= static_cast<uint32_t>(values[i]) << accBits;
+                accBits += bits;
+                while (accBits >= 8) {
+                    *out++ = static_cast<uint8_t>(acc);
+                    acc >>= 8;
+                    accBits -= 8;
+                }
+            }
+            if (accBits) {
+                *out++ = static_cast<uint8_t>(acc);
+            }
+        }
+    }
+
+    // Bytes that don't make a whole group of 2 pixels are copied as they are
+    size_t tail = sourceLen - pixels / 2 * 3;
+    memcpy(out, source + sourceLen - tail, tail);
+    out += tail;
+
+    return static_cast<size_t>(out - destination);
+}
+
+size_t decompressedFrameSize(const uint8_t *source, size_t sourceLen) {
+    if (sourceLen < kHeaderSize || readU32(source + 4) == 0) {
+        return 0;
+    }
+
+    return readU32(source);
+}
+
+bool decompressFrame(const uint8_t *source, size_t sourceLen,
+                     uint8_t *destination) {
+    size_t destinationLen = decompressedFrameSize(source, sourceLen);
+    if (destinationLen == 0) {
+        return false;
+    }
+
+    size_t rowLength = readU32(source + 4);
+    size_t pixels = destinationLen / 3 * 2;
+    const uint8_t *in = source + kHeaderSize;
+    const uint8_t *end = source + sourceLen;
+
+    for (size_t row = 0; row < pixels; row += rowLength) {
+        size_t rowEnd = row + rowLength < pixels ? row + rowLength : pixels;
+        uint16_t previous = 0;
+
+        for (size_t block = row; block < rowEnd; block += kBlockLength) {
+            size_t n = rowEnd - block < kBlockLength ? rowEnd - block
+                                                     : kBlockLength;
+            if (in == end) {
+                return false;
+            }
+            unsigned bits = *in++;
+            if (bits > 12 ||
+                static_cast<size_t>(end - in) < (n * bits + 7) / 8) {
+                return false;
+            }
+
+            uint32_t acc = 0;
+            unsigned accBits = 0;
+            const uint16_t mask = static_cast<uint16_t>((1u << bits) - 1);
+            for (size_t i = 0; i < n; ++i) {
+                while (accBits < bits) {
+                    acc |= static_cast<uint32_t>(*in++) << accBits;
+                    accBits += 8;
+                }
+                uint16_t value = acc & mask;
+                acc >>= bits;
+                accBits -= bits;
+
+                previous = unzigzag(value, previous);
+                setPixel(destination, block + i, previous);
+            }
+        }
+    }
+
+    size_t tail = destinationLen - pixels / 2 * 3;
+    if (static_cast<size_t>(end - in) != tail) {
+        return false;
+    }
+    memcpy(destination + destinationLen - tail, in, tail);
+
+    return true;
+}
+
+} // namespace aditof
@@ -30,6 +30,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include "frame_impl.h"
+#include "frame_buffer_allocator.h"
 #include <aditof/frame_operations.h>
 
 #include <cmath>
@@ -41,30 +42,28 @@ FrameImpl::FrameImpl()
     : m_details{0, 0, ""}, m_depthData(nullptr), m_irData(nullptr),
       m_rawData(nullptr) {}
 
-FrameImpl::~FrameImpl() {
-    if (m_rawData) {
-        delete[] m_rawData;
-        m_rawData = nullptr;
-    }
-}
+FrameImpl::~FrameImpl() { freeFrameData(); }
 
-FrameImpl::FrameImpl(const FrameImpl &op) {
+FrameImpl::FrameImpl(const FrameImpl &op)
+    : m_details{0, 0, ""}, m_depthData(nullptr), m_irData(nullptr),
+      m_rawData(nullptr) {
     allocFrameData(op.m_details);
     memcpy(m_rawData, op.m_rawData,
            sizeof(uint16_t) * op.m_details.width * op.m_details.height);
     m_details = op.m_details;
+    m_metadata = op.m_metadata;
 }
 
 FrameImpl &FrameImpl::operator=(const FrameImpl &op) {
     if (this != &op) {
-        if (m_rawData) {
-            delete[] m_rawData;
-            m_rawData = nullptr;
+        if (pixelCount(m_details) != pixelCount(op.m_details)) {
+            freeFrameData();
+            allocFrameData(op.m_details);
         }
-        allocFrameData(op.m_details);
         memcpy(m_rawData, op.m_rawData,
                sizeof(uint16_t) * op.m_details.width * op.m_details.height);
         m_details = op.m_details;
+        m_metadata = op.m_metadata;
     }
 
     return *this;
@@ -79,11 +78,12 @@ aditof::Status FrameImpl::setDetails(const aditof::FrameDetails &details) {
         return status;
     }
 
-    if (m_rawData) {
-        delete[] m_rawData;
-        m_rawData = nullptr;
+    if (pixelCount(m_details) != pixelCount(details)) {
+        freeFrameData();
+        allocFrameData(details);
+    } else {
+        m_irData = m_rawData + pixelCount(details) / 2;
     }
-    allocFrameData(details);
     m_details = details;
 
     return status;
@@ -95,6 +95,18 @@ aditof::Status FrameImpl::getDetails(aditof::FrameDetails &details) const {
     return aditof::Status::OK;
 }
 
+aditof::Status FrameImpl::setMetadata(const aditof::FrameMetadata &metadata) {
+    m_metadata = metadata;
+
+    return aditof::Status::OK;
+}
+
+aditof::Status FrameImpl::getMetadata(aditof::FrameMetadata &metadata) const {
+    metadata = m_metadata;
+
+    return aditof::Status::OK;
+}
+
 aditof::Status FrameImpl::getData(aditof::FrameDataType dataType,
                                   uint16_t **dataPtr) {
     using namespace aditof;
@@ -118,7 +130,21 @@ aditof::Status FrameImpl::getData(aditof::FrameDataType dataType,
 }
 
 void FrameImpl::allocFrameData(const aditof::FrameDetails &details) {
-    m_rawData = new uint16_t[details.width * details.height];
+    m_rawData = FrameBufferAllocator::instance().allocate(pixelCount(details));
     m_depthData = m_rawData;
-    m_irData = m_rawData + (details.width * details.height) / 2;
+    m_irData = m_rawData + pixelCount(details) / 2;
+}
+
+void FrameImpl::freeFrameData() {
+    if (m_rawData) {
+        FrameBufferAllocator::instance().release(m_rawData,
+                                                 pixelCount(m_details));
+        m_rawData = nullptr;
+        m_depthData = nullptr;
+        m_irData = nullptr;
+    }
+}
+
+size_t FrameImpl::pixelCount(const aditof::FrameDetails &details) {
+    return static_cast<size_t>(details.width) * details.height;
 }
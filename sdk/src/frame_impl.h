@@ -35,6 +35,7 @@
 #include <aditof/frame_definitions.h>
 #include <aditof/status_definitions.h>
 
+#include <cstddef>
 #include <stdint.h>
 
 class FrameImpl {
@@ -47,13 +48,18 @@ class FrameImpl {
   public: // from TofFrame
     aditof::Status setDetails(const aditof::FrameDetails &details);
     aditof::Status getDetails(aditof::FrameDetails &details) const;
+    aditof::Status setMetadata(const aditof::FrameMetadata &metadata);
+    aditof::Status getMetadata(aditof::FrameMetadata &metadata) const;
     aditof::Status getData(aditof::FrameDataType dataType, uint16_t **dataPtr);
 
   private:
     void allocFrameData(const aditof::FrameDetails &details);
+    void freeFrameData();
+    static size_t pixelCount(const aditof::FrameDetails &details);
 
   private:
     aditof::FrameDetails m_details;
+    aditof::FrameMetadata m_metadata;
     uint16_t *m_depthData;
     uint16_t *m_irData;
     uint16_t *m_rawData;
@@ -0,0 +1,81 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "frame_lease_impl.h"
+#include <aditof/frame_lease.h>
+
+#include <glog/logging.h>
+
+namespace aditof {
+
+FrameLease::FrameLease() = default;
+
+FrameLease::FrameLease(std::unique_ptr<FrameLeaseImpl> impl)
+    : m_impl(std::move(impl)) {}
+
+FrameLease::~FrameLease() = default;
+
+FrameLease::FrameLease(FrameLease &&) noexcept = default;
+
+FrameLease &FrameLease::operator=(FrameLease &&) noexcept = default;
+
+bool FrameLease::isValid() const { return m_impl != nullptr; }
+
+Status FrameLease::getDetails(FrameDetails &details) const {
+    if (!m_impl) {
+        LOG(WARNING) << "No frame is leased";
+        return Status::UNAVAILABLE;
+    }
+
+    return m_impl->getDetails(details);
+}
+
+Status FrameLease::getPackedData(const uint8_t **data, size_t &size) const {
+    if (!m_impl) {
+        LOG(WARNING) << "No frame is leased";
+        return Status::UNAVAILABLE;
+    }
+
+    return m_impl->getPackedData(data, size);
+}
+
+Status FrameLease::getData(FrameDataType dataType, const uint16_t **dataPtr) {
+    if (!m_impl) {
+        LOG(WARNING) << "No frame is leased";
+        return Status::UNAVAILABLE;
+    }
+
+    return m_impl->getData(dataType, dataPtr);
+}
+
+void FrameLease::release() { m_impl.reset(); }
+
+} // namespace aditof
@@ -0,0 +1,92 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "frame_lease_impl.h"
+
+#include <glog/logging.h>
+
+FrameLeaseImpl::FrameLeaseImpl(const aditof::FrameDetails &details,
+                               const uint8_t *data, size_t size,
+                               UnpackFunction unpack, ReleaseFunction release)
+    : m_details(details), m_data(data), m_size(size), m_unpack(unpack),
+      m_release(release) {}
+
+FrameLeaseImpl::~FrameLeaseImpl() {
+    if (m_release) {
+        m_release();
+    }
+}
+
+aditof::Status FrameLeaseImpl::getDetails(aditof::FrameDetails &details) const {
+    details = m_details;
+
+    return aditof::Status::OK;
+}
+
+aditof::Status FrameLeaseImpl::getPackedData(const uint8_t **data,
+                                             size_t &size) const {
+    *data = m_data;
+    size = m_size;
+
+    return aditof::Status::OK;
+}
+
+aditof::Status FrameLeaseImpl::getData(aditof::FrameDataType dataType,
+                                       const uint16_t **dataPtr) {
+    using namespace aditof;
+
+    if (m_unpackedData.empty()) {
+        if (!m_unpack) {
+            LOG(WARNING) << "Leased frame cannot be unpacked";
+            return Status::UNAVAILABLE;
+        }
+        m_unpackedData.resize(m_details.width * m_details.height);
+        m_unpack(m_data, m_size, m_unpackedData.data());
+    }
+
+    switch (dataType) {
+    case FrameDataType::RAW: {
+        *dataPtr = m_unpackedData.data();
+        break;
+    }
+    case FrameDataType::IR: {
+        *dataPtr =
+            m_unpackedData.data() + (m_details.width * m_details.height) / 2;
+        break;
+    }
+    case FrameDataType::DEPTH: {
+        *dataPtr = m_unpackedData.data();
+        break;
+    }
+    }
+
+    return Status::OK;
+}
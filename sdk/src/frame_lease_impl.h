@@ -0,0 +1,72 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef FRAME_LEASE_IMPL
+#define FRAME_LEASE_IMPL
+
+#include <aditof/frame_definitions.h>
+#include <aditof/status_definitions.h>
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+class FrameLeaseImpl {
+  public:
+    typedef std::function<void(const uint8_t *data, size_t size,
+                               uint16_t *buffer)>
+        UnpackFunction;
+    typedef std::function<void()> ReleaseFunction;
+
+    FrameLeaseImpl(const aditof::FrameDetails &details, const uint8_t *data,
+                   size_t size, UnpackFunction unpack,
+                   ReleaseFunction release);
+    ~FrameLeaseImpl();
+
+    FrameLeaseImpl(const FrameLeaseImpl &) = delete;
+    FrameLeaseImpl &operator=(const FrameLeaseImpl &) = delete;
+
+  public: // from FrameLease
+    aditof::Status getDetails(aditof::FrameDetails &details) const;
+    aditof::Status getPackedData(const uint8_t **data, size_t &size) const;
+    aditof::Status getData(aditof::FrameDataType dataType,
+                           const uint16_t **dataPtr);
+
+  private:
+    aditof::FrameDetails m_details;
+    const uint8_t *m_data;
+    size_t m_size;
+    UnpackFunction m_unpack;
+    ReleaseFunction m_release;
+    std::vector<uint16_t> m_unpackedData;
+};
+
+#endif // FRAME_LEASE_IMPL
@@ -0,0 +1,115 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <aditof/frame_operations.h>
+#include <aditof/frame_pool.h>
+
+#include <mutex>
+#include <vector>
+
+class FramePoolImpl {
+  public:
+    aditof::FrameDetails details;
+    std::vector<std::unique_ptr<aditof::Frame>> frames;
+    mutable std::mutex mutex;
+};
+
+namespace aditof {
+
+FramePool::FramePool(const FrameDetails &details, size_t size)
+    : m_impl(std::make_shared<FramePoolImpl>()) {
+    m_impl->details = details;
+    m_impl->frames.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        std::unique_ptr<Frame> frame(new Frame);
+        frame->setDetails(details);
+        m_impl->frames.emplace_back(std::move(frame));
+    }
+}
+
+FramePool::~FramePool() = default;
+
+std::shared_ptr<Frame> FramePool::acquire() {
+    std::unique_ptr<Frame> frame;
+    FrameDetails details;
+
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        details = m_impl->details;
+        if (!m_impl->frames.empty()) {
+            frame = std::move(m_impl->frames.back());
+            m_impl->frames.pop_back();
+        }
+    }
+
+    if (!frame) {
+        frame.reset(new Frame);
+    }
+
+    FrameDetails frameDetails;
+    frame->getDetails(frameDetails);
+    if (frameDetails != details) {
+        frame->setDetails(details);
+    }
+
+    std::weak_ptr<FramePoolImpl> pool = m_impl;
+    return std::shared_ptr<Frame>(frame.release(), [pool](Frame *frame) {
+        std::shared_ptr<FramePoolImpl> impl = pool.lock();
+        if (!impl) {
+            delete frame;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        impl->frames.emplace_back(frame);
+    });
+}
+
+Status FramePool::setDetails(const FrameDetails &details) {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+
+    m_impl->details = details;
+    for (auto &frame : m_impl->frames) {
+        FrameDetails frameDetails;
+        frame->getDetails(frameDetails);
+        if (frameDetails != details) {
+            frame->setDetails(details);
+        }
+    }
+
+    return Status::OK;
+}
+
+size_t FramePool::available() const {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->frames.size();
+}
+
+} // namespace aditof
@@ -0,0 +1,392 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "thread_pool.h"
+
+#include <aditof/frame.h>
+#include <aditof/frame_processing_pipeline.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <glog/logging.h>
+#include <mutex>
+#include <thread>
+
+using namespace aditof;
+
+const int FrameProcessingPipeline::SOURCE;
+
+static size_t workerCount(size_t threadCount) {
+    if (threadCount > 0) {
+        return threadCount;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+class FrameProcessingPipelineImpl {
+  public:
+    // A frame going through the pipeline
+    struct Job {
+        Frame *source;
+        PipelineCallback cb;
+        // The frame written by each stage, which is the frame of its input
+        // for the stages that work in place, or one owned by the job
+        std::vector<Frame *> stageFrames;
+        std::vector<std::unique_ptr<Frame>> ownedFrames;
+        size_t remainingOutputs;
+        Status status;
+        bool finished;
+    };
+
+    struct Task {
+        std::shared_ptr<Job> job;
+        bool skip;
+    };
+
+    struct Stage {
+        std::shared_ptr<FrameProcessor> processor;
+        StageMode mode;
+        int input;
+        std::vector<size_t> children;
+        // Other stages read the same input, which can't be modified
+        bool sharedInput;
+
+        // The frames waiting for this stage, processed one at a time by a
+        // worker, in order
+        std::deque<Task> queue;
+        bool running;
+    };
+
+  public:
+    FrameProcessingPipelineImpl(size_t threadCount, size_t maxPendingFrames)
+        : maxPendingFrames(maxPendingFrames), pendingFrames(0),
+          runningStages(0), threadPool(workerCount(threadCount)) {}
+
+    ~FrameProcessingPipelineImpl() { flush(); }
+
+    void updateGraph() {
+        sourceChildren.clear();
+        outputs.clear();
+        for (Stage &stage : stages) {
+            stage.children.clear();
+        }
+
+        for (size_t i = 0; i < stages.size(); ++i) {
+            int input = stages[i].input;
+            if (input == FrameProcessingPipeline::SOURCE) {
+                sourceChildren.push_back(i);
+            } else {
+                stages[input].children.push_back(i);
+            }
+        }
+
+        for (size_t i = 0; i < stages.size(); ++i) {
+            int input = stages[i].input;
+            stages[i].sharedInput = input == FrameProcessingPipeline::SOURCE
+                                        ? sourceChildren.size() > 1
+                                        : stages[input].children.size() > 1;
+            if (stages[i].children.empty()) {
+                outputs.push_back(i);
+            }
+        }
+    }
+
+    void enqueue(size_t stage, Task task) {
+        bool start = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stages[stage].queue.push_back(std::move(task));
+            if (!stages[stage].running) {
+                stages[stage].running = true;
+                ++runningStages;
+                start = true;
+            }
+        }
+
+        if (start) {
+            threadPool.submit([this, stage]() { runStage(stage); });
+        }
+    }
+
+    void runStage(size_t index) {
+        Stage &stage = stages[index];
+
+        for (;;) {
+            Task task;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stage.queue.empty()) {
+                    stage.running = false;
+                    if (--runningStages == 0) {
+                        idleCv.notify_all();
+                    }
+                    return;
+                }
+                task = std::move(stage.queue.front());
+                stage.queue.pop_front();
+            }
+
+            if (!task.skip) {
+                task.skip = !process(index, *task.job);
+            }
+
+            if (stage.children.empty()) {
+                finishOutput(task.job);
+            }
+            for (size_t child : stage.children) {
+                enqueue(child, task);
+            }
+        }
+    }
+
+    bool process(size_t index, Job &job) {
+        Stage &stage = stages[index];
+        Frame *input = stage.input == FrameProcessingPipeline::SOURCE
+                           ? job.source
+                           : job.stageFrames[stage.input];
+        Status status;
+
+        if (stage.mode == StageMode::COPY) {
+            job.ownedFrames[index].reset(new Frame);
+            job.stageFrames[index] = job.ownedFrames[index].get();
+            status = stage.processor->processFrame(*input,
+                                                   *job.stageFrames[index]);
+        } else {
+            if (stage.sharedInput) {
+                job.ownedFrames[index].reset(new Frame(*input));
+                job.stageFrames[index] = job.ownedFrames[index].get();
+            } else {
+                job.stageFrames[index] = input;
+            }
+            Frame &frame = *job.stageFrames[index];
+            status = stage.processor->processFrame(frame, frame);
+        }
+
+        if (status != Status::OK) {
+            LOG(WARNING) << "Stage " << index << " of the pipeline failed";
+            job.stageFrames[index] = nullptr;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (job.status == Status::OK) {
+                job.status = status;
+            }
+            return false;
+        }
+
+        return true;
+    }
+
+    void finishOutput(const std::shared_ptr<Job> &job) {
+        Status status;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--job->remainingOutputs > 0) {
+                return;
+            }
+            status = job->status;
+        }
+
+        // The other outputs of the job are done: reading them is safe
+        if (job->cb) {
+            std::vector<Frame *> frames;
+            for (size_t output : outputs) {
+                frames.push_back(job->stageFrames[output]);
+            }
+            job->cb(status, frames);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job->finished = true;
+            --pendingFrames;
+        }
+        idleCv.notify_all();
+    }
+
+    Status submit(Frame *frame, PipelineCallback cb,
+                  std::shared_ptr<Job> &job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stages.empty()) {
+                LOG(WARNING) << "The pipeline has no stages";
+                return Status::UNAVAILABLE;
+            }
+            if (pendingFrames >= maxPendingFrames) {
+                LOG(WARNING) << "Too many frames in the pipeline ("
+                             << pendingFrames << ")";
+                return Status::BUSY;
+            }
+            ++pendingFrames;
+
+            job = std::make_shared<Job>();
+            job->source = frame;
+            job->cb = std::move(cb);
+            job->stageFrames.assign(stages.size(), nullptr);
+            job->ownedFrames.resize(stages.size());
+            job->remainingOutputs = outputs.size();
+            job->status = Status::OK;
+            job->finished = false;
+        }
+
+        for (size_t stage : sourceChildren) {
+            enqueue(stage, {job, false});
+        }
+
+        return Status::OK;
+    }
+
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        waitIdle(lock);
+    }
+
+    //! waitIdle - Wait until no frame is in the pipeline and the workers
+    //! left the stages, after which the stages can be changed
+    void waitIdle(std::unique_lock<std::mutex> &lock) {
+        idleCv.wait(lock, [this]() {
+            return pendingFrames == 0 && runningStages == 0;
+        });
+    }
+
+  public:
+    // The stages are only changed while no frame is in the pipeline, the
+    // workers read them without locking, except for the queues
+    std::vector<Stage> stages;
+    std::vector<size_t> sourceChildren;
+    std::vector<size_t> outputs;
+
+    size_t maxPendingFrames;
+    size_t pendingFrames;
+    size_t runningStages;
+    std::mutex mutex;
+    std::condition_variable idleCv;
+
+    // Last, so that the workers are stopped before the rest is destroyed
+    ThreadPool threadPool;
+};
+
+FrameProcessingPipeline::FrameProcessingPipeline(size_t threadCount,
+                                                 size_t maxPendingFrames)
+    : m_impl(new FrameProcessingPipelineImpl(threadCount, maxPendingFrames)) {
+}
+
+FrameProcessingPipeline::~FrameProcessingPipeline() = default;
+
+Status
+FrameProcessingPipeline::addStage(std::shared_ptr<FrameProcessor> processor,
+                                  StageMode mode, int input, int &stage) {
+    if (!processor) {
+        LOG(WARNING) << "A stage needs a processor";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    if (m_impl->pendingFrames > 0) {
+        LOG(WARNING) << "Cannot change the stages while frames are processed";
+        return Status::BUSY;
+    }
+    m_impl->waitIdle(lock);
+
+    if (input != SOURCE &&
+        (input < 0 || static_cast<size_t>(input) >= m_impl->stages.size())) {
+        LOG(WARNING) << "Invalid input stage: " << input;
+        return Status::INVALID_ARGUMENT;
+    }
+
+    FrameProcessingPipelineImpl::Stage newStage;
+    newStage.processor = std::move(processor);
+    newStage.mode = mode;
+    newStage.input = input;
+    newStage.sharedInput = false;
+    newStage.running = false;
+    m_impl->stages.push_back(std::move(newStage));
+    m_impl->updateGraph();
+
+    stage = static_cast<int>(m_impl->stages.size()) - 1;
+
+    return Status::OK;
+}
+
+Status
+FrameProcessingPipeline::addStage(std::shared_ptr<FrameProcessor> processor,
+                                  StageMode mode) {
+    int input = static_cast<int>(m_impl->stages.size()) - 1;
+    int stage;
+
+    return addStage(std::move(processor), mode, input, stage);
+}
+
+Status FrameProcessingPipeline::clear() {
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    if (m_impl->pendingFrames > 0) {
+        LOG(WARNING) << "Cannot change the stages while frames are processed";
+        return Status::BUSY;
+    }
+    m_impl->waitIdle(lock);
+
+    m_impl->stages.clear();
+    m_impl->updateGraph();
+
+    return Status::OK;
+}
+
+Status FrameProcessingPipeline::submit(Frame *frame, PipelineCallback cb) {
+    std::shared_ptr<FrameProcessingPipelineImpl::Job> job;
+
+    return m_impl->submit(frame, std::move(cb), job);
+}
+
+Status FrameProcessingPipeline::process(Frame &frame) {
+    std::shared_ptr<FrameProcessingPipelineImpl::Job> job;
+    Status result = Status::OK;
+
+    Status status = m_impl->submit(
+        &frame,
+        [&frame, &result](Status processed,
+                          const std::vector<Frame *> &outputs) {
+            if (outputs[0] && outputs[0] != &frame) {
+                frame = *outputs[0];
+            }
+            result = processed;
+        },
+        job);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    // Finished is set after the callback, once the frame left the pipeline
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->idleCv.wait(lock, [&job]() { return job->finished; });
+
+    return result;
+}
+
+void FrameProcessingPipeline::flush() { m_impl->flush(); }
@@ -0,0 +1,77 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef FRAME_STREAM_H
+#define FRAME_STREAM_H
+
+#include <stdint.h>
+
+//! frame_stream - Wire format of the frames pushed by the network server
+/*!
+    Once a client subscribes with the "StartStreaming" request, the server
+    sends every captured frame as one binary websocket message made of a
+    FrameStreamHeader followed by payloadSize bytes of payload. Replies to
+    regular requests keep being sent as protobuf text messages, so both kinds
+    of messages can be told apart by their websocket opcode. All the fields
+    are little-endian, which is the byte order of every supported target and
+    host.
+*/
+
+namespace aditof {
+
+static const uint32_t FRAME_STREAM_MAGIC = 0x46544441; // "ADTF"
+static const uint16_t FRAME_STREAM_VERSION = 1;
+
+//! FrameStreamCodec - How the payload of a streamed frame is encoded
+enum class FrameStreamCodec : uint16_t {
+    RAW12 = 0,   //!< the 12-bit packed data, as produced by the sensor
+    DELTA12 = 1, //!< the packed data compressed with compressFrame()
+};
+
+#pragma pack(push, 1)
+//! FrameStreamHeader - Describes the frame carried by a binary message
+struct FrameStreamHeader {
+    uint32_t magic;       //!< always FRAME_STREAM_MAGIC
+    uint16_t version;     //!< FRAME_STREAM_VERSION of the sender
+    uint16_t headerSize;  //!< sizeof(FrameStreamHeader) of the sender
+    uint32_t sequence;    //!< incremented for every captured frame
+    uint16_t width;       //!< frame width as set with SetFrameType
+    uint16_t height;      //!< frame height as set with SetFrameType
+    uint64_t timestamp;   //!< capture time in microseconds
+    uint16_t codec;       //!< one of FrameStreamCodec
+    uint16_t reserved;    //!< zero
+    uint32_t payloadSize; //!< number of bytes following the header
+};
+#pragma pack(pop)
+
+} // namespace aditof
+
+#endif // FRAME_STREAM_H
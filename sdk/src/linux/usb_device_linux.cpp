@@ -33,7 +33,11 @@
 #include "utils_linux.h"
 
 #include "device_utils.h"
+#include "frame_lease_impl.h"
 
+#include <aditof/frame_lease.h>
+
+#include <algorithm>
 #include <cmath>
 #include <fcntl.h>
 #include <glog/logging.h>
@@ -48,6 +52,11 @@
 #define MAX_PACKET_SIZE (58)
 #define MAX_BUF_SIZE (MAX_PACKET_SIZE + 2)
 
+// Batched AFE register reads: SET_CUR sends the number of registers and their
+// addresses, GET_CUR returns their values
+#define AFE_BATCH_READ_SELECTOR (4)
+#define MAX_AFE_BATCH_COUNT (MAX_PACKET_SIZE / sizeof(uint16_t))
+
 struct buffer {
     void *start;
     size_t length;
@@ -65,8 +74,13 @@ struct UsbDevice::ImplData {
     struct buffer *buffers;
     unsigned int buffersCount;
     struct v4l2_format fmt;
+    std::string frameType;
     bool started;
     std::unordered_map<std::string, CalibrationData> calibration_cache;
+    aditof::FrameMetadata metadata;
+    // Cleared when the device turns out not to have the batched read control
+    bool afeBatchReads;
+    bool afeBatchReadsChecked;
 };
 
 UsbDevice::UsbDevice(const aditof::DeviceConstructionData &data)
@@ -75,6 +89,8 @@ UsbDevice::UsbDevice(const aditof::DeviceConstructionData &data)
     m_implData->started = false;
     m_implData->buffers = nullptr;
     m_implData->buffersCount = 0;
+    m_implData->afeBatchReads = true;
+    m_implData->afeBatchReadsChecked = false;
     m_deviceDetails.sensorType = aditof::SensorType::SENSOR_96TOF1;
 }
 
@@ -194,6 +210,7 @@ aditof::Status UsbDevice::setFrameType(const aditof::FrameDetails &details) {
 
     m_implData->fmt.fmt.pix.width = details.width;
     m_implData->fmt.fmt.pix.height = details.height;
+    m_implData->frameType = details.type;
 
     min = m_implData->fmt.fmt.pix.width * 2;
     if (m_implData->fmt.fmt.pix.bytesperline < min)
@@ -359,28 +376,24 @@ aditof::Status UsbDevice::program(const uint8_t *firmware, size_t size) {
     return Status::OK;
 }
 
-aditof::Status UsbDevice::getFrame(uint16_t *buffer) {
+// Waits for the driver to fill a buffer and dequeues it
+static aditof::Status dequeueVideoBuffer(int fd, unsigned int buffersCount,
+                                         struct v4l2_buffer &buf) {
     using namespace aditof;
-    Status status = Status::OK;
-
-    if (!buffer) {
-        LOG(WARNING) << "Invalid adddress to buffer provided";
-        return Status::INVALID_ARGUMENT;
-    }
 
     fd_set fds;
     struct timeval tv;
     int r;
 
     FD_ZERO(&fds);
-    FD_SET(m_implData->fd, &fds);
+    FD_SET(fd, &fds);
 
     // Timeout : Ensure this compensates for max delays added for programming
     // cycle defined in 'Device::program'
     tv.tv_sec = 2;
     tv.tv_usec = 0;
 
-    r = select(m_implData->fd + 1, &fds, nullptr, nullptr, &tv);
+    r = select(fd + 1, &fds, nullptr, nullptr, &tv);
 
     if (-1 == r) {
         if (EINTR == errno) {
@@ -395,14 +408,12 @@ aditof::Status UsbDevice::getFrame(uint16_t *buffer) {
         return Status::BUSY;
     }
 
-    struct v4l2_buffer buf;
-
     CLEAR(buf);
 
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     buf.memory = V4L2_MEMORY_MMAP;
 
-    if (-1 == xioctl(m_implData->fd, VIDIOC_DQBUF, &buf)) {
+    if (-1 == xioctl(fd, VIDIOC_DQBUF, &buf)) {
         LOG(WARNING) << "Stream Error";
         switch (errno) {
         case EAGAIN:
@@ -420,17 +431,42 @@ aditof::Status UsbDevice::getFrame(uint16_t *buffer) {
         }
     }
 
-    if (buf.index >= m_implData->buffersCount) {
+    if (buf.index >= buffersCount) {
         LOG(WARNING) << "buffer index out of range";
         return Status::INVALID_ARGUMENT;
     }
 
+    return Status::OK;
+}
+
+aditof::Status UsbDevice::getFrame(uint16_t *buffer) {
+    using namespace aditof;
+    Status status = Status::OK;
+
+    if (!buffer) {
+        LOG(WARNING) << "Invalid adddress to buffer provided";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    struct v4l2_buffer buf;
+    FrameMetadata &metadata = m_implData->metadata;
+    uint64_t requestTimestamp = monotonicTimestamp();
+
+    status = dequeueVideoBuffer(m_implData->fd, m_implData->buffersCount, buf);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    setBufferMetadata(buf, requestTimestamp, metadata);
+
     unsigned int width = m_implData->fmt.fmt.pix.width;
     unsigned int height = m_implData->fmt.fmt.pix.height;
     const char *pdata =
         static_cast<const char *>(m_implData->buffers[buf.index].start);
 
     aditof::deinterleave(pdata, buffer, height * width * 3 / 2, width, height);
+    metadata.unpackTime =
+        static_cast<uint32_t>(monotonicTimestamp() - metadata.dequeueTimestamp);
 
     if (-1 == xioctl(m_implData->fd, VIDIOC_QBUF, &buf)) {
         LOG(WARNING) << "VIDIOC_QBUF, error: " << errno << "("
@@ -441,6 +477,53 @@ aditof::Status UsbDevice::getFrame(uint16_t *buffer) {
     return status;
 }
 
+aditof::Status UsbDevice::getFrameLease(aditof::FrameLease &lease) {
+    using namespace aditof;
+    Status status = Status::OK;
+
+    struct v4l2_buffer buf;
+    uint64_t requestTimestamp = monotonicTimestamp();
+
+    status = dequeueVideoBuffer(m_implData->fd, m_implData->buffersCount, buf);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    // The frame is unpacked later, when the lease data is first requested
+    setBufferMetadata(buf, requestTimestamp, m_implData->metadata);
+
+    FrameDetails details;
+    details.width = m_implData->fmt.fmt.pix.width;
+    details.height = m_implData->fmt.fmt.pix.height;
+    details.type = m_implData->frameType;
+
+    int fd = m_implData->fd;
+    auto unpack = [details](const uint8_t *data, size_t size,
+                            uint16_t *buffer) {
+        aditof::deinterleave(reinterpret_cast<const char *>(data), buffer,
+                             size, details.width, details.height);
+    };
+    auto release = [fd, buf]() mutable {
+        if (-1 == xioctl(fd, VIDIOC_QBUF, &buf)) {
+            LOG(WARNING) << "VIDIOC_QBUF, error: " << errno << "("
+                         << strerror(errno) << ")";
+        }
+    };
+
+    lease = FrameLease(std::unique_ptr<FrameLeaseImpl>(new FrameLeaseImpl(
+        details,
+        static_cast<const uint8_t *>(m_implData->buffers[buf.index].start),
+        details.width * details.height * 3 / 2, unpack, release)));
+
+    return status;
+}
+
+aditof::Status UsbDevice::getFrameMetadata(aditof::FrameMetadata &metadata) {
+    metadata = m_implData->metadata;
+
+    return aditof::Status::OK;
+}
+
 aditof::Status UsbDevice::readEeprom(uint32_t address, uint8_t *data,
                                      size_t length) {
     using namespace aditof;
@@ -535,13 +618,68 @@ aditof::Status UsbDevice::writeEeprom(uint32_t address, const uint8_t *data,
     return Status::OK;
 }
 
+static bool readAfeRegisterBatch(int fd, const uint16_t *address,
+                                 uint16_t *data, size_t count) {
+    struct uvc_xu_control_query cq;
+    uint8_t packet[MAX_BUF_SIZE];
+
+    memset(packet, 0, MAX_BUF_SIZE);
+    packet[0] = count;
+    memcpy(&packet[2], address, count * sizeof(uint16_t));
+
+    // This set property will send the addresses of the AFE registers to read
+    CLEAR(cq);
+    cq.query = UVC_SET_CUR; // bRequest
+    cq.data = packet;
+    cq.size = MAX_BUF_SIZE;
+    cq.unit = 0x03; // wIndex
+    cq.selector = AFE_BATCH_READ_SELECTOR;
+    if (-1 == xioctl(fd, UVCIOC_CTRL_QUERY, &cq)) {
+        return false;
+    }
+
+    // This get property will get the values read from the AFE registers
+    CLEAR(cq);
+    cq.query = UVC_GET_CUR; // bRequest
+    cq.data = packet;
+    cq.size = MAX_BUF_SIZE;
+    cq.unit = 0x03; // wIndex
+    cq.selector = AFE_BATCH_READ_SELECTOR;
+    if (-1 == xioctl(fd, UVCIOC_CTRL_QUERY, &cq)) {
+        return false;
+    }
+
+    memcpy(data, packet, count * sizeof(uint16_t));
+
+    return true;
+}
+
 aditof::Status UsbDevice::readAfeRegisters(const uint16_t *address,
                                            uint16_t *data, size_t length) {
     using namespace aditof;
 
     struct uvc_xu_control_query cq;
+    size_t readCount = 0;
+
+    while (m_implData->afeBatchReads && readCount < length) {
+        size_t count = std::min(length - readCount, MAX_AFE_BATCH_COUNT);
+        if (!readAfeRegisterBatch(m_implData->fd, address + readCount,
+                                  data + readCount, count)) {
+            if (m_implData->afeBatchReadsChecked) {
+                LOG(WARNING) << "Error in reading AFE registers, error: "
+                             << errno << "(" << strerror(errno) << ")";
+                return Status::GENERIC_ERROR;
+            }
+            // Older devices only read one register at a time
+            LOG(INFO) << "Batched AFE register reads are not supported";
+            m_implData->afeBatchReads = false;
+            break;
+        }
+        m_implData->afeBatchReadsChecked = true;
+        readCount += count;
+    }
 
-    for (size_t i = 0; i < length; ++i) {
+    for (size_t i = readCount; i < length; ++i) {
         // This set property will send the address of AFE register to be read
         CLEAR(cq);
         cq.query = UVC_SET_CUR; // bRequest
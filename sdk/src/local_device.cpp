@@ -66,6 +66,15 @@ aditof::Status LocalDevice::getFrame(uint16_t * /*buffer*/) {
     return aditof::Status::GENERIC_ERROR;
 }
 
+aditof::Status LocalDevice::getFrameLease(aditof::FrameLease & /*lease*/) {
+    return aditof::Status::GENERIC_ERROR;
+}
+
+aditof::Status
+LocalDevice::getFrameMetadata(aditof::FrameMetadata & /*metadata*/) {
+    return aditof::Status::GENERIC_ERROR;
+}
+
 aditof::Status LocalDevice::readEeprom(uint32_t /*address*/, uint8_t * /*data*/,
                                        size_t /*length*/) {
     return aditof::Status::GENERIC_ERROR;
@@ -53,6 +53,8 @@ class LocalDevice : public aditof::DeviceInterface {
     virtual aditof::Status setFrameType(const aditof::FrameDetails &details);
     virtual aditof::Status program(const uint8_t *firmware, size_t size);
     virtual aditof::Status getFrame(uint16_t *buffer);
+    virtual aditof::Status getFrameLease(aditof::FrameLease &lease);
+    virtual aditof::Status getFrameMetadata(aditof::FrameMetadata &metadata);
     virtual aditof::Status readEeprom(uint32_t address, uint8_t *data,
                                       size_t length);
     virtual aditof::Status writeEeprom(uint32_t address, const uint8_t *data,
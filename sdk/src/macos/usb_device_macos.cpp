@@ -101,6 +101,25 @@ aditof::Status UsbDevice::getFrame(uint16_t *buffer) {
     return status;
 }
 
+aditof::Status UsbDevice::getFrameLease(aditof::FrameLease & /*lease*/) {
+    using namespace aditof;
+    Status status = Status::UNAVAILABLE;
+
+    // TO DO
+
+    return status;
+}
+
+aditof::Status
+UsbDevice::getFrameMetadata(aditof::FrameMetadata & /*metadata*/) {
+    using namespace aditof;
+    Status status = Status::UNAVAILABLE;
+
+    // TO DO
+
+    return status;
+}
+
 aditof::Status UsbDevice::readEeprom(uint32_t address, uint8_t *data,
                                      size_t length) {
     using namespace aditof;
@@ -0,0 +1,389 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "cpu_features.h"
+#include "depth_filter.h"
+#include "thread_pool.h"
+
+#include <aditof/median_filter.h>
+
+#include <algorithm>
+#include <cstring>
+#include <glog/logging.h>
+#include <vector>
+
+#if defined(ADITOF_X86)
+#include <emmintrin.h>
+#endif
+
+#if defined(ADITOF_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace aditof;
+
+// The rows are split in bands of this many rows between the threads
+static const size_t skRowsPerBand = 16;
+
+// Sorting networks that move the median of 9 and 25 values to the middle
+// element, from N. Devillard, "Fast median search: an ANSI C implementation"
+#define MEDIAN9_NETWORK(SORT)                                                  \
+    SORT(1, 2) SORT(4, 5) SORT(7, 8) SORT(0, 1) SORT(3, 4) SORT(6, 7)          \
+    SORT(1, 2) SORT(4, 5) SORT(7, 8) SORT(0, 3) SORT(5, 8) SORT(4, 7)          \
+    SORT(3, 6) SORT(1, 4) SORT(2, 5) SORT(4, 7) SORT(4, 2) SORT(6, 4)          \
+    SORT(4, 2)
+
+#define MEDIAN25_NETWORK(SORT)                                                 \
+    SORT(0, 1) SORT(3, 4) SORT(2, 4) SORT(2, 3) SORT(6, 7) SORT(5, 7)          \
+    SORT(5, 6) SORT(9, 10) SORT(8, 10) SORT(8, 9) SORT(12, 13) SORT(11, 13)    \
+    SORT(11, 12) SORT(15, 16) SORT(14, 16) SORT(14, 15) SORT(18, 19)           \
+    SORT(17, 19) SORT(17, 18) SORT(21, 22) SORT(20, 22) SORT(20, 21)           \
+    SORT(23, 24) SORT(2, 5) SORT(3, 6) SORT(0, 6) SORT(0, 3) SORT(4, 7)        \
+    SORT(1, 7) SORT(1, 4) SORT(11, 14) SORT(8, 14) SORT(8, 11) SORT(12, 15)    \
+    SORT(9, 15) SORT(9, 12) SORT(13, 16) SORT(10, 16) SORT(10, 13)             \
+    SORT(20, 23) SORT(17, 23) SORT(17, 20) SORT(21, 24) SORT(18, 24)           \
+    SORT(18, 21) SORT(19, 22) SORT(8, 17) SORT(9, 18) SORT(0, 18) SORT(0, 9)   \
+    SORT(10, 19) SORT(1, 19) SORT(1, 10) SORT(11, 20) SORT(2, 20) SORT(2, 11)  \
+    SORT(12, 21) SORT(3, 21) SORT(3, 12) SORT(13, 22) SORT(4, 22) SORT(4, 13)  \
+    SORT(14, 23) SORT(5, 23) SORT(5, 14) SORT(15, 24) SORT(6, 24) SORT(6, 15)  \
+    SORT(7, 16) SORT(7, 19) SORT(13, 21) SORT(15, 23) SORT(7, 13) SORT(7, 15)  \
+    SORT(1, 9) SORT(3, 11) SORT(5, 17) SORT(11, 17) SORT(9, 17) SORT(4, 10)    \
+    SORT(6, 12) SORT(7, 14) SORT(4, 6) SORT(4, 7) SORT(12, 14) SORT(10, 14)    \
+    SORT(6, 7) SORT(10, 12) SORT(6, 10) SORT(6, 17) SORT(12, 17) SORT(7, 17)   \
+    SORT(7, 10) SORT(12, 18) SORT(7, 12) SORT(10, 18) SORT(12, 20)             \
+    SORT(10, 20) SORT(10, 12)
+
+/* The kernels filter the row y of the depth image, from src to dst. The
+ * SIMD kernels compute the median of 8 pixels at once with a sorting network.
+ * The invalid pixels of a window are replaced alternately by the lowest and
+ * the highest value, the first one by the lowest: with k of them, ceil(k/2)
+ * are below the valid pixels and floor(k/2) above, which leaves the lower
+ * median of the valid pixels in the middle. They give the same values as the
+ * scalar kernels, which only do the borders of the image then.
+ */
+typedef void (*MedianRowKernel)(const uint16_t *src, uint16_t *dst,
+                                unsigned int width, unsigned int height,
+                                unsigned int y, uint16_t maxDepth);
+
+static inline bool isValid(uint16_t depth, uint16_t maxDepth) {
+    return depth != 0 && depth < maxDepth;
+}
+
+//! medianPixel - The median of the valid pixels of the window of a pixel,
+//! which is cut at the borders of the image
+static uint16_t medianPixel(const uint16_t *src, unsigned int width,
+                            unsigned int height, unsigned int x,
+                            unsigned int y, unsigned int radius,
+                            uint16_t maxDepth) {
+    uint16_t center = src[static_cast<size_t>(y) * width + x];
+    if (!isValid(center, maxDepth)) {
+        return center;
+    }
+
+    unsigned int top = y > radius ? y - radius : 0;
+    unsigned int bottom = std::min(y + radius, height - 1);
+    unsigned int left = x > radius ? x - radius : 0;
+    unsigned int right = std::min(x + radius, width - 1);
+
+    uint16_t values[25];
+    size_t count = 0;
+    for (unsigned int j = top; j <= bottom; ++j) {
+        const uint16_t *row = src + static_cast<size_t>(j) * width;
+        for (unsigned int i = left; i <= right; ++i) {
+            if (isValid(row[i], maxDepth)) {
+                values[count++] = row[i];
+            }
+        }
+    }
+
+    uint16_t *median = values + (count - 1) / 2;
+    std::nth_element(values, median, values + count);
+
+    return *median;
+}
+
+template <unsigned int Radius>
+static void medianRowScalar(const uint16_t *src, uint16_t *dst,
+                            unsigned int width, unsigned int height,
+                            unsigned int y, uint16_t maxDepth) {
+    uint16_t *dstRow = dst + static_cast<size_t>(y) * width;
+    for (unsigned int x = 0; x < width; ++x) {
+        dstRow[x] = medianPixel(src, width, height, x, y, Radius, maxDepth);
+    }
+}
+
+//! medianRowBorders - Filter the pixels of a row that the SIMD kernels don't
+//! do: all of them on the top and bottom rows, the borders on the others.
+//! \return the first pixel for the SIMD kernel, width if none
+template <unsigned int Radius>
+static unsigned int medianRowBorders(const uint16_t *src, uint16_t *dst,
+                                     unsigned int width, unsigned int height,
+                                     unsigned int y, uint16_t maxDepth) {
+    if (y < Radius || y + Radius >= height || width < 8 + 2 * Radius) {
+        medianRowScalar<Radius>(src, dst, width, height, y, maxDepth);
+        return width;
+    }
+
+    uint16_t *dstRow = dst + static_cast<size_t>(y) * width;
+    for (unsigned int x = 0; x < Radius; ++x) {
+        dstRow[x] = medianPixel(src, width, height, x, y, Radius, maxDepth);
+    }
+
+    return Radius;
+}
+
+#if defined(ADITOF_X86)
+// SSE2 only compares signed 16 bit values: the pixels are moved to the signed
+// range by flipping their top bit
+#define SORT_SSE2(a, b)                                                        \
+    {                                                                          \
+        __m128i low = _mm_min_epi16(p[a], p[b]);                               \
+        p[b] = _mm_max_epi16(p[a], p[b]);                                      \
+        p[a] = low;                                                            \
+    }
+
+template <unsigned int Radius>
+ADITOF_TARGET("sse2")
+static void medianRowSse2(const uint16_t *src, uint16_t *dst,
+                          unsigned int width, unsigned int height,
+                          unsigned int y, uint16_t maxDepth) {
+    const unsigned int size = 2 * Radius + 1;
+    const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i allOnes = _mm_cmpeq_epi16(one, one);
+    // Valid pixels are in [1, maxDepth - 1]: depth - 1 < maxDepth - 1
+    const __m128i limit =
+        _mm_set1_epi16(static_cast<short>((maxDepth - 1) ^ 0x8000));
+
+    unsigned int x =
+        medianRowBorders<Radius>(src, dst, width, height, y, maxDepth);
+    uint16_t *dstRow = dst + static_cast<size_t>(y) * width;
+
+    for (; x + 8 + Radius <= width; x += 8) {
+        __m128i p[size * size];
+        __m128i center = _mm_setzero_si128();
+        __m128i centerInvalid = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        for (unsigned int j = 0; j < size; ++j) {
+            const uint16_t *row =
+                src + static_cast<size_t>(y + j - Radius) * width + x - Radius;
+            for (unsigned int i = 0; i < size; ++i) {
+                __m128i v = _mm_xor_si128(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i)),
+                    bias);
+                __m128i invalid =
+                    _mm_xor_si128(_mm_cmplt_epi16(_mm_sub_epi16(v, one), limit),
+                                  allOnes);
+                // 0x8000 or 0x7FFF once biased, the lowest or highest value
+                __m128i replacement = _mm_xor_si128(high, bias);
+                p[j * size + i] =
+                    _mm_or_si128(_mm_andnot_si128(invalid, v),
+                                 _mm_and_si128(invalid, replacement));
+                high = _mm_xor_si128(high, invalid);
+                if (j == Radius && i == Radius) {
+                    center = v;
+                    centerInvalid = invalid;
+                }
+            }
+        }
+
+        if (Radius == 1) {
+            MEDIAN9_NETWORK(SORT_SSE2)
+        } else {
+            MEDIAN25_NETWORK(SORT_SSE2)
+        }
+        // Invalid pixels are left as they are
+        __m128i result =
+            _mm_or_si128(_mm_andnot_si128(centerInvalid, p[size * size / 2]),
+                         _mm_and_si128(centerInvalid, center));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dstRow + x),
+                         _mm_xor_si128(result, bias));
+    }
+
+    for (; x < width; ++x) {
+        dstRow[x] = medianPixel(src, width, height, x, y, Radius, maxDepth);
+    }
+}
+#endif // ADITOF_X86
+
+#if defined(ADITOF_NEON)
+#define SORT_NEON(a, b)                                                        \
+    {                                                                          \
+        uint16x8_t low = vminq_u16(p[a], p[b]);                                \
+        p[b] = vmaxq_u16(p[a], p[b]);                                          \
+        p[a] = low;                                                            \
+    }
+
+template <unsigned int Radius>
+static void medianRowNeon(const uint16_t *src, uint16_t *dst,
+                          unsigned int width, unsigned int height,
+                          unsigned int y, uint16_t maxDepth) {
+    const unsigned int size = 2 * Radius + 1;
+    const uint16x8_t one = vdupq_n_u16(1);
+    // Valid pixels are in [1, maxDepth - 1]: depth - 1 < maxDepth - 1
+    const uint16x8_t limit = vdupq_n_u16(maxDepth - 1);
+
+    unsigned int x =
+        medianRowBorders<Radius>(src, dst, width, height, y, maxDepth);
+    uint16_t *dstRow = dst + static_cast<size_t>(y) * width;
+
+    for (; x + 8 + Radius <= width; x += 8) {
+        uint16x8_t p[size * size];
+        uint16x8_t center = vdupq_n_u16(0);
+        uint16x8_t centerInvalid = vdupq_n_u16(0);
+        uint16x8_t high = vdupq_n_u16(0);
+        for (unsigned int j = 0; j < size; ++j) {
+            const uint16_t *row =
+                src + static_cast<size_t>(y + j - Radius) * width + x - Radius;
+            for (unsigned int i = 0; i < size; ++i) {
+                uint16x8_t v = vld1q_u16(row + i);
+                uint16x8_t invalid = vcgeq_u16(vsubq_u16(v, one), limit);
+                // 0 or 0xFFFF, the lowest or highest value
+                p[j * size + i] = vbslq_u16(invalid, high, v);
+                high = veorq_u16(high, invalid);
+                if (j == Radius && i == Radius) {
+                    center = v;
+                    centerInvalid = invalid;
+                }
+            }
+        }
+
+        if (Radius == 1) {
+            MEDIAN9_NETWORK(SORT_NEON)
+        } else {
+            MEDIAN25_NETWORK(SORT_NEON)
+        }
+        // Invalid pixels are left as they are
+        vst1q_u16(dstRow + x,
+                  vbslq_u16(centerInvalid, center, p[size * size / 2]));
+    }
+
+    for (; x < width; ++x) {
+        dstRow[x] = medianPixel(src, width, height, x, y, Radius, maxDepth);
+    }
+}
+#endif // ADITOF_NEON
+
+template <unsigned int Radius> static MedianRowKernel selectMedianKernel() {
+    const CpuFeatures &features = cpuFeatures();
+
+#if defined(ADITOF_X86)
+    if (features.sse2) {
+        return medianRowSse2<Radius>;
+    }
+#endif
+
+#if defined(ADITOF_NEON)
+    if (features.neon) {
+        return medianRowNeon<Radius>;
+    }
+#endif
+
+    (void)features;
+    return medianRowScalar<Radius>;
+}
+
+class MedianFilterImpl {
+  public:
+    MedianFilterImpl()
+        : kernelSize(3), maxDepth(0xFFFF),
+          median3Kernel(selectMedianKernel<1>()),
+          median5Kernel(selectMedianKernel<2>()) {}
+
+  public:
+    unsigned int kernelSize;
+    uint16_t maxDepth;
+
+    // The input depth image, the frame being the output
+    std::vector<uint16_t> source;
+
+    MedianRowKernel median3Kernel;
+    MedianRowKernel median5Kernel;
+};
+
+MedianFilter::MedianFilter(unsigned int kernelSize)
+    : m_impl(new MedianFilterImpl) {
+    setKernelSize(kernelSize);
+}
+
+MedianFilter::~MedianFilter() = default;
+
+Status MedianFilter::processFrame(const Frame &inFrame, Frame &outFrame) {
+    DepthPlane depth;
+    Status status = prepareDepthFilter(inFrame, outFrame, "median", depth);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    size_t pixelCount = static_cast<size_t>(depth.width) * depth.height;
+    m_impl->source.assign(depth.data, depth.data + pixelCount);
+
+    MedianRowKernel kernel = m_impl->kernelSize == 5 ? m_impl->median5Kernel
+                                                     : m_impl->median3Kernel;
+    const uint16_t *src = m_impl->source.data();
+    uint16_t maxDepth = m_impl->maxDepth;
+
+    ThreadPool::instance().parallelFor(
+        0, depth.height, skRowsPerBand, [&](size_t first, size_t last) {
+            for (size_t y = first; y < last; ++y) {
+                kernel(src, depth.data, depth.width, depth.height,
+                       static_cast<unsigned int>(y), maxDepth);
+            }
+        });
+
+    return Status::OK;
+}
+
+Status MedianFilter::setKernelSize(unsigned int size) {
+    if (size != 3 && size != 5) {
+        LOG(WARNING) << "Unsupported median kernel size: " << size;
+        return Status::INVALID_ARGUMENT;
+    }
+
+    m_impl->kernelSize = size;
+
+    return Status::OK;
+}
+
+unsigned int MedianFilter::kernelSize() const { return m_impl->kernelSize; }
+
+Status MedianFilter::setMaxDepth(uint16_t maxDepth) {
+    if (maxDepth == 0) {
+        LOG(WARNING) << "The maximum depth must be at least 1";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    m_impl->maxDepth = maxDepth;
+
+    return Status::OK;
+}
+
+uint16_t MedianFilter::maxDepth() const { return m_impl->maxDepth; }
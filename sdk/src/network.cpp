@@ -31,6 +31,7 @@
  */
 #include "network.h"
 
+#include <algorithm>
 #include <functional>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
@@ -60,8 +61,7 @@ static struct lws_protocols protocols[] = {
     {NULL, NULL, 0, 0} /* terminator */
 };
 
-int nBytes = 0;          /*no of bytes sent*/
-int recv_data_error = 0; /*flag for recv data*/
+int nBytes = 0; /*no of bytes sent*/
 char server_msg[] = "Connection Allowed";
 
 /*Declare static members*/
@@ -73,10 +73,34 @@ mutex Network::m_mutex;
 mutex Network::mutex_recv;
 condition_variable Network::Cond_Var;
 condition_variable Network::thread_Cond_Var;
+mutex Network::mutex_frame;
+condition_variable Network::frame_Cond_Var;
+vector<char> Network::frame_buff;
+condition_variable Network::recv_Cond_Var;
+vector<unsigned char> Network::send_pkt;
+Network::ReplyList Network::replies;
+Network::ReplyList Network::spare_replies;
+
+/*
+* find_reply():  find the reply to a command among the replies received
+* Parameters:   request_id - the id given to the command when sent
+* returns:      the reply, or replies.end() if it is not received yet
+* Desription:   Servers that don't know about request ids reply with id 0, in
+*               order, so such a reply matches any command.
+*/
+Network::ReplyList::iterator Network::find_reply(uint32_t request_id) {
+    return find_if(replies.begin(), replies.end(),
+                   [request_id](const ReplyList::value_type &reply) {
+                       return reply.first == request_id || reply.first == 0;
+                   });
+}
 
 bool Network::Send_Successful;
-bool Network::Data_Received;
 bool Network::Server_Connected;
+bool Network::Frame_Received;
+
+uint32_t Network::next_request_id;
+uint32_t Network::last_request_id;
 
 /*
 * isServer_Connected(): checks if server is connected
@@ -116,15 +140,27 @@ flag value
 bool Network::isSend_Successful() { return Network::Send_Successful; }
 
 /*
-* isData_Received(): check if data received from server and returns
-Data_Received flag value
+* isData_Received(): check if the reply to a command is received from server
+* Parameters:        request_id - the id given to the command when sent
+* returns:           true  - if the reply has been received
+                     false - if the reply is not received yet
+* Desription:   This function is used to check if the reply to a command has
+*               been received from server. Servers that don't know about
+*               request ids reply with id 0, in order.
+*/
+bool Network::isData_Received(uint32_t request_id) {
+    return find_reply(request_id) != replies.end();
+}
+
+/*
+* isFrame_Received(): check if a streamed frame has been received and returns
+Frame_Received flag value
 * Parameters:        none
-* returns:           true  - if data received successfully
-                     false - if error in data receiving
-* Desription:   This function is used to check if any data received from server
-*               returns Data_Received flag value.
+* returns:           true  - if a frame is waiting to be read
+                     false - if no frame has been received yet
+* Desription:   This function returns Frame_Received flag value
 */
-bool Network::isData_Received() { return Network::Data_Received; }
+bool Network::isFrame_Received() { return Network::Frame_Received; }
 
 /*
 * ServerConnect():  intializes the websocket and connects to server
@@ -211,6 +247,15 @@ int Network::ServerConnect(const std::string &ip) {
 int Network::SendCommand() {
     int status = -1;
     uint8_t numRetry = 0;
+
+    /*Tag the command so that its reply can be told apart from the replies
+     * to the other commands in flight*/
+    if (++next_request_id == 0) {
+        next_request_id = 1;
+    }
+    last_request_id = next_request_id;
+    send_buff.set_request_id(last_request_id);
+
     int siz = send_buff.ByteSize();
 
     recv_buff.Clear();
@@ -267,53 +312,118 @@ int Network::SendCommand() {
 * Parameters:   None
 * returns:      0  - on success
                 -1 -  on error
-* Desription:   This function is used to receive the data from connected server
+* Desription:   This function is used to receive the reply to the last command
+*               sent to the connected server
 */
 int Network::recv_server_data() {
+    int status = recv_reply(last_request_id);
+
+    send_buff.Clear();
+
+    return status;
+}
+
+/*
+* lastRequestId():  get the id of the last command sent
+* Parameters:   None
+* returns:      the id given by SendCommand() to the last command
+* Desription:   This function is used to remember which reply to wait for when
+*               several commands are sent before receiving their replies
+*/
+uint32_t Network::lastRequestId() const { return last_request_id; }
+
+/*
+* recv_reply():  receive the reply to a given command
+* Parameters:   request_id - the id of the command, see lastRequestId()
+* returns:      0  - on success
+                -1 -  on error
+                -2 -  if the server is not connected
+* Desription:   This function waits for the reply to the given command and
+*               puts it in recv_buff. Replies to other commands that arrive in
+*               the meantime are kept until they are asked for.
+*/
+int Network::recv_reply(uint32_t request_id) {
     int status = -1;
     uint8_t numRetry = 0;
-    /*Wait until data received from the server after command execution*/
 
     while (numRetry++ < MAX_RETRY_CNT && Server_Connected != false) {
 
         /*Acquire the lock*/
         std::unique_lock<std::mutex> mlock(mutex_recv);
-        if (Cond_Var.wait_for(mlock, std::chrono::seconds(10),
-                              std::bind(&Network::isData_Received, this)) ==
-            true) {
-            /*reset the flag value to receive again*/
-            Data_Received = false;
-
-            if (recv_data_error == 1) {
-                /*Retry sending command*/
-                if (SendCommand() != 0) {
-                    status = -1;
-                    break;
-                }
-            } else if (recv_data_error == 0) {
-                /*Data received correctly*/
-                status = 0;
+        if (recv_Cond_Var.wait_for(mlock, std::chrono::seconds(10), [&]() {
+                return isData_Received(request_id) || !isServer_Connected();
+            }) == true) {
+            auto it = find_reply(request_id);
+            if (it == replies.end()) {
+                /*Woken up by a closed connection*/
                 break;
             }
 
-        } else {
-            /*No data recvd till time out Retry sending command */
-            if (SendCommand() != 0) {
-                status = -1;
-                break;
-            }
+            /*Data received correctly, keep the message for a next reply*/
+            recv_buff.Swap(&it->second);
+            spare_replies.splice(spare_replies.end(), replies, it);
+            status = 0;
+            break;
         }
+#ifdef NW_DEBUG
+        cout << "Receive Timeout, retry " << numRetry << endl;
+#endif
     }
 
     if (Server_Connected == false) {
         status = -2;
     }
 
-    send_buff.Clear();
-
     return status;
 }
 
+/*
+* recv_frame():  receive the next frame streamed by the server
+* Parameters:   frame - gets the content of the binary message (header and
+                        payload)
+* returns:      0  - on success
+                -1 - on timeout
+                -2 - if the server is not connected
+* Desription:   This function waits for the binary message of the next frame
+*               pushed by the server. Only the latest frame is kept, so a
+*               client that is slower than the sensor skips frames instead of
+*               falling behind.
+*/
+int Network::recv_frame(std::vector<char> &frame) {
+    std::unique_lock<std::mutex> mlock(mutex_frame);
+
+    if (frame_Cond_Var.wait_for(mlock, std::chrono::seconds(10), [this]() {
+            return isFrame_Received() || !isServer_Connected();
+        }) == false) {
+#ifdef NW_DEBUG
+        cout << "Frame receive timeout" << endl;
+#endif
+        return -1;
+    }
+
+    if (!Frame_Received) {
+        return -2;
+    }
+
+    /*Hand the buffer over and keep the old one for the next frame*/
+    frame.swap(frame_buff);
+    Frame_Received = false;
+
+    return 0;
+}
+
+/*
+* drop_frames():  discard the frame received and not read yet
+* Parameters:   none
+* returns:      none
+* Desription:   This function is used after the server was asked to stop
+*               streaming so that a stale frame is not returned later.
+*/
+void Network::drop_frames() {
+    std::lock_guard<std::mutex> guard(mutex_frame);
+    Frame_Received = false;
+}
+
 /*
  * call_lws_service():  calls websockets library lws_service() api
  * Parameters:   None
@@ -385,24 +495,49 @@ int Network::callback_function(struct lws *wsi,
                 len = clientData->data.size();
             }
 
-            // process message
-            google::protobuf::io::ArrayInputStream ais(in, len);
-            CodedInputStream coded_input(&ais);
-            recv_buff.ParseFromCodedStream(&coded_input);
+            if (lws_frame_is_binary(wsi)) {
+                /*Streamed frame, replace the one not read yet (if any)*/
+                std::lock_guard<std::mutex> frameGuard(mutex_frame);
+                if (clientData->hasFragments) {
+                    frame_buff.swap(clientData->data);
+                } else {
+                    char *inData = static_cast<char *>(in);
+                    frame_buff.assign(inData, inData + len);
+                }
+                Frame_Received = true;
+
+                /*Notify the host SDK that a frame is received*/
+                frame_Cond_Var.notify_one();
+            } else {
+                // process message, reusing a message from a previous reply
+                if (spare_replies.empty()) {
+                    spare_replies.emplace_back();
+                }
+                replies.splice(replies.end(), spare_replies,
+                               spare_replies.begin());
+                ServerResponse &response = replies.back().second;
+
+                google::protobuf::io::ArrayInputStream ais(in, len);
+                CodedInputStream coded_input(&ais);
+                response.ParseFromCodedStream(&coded_input);
 
-            recv_data_error = 0;
-            Data_Received = true;
+                replies.back().first = response.request_id();
 
-            /*Notify the host SDK that data is received from server*/
-            Cond_Var.notify_one();
+                /*Notify the host SDK that data is received from server*/
+                recv_Cond_Var.notify_one();
+            }
 
+            clientData->data.clear();
+            clientData->hasFragments = false;
         } else {
             // append message
             if (clientData->data.size() == 0) {
                 clientData->data.reserve(len + remaining);
             }
 
-            std::cout << "apending data" << std::endl;
+#ifdef NW_DEBUG
+            cout << "apending data" << endl;
+#endif
             char *inData = static_cast<char *>(in);
             clientData->data.insert(clientData->data.end(), inData,
                                     inData + len);
@@ -423,14 +558,15 @@ int Network::callback_function(struct lws *wsi,
 
         /* Get size of packet to be sent*/
         int siz = send_buff.ByteSize();
-        /*Pre padding of bytes as per websockets*/
-        unsigned char *pkt =
-            new unsigned char[siz + LWS_SEND_BUFFER_PRE_PADDING];
-        unsigned char *pkt_pad = pkt + LWS_SEND_BUFFER_PRE_PADDING;
+        /*Pre padding of bytes as per websockets. The packet buffer only
+         * grows, so it is not allocated again for every command*/
+        size_t pktSize = static_cast<size_t>(siz) + LWS_SEND_BUFFER_PRE_PADDING;
+        if (send_pkt.size() < pktSize) {
+            send_pkt.resize(pktSize);
+        }
+        unsigned char *pkt_pad = send_pkt.data() + LWS_SEND_BUFFER_PRE_PADDING;
 
-        google::protobuf::io::ArrayOutputStream aos(pkt_pad, siz);
-        CodedOutputStream *coded_output = new CodedOutputStream(&aos);
-        send_buff.SerializeToCodedStream(coded_output);
+        send_buff.SerializeWithCachedSizesToArray(pkt_pad);
 
         nBytes = lws_write(wsi, pkt_pad, siz, LWS_WRITE_TEXT);
 
@@ -438,8 +574,6 @@ int Network::callback_function(struct lws *wsi,
         Send_Successful = true;
         Cond_Var.notify_one();
 
-        delete coded_output;
-        delete[] pkt;
         send_buff.Clear();
         break;
     }
@@ -450,6 +584,8 @@ int Network::callback_function(struct lws *wsi,
         std::lock_guard<std::mutex> guard(m_mutex);
         Server_Connected = false;
         web_socket = NULL;
+        frame_Cond_Var.notify_one();
+        recv_Cond_Var.notify_one();
         break;
     }
 
@@ -476,9 +612,13 @@ Network::Network() {
 
     /*Initialize the static flags*/
     Network::Send_Successful = false;
-    Network::Data_Received = false;
+    Network::next_request_id = 0;
+    Network::last_request_id = 0;
+    Network::spare_replies.splice(Network::spare_replies.end(),
+                                  Network::replies);
     Network::Thread_Running = 0;
     Network::Server_Connected = false;
+    Network::Frame_Received = false;
 }
 
 /*
@@ -33,7 +33,9 @@
 
 #include <condition_variable>
 #include <libwebsockets.h>
+#include <list>
 #include <thread>
+#include <vector>
 
 class Network {
 
@@ -46,10 +48,28 @@ class Network {
     std::mutex thread_mutex;
     static std::condition_variable Cond_Var;
     static std::condition_variable thread_Cond_Var;
+    static std::mutex mutex_frame;
+    static std::condition_variable frame_Cond_Var;
+    static std::vector<char> frame_buff;
+    static std::condition_variable recv_Cond_Var;
+    static std::vector<unsigned char> send_pkt;
+
+    /* Replies received and not read yet. The messages are moved between the
+     * two lists instead of being allocated for every reply, so that their
+     * buffers are reused. */
+    typedef std::list<std::pair<uint32_t, payload::ServerResponse>> ReplyList;
+    static ReplyList replies;
+    static ReplyList spare_replies;
+
+    //! find_reply - finds the reply to a command in the replies received
+    static ReplyList::iterator find_reply(uint32_t request_id);
 
     static bool Send_Successful;
-    static bool Data_Received;
     static bool Server_Connected;
+    static bool Frame_Received;
+
+    static uint32_t next_request_id;
+    static uint32_t last_request_id;
 
     int Thread_Running;
 
@@ -68,9 +88,23 @@ class Network {
     //! SendCommand() - APi to send SDK apis to connected server
     int SendCommand();
 
-    //! recv_server_data() - APi to receive data from server
+    //! recv_server_data() - APi to receive the reply to the last command sent
+    //! with SendCommand()
     int recv_server_data();
 
+    //! lastRequestId() - APi to get the id given to the last command sent
+    uint32_t lastRequestId() const;
+
+    //! recv_reply() - APi to receive the reply to a given command, which may
+    //! not be the last one sent
+    int recv_reply(uint32_t request_id);
+
+    //! recv_frame() - APi to receive the next frame streamed by the server
+    int recv_frame(std::vector<char> &frame);
+
+    //! drop_frames() - APi to discard a streamed frame not yet received
+    void drop_frames();
+
     //! callback_function() - APi to handle websocket events
     static int callback_function(struct lws *wsi,
                                  enum lws_callback_reasons reason, void *user,
@@ -86,9 +120,12 @@ class Network {
     //! successfully
     bool isSend_Successful();
 
-    //! isData_Received() - APi to check if data is received from server
-    //! successfully
-    bool isData_Received();
+    //! isData_Received() - APi to check if the reply to a command is
+    //! received from server
+    bool isData_Received(uint32_t request_id);
+
+    //! isFrame_Received() - APi to check if a streamed frame is available
+    bool isFrame_Received();
 
     //! isThread_Running() - APi to check thread exist or not
     bool isThread_Running();
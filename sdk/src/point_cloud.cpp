@@ -0,0 +1,467 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "cpu_features.h"
+
+#include <aditof/point_cloud.h>
+
+#include <cmath>
+#include <cstring>
+#include <glog/logging.h>
+#include <vector>
+
+#if defined(ADITOF_X86)
+#include <emmintrin.h>
+#endif
+
+#if defined(ADITOF_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace aditof;
+
+/* The kernels write the packed points of a row of count pixels: x, y, z for
+ * each pixel, with z = depth * scale, x = z * rayX[pixel], y = z * rayY.
+ * The int16 kernels round to the nearest integer, with the rounding mode of
+ * the machine, and saturate.
+ */
+typedef void (*FloatPointKernel)(const uint16_t *depth, const float *rayX,
+                                 float rayY, float scale, float *xyz,
+                                 size_t count);
+typedef void (*Int16PointKernel)(const uint16_t *depth, const float *rayX,
+                                 float rayY, float scale, int16_t *xyz,
+                                 size_t count);
+
+static inline int16_t roundToInt16(float value) {
+    long rounded = lrintf(value);
+    if (rounded > 32767) {
+        return 32767;
+    }
+    if (rounded < -32768) {
+        return -32768;
+    }
+    return static_cast<int16_t>(rounded);
+}
+
+static void floatPointsScalar(const uint16_t *depth, const float *rayX,
+                              float rayY, float scale, float *xyz,
+                              size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        float z = depth[i] * scale;
+        xyz[3 * i] = z * rayX[i];
+        xyz[3 * i + 1] = z * rayY;
+        xyz[3 * i + 2] = z;
+    }
+}
+
+static void int16PointsScalar(const uint16_t *depth, const float *rayX,
+                              float rayY, float scale, int16_t *xyz,
+                              size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        float z = depth[i] * scale;
+        xyz[3 * i] = roundToInt16(z * rayX[i]);
+        xyz[3 * i + 1] = roundToInt16(z * rayY);
+        xyz[3 * i + 2] = roundToInt16(z);
+    }
+}
+
+#if defined(ADITOF_X86)
+// Turns x0..x3, y0..y3, z0..z3 into x0 y0 z0 x1, y1 z1 x2 y2, z2 x3 y3 z3
+ADITOF_TARGET("sse2")
+static inline void interleave3(__m128 x, __m128 y, __m128 z, __m128 &out0,
+                               __m128 &out1, __m128 &out2) {
+    __m128 xyLo = _mm_unpacklo_ps(x, y);
+    __m128 xyHi = _mm_unpackhi_ps(x, y);
+    __m128 zxLo = _mm_unpacklo_ps(z, x);
+    __m128 zxHi = _mm_unpackhi_ps(z, x);
+    __m128 yzLo = _mm_unpacklo_ps(y, z);
+    __m128 yzHi = _mm_unpackhi_ps(y, z);
+
+    out0 = _mm_shuffle_ps(xyLo, zxLo, _MM_SHUFFLE(3, 0, 1, 0));
+    out1 = _mm_shuffle_ps(yzLo, xyHi, _MM_SHUFFLE(1, 0, 3, 2));
+    out2 = _mm_shuffle_ps(zxHi, yzHi, _MM_SHUFFLE(3, 2, 3, 0));
+}
+
+ADITOF_TARGET("sse2")
+static void floatPointsSse2(const uint16_t *depth, const float *rayX,
+                            float rayY, float scale, float *xyz,
+                            size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scaleVec = _mm_set1_ps(scale);
+    const __m128 rayYVec = _mm_set1_ps(rayY);
+
+    size_t end = count - count % 4;
+    for (size_t i = 0; i < end; i += 4) {
+        __m128i d =
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(depth + i));
+        __m128 z = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(d, zero)),
+                              scaleVec);
+        __m128 x = _mm_mul_ps(z, _mm_loadu_ps(rayX + i));
+        __m128 y = _mm_mul_ps(z, rayYVec);
+
+        __m128 out0, out1, out2;
+        interleave3(x, y, z, out0, out1, out2);
+        _mm_storeu_ps(xyz + 3 * i, out0);
+        _mm_storeu_ps(xyz + 3 * i + 4, out1);
+        _mm_storeu_ps(xyz + 3 * i + 8, out2);
+    }
+
+    floatPointsScalar(depth + end, rayX + end, rayY, scale,
+                      xyz + 3 * end, count - end);
+}
+
+// The coordinates are interleaved while they are still 32 bit wide, then
+// two groups of 4 points are packed with saturation, which keeps the order
+ADITOF_TARGET("sse2")
+static void int16PointsSse2(const uint16_t *depth, const float *rayX,
+                            float rayY, float scale, int16_t *xyz,
+                            size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scaleVec = _mm_set1_ps(scale);
+    const __m128 rayYVec = _mm_set1_ps(rayY);
+
+    size_t end = count - count % 8;
+    for (size_t i = 0; i < end; i += 8) {
+        __m128i d =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(depth + i));
+        __m128i halves[2] = {_mm_unpacklo_epi16(d, zero),
+                             _mm_unpackhi_epi16(d, zero)};
+        __m128i interleaved[6];
+
+        for (int h = 0; h < 2; ++h) {
+            __m128 z = _mm_mul_ps(_mm_cvtepi32_ps(halves[h]), scaleVec);
+            __m128 x = _mm_mul_ps(z, _mm_loadu_ps(rayX + i + 4 * h));
+            __m128 y = _mm_mul_ps(z, rayYVec);
+
+            __m128 out0, out1, out2;
+            interleave3(x, y, z, out0, out1, out2);
+            interleaved[3 * h] = _mm_cvtps_epi32(out0);
+            interleaved[3 * h + 1] = _mm_cvtps_epi32(out1);
+            interleaved[3 * h + 2] = _mm_cvtps_epi32(out2);
+        }
+
+        __m128i *out = reinterpret_cast<__m128i *>(xyz + 3 * i);
+        _mm_storeu_si128(out, _mm_packs_epi32(interleaved[0], interleaved[1]));
+        _mm_storeu_si128(out + 1,
+                         _mm_packs_epi32(interleaved[2], interleaved[3]));
+        _mm_storeu_si128(out + 2,
+                         _mm_packs_epi32(interleaved[4], interleaved[5]));
+    }
+
+    int16PointsScalar(depth + end, rayX + end, rayY, scale,
+                      xyz + 3 * end, count - end);
+}
+#endif // ADITOF_X86
+
+#if defined(ADITOF_NEON)
+static inline int32x4_t roundToInt32(float32x4_t value) {
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(value);
+#else
+    // ARMv7 only converts with truncation: half away from zero
+    const uint32x4_t signMask = vdupq_n_u32(0x80000000);
+    const uint32x4_t half = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+    uint32x4_t signedHalf =
+        vorrq_u32(half, vandq_u32(vreinterpretq_u32_f32(value), signMask));
+    return vcvtq_s32_f32(vaddq_f32(value, vreinterpretq_f32_u32(signedHalf)));
+#endif
+}
+
+static void floatPointsNeon(const uint16_t *depth, const float *rayX,
+                            float rayY, float scale, float *xyz,
+                            size_t count) {
+    size_t end = count - count % 4;
+    for (size_t i = 0; i < end; i += 4) {
+        float32x4x3_t points;
+        points.val[2] =
+            vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vld1_u16(depth + i))), scale);
+        points.val[0] = vmulq_f32(points.val[2], vld1q_f32(rayX + i));
+        points.val[1] = vmulq_n_f32(points.val[2], rayY);
+        vst3q_f32(xyz + 3 * i, points);
+    }
+
+    floatPointsScalar(depth + end, rayX + end, rayY, scale,
+                      xyz + 3 * end, count - end);
+}
+
+static void int16PointsNeon(const uint16_t *depth, const float *rayX,
+                            float rayY, float scale, int16_t *xyz,
+                            size_t count) {
+    size_t end = count - count % 8;
+    for (size_t i = 0; i < end; i += 8) {
+        uint16x8_t d = vld1q_u16(depth + i);
+        float32x4_t z[2] = {
+            vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(d))), scale),
+            vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(d))), scale)};
+        int16x4_t x[2], y[2], zi[2];
+
+        for (int h = 0; h < 2; ++h) {
+            float32x4_t fx = vmulq_f32(z[h], vld1q_f32(rayX + i + 4 * h));
+            float32x4_t fy = vmulq_n_f32(z[h], rayY);
+            x[h] = vqmovn_s32(roundToInt32(fx));
+            y[h] = vqmovn_s32(roundToInt32(fy));
+            zi[h] = vqmovn_s32(roundToInt32(z[h]));
+        }
+
+        int16x8x3_t points;
+        points.val[0] = vcombine_s16(x[0], x[1]);
+        points.val[1] = vcombine_s16(y[0], y[1]);
+        points.val[2] = vcombine_s16(zi[0], zi[1]);
+        vst3q_s16(xyz + 3 * i, points);
+    }
+
+    int16PointsScalar(depth + end, rayX + end, rayY, scale,
+                      xyz + 3 * end, count - end);
+}
+#endif // ADITOF_NEON
+
+static FloatPointKernel selectFloatPointKernel() {
+    const CpuFeatures &features = cpuFeatures();
+
+#if defined(ADITOF_X86)
+    if (features.sse2) {
+        return floatPointsSse2;
+    }
+#endif
+
+#if defined(ADITOF_NEON)
+    if (features.neon) {
+        return floatPointsNeon;
+    }
+#endif
+
+    (void)features;
+    return floatPointsScalar;
+}
+
+static Int16PointKernel selectInt16PointKernel() {
+    const CpuFeatures &features = cpuFeatures();
+
+#if defined(ADITOF_X86)
+    if (features.sse2) {
+        return int16PointsSse2;
+    }
+#endif
+
+#if defined(ADITOF_NEON)
+    if (features.neon) {
+        return int16PointsNeon;
+    }
+#endif
+
+    (void)features;
+    return int16PointsScalar;
+}
+
+// The size is a constant so that the copies are inlined
+template <size_t PointSize>
+static void scatterPoints(const uint8_t *src, uint8_t *dst, size_t dstStep,
+                          size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        memcpy(dst, src, PointSize);
+        src += PointSize;
+        dst += dstStep;
+    }
+}
+
+class PointCloudGeneratorImpl {
+  public:
+    PointCloudGeneratorImpl()
+        : width(0), height(0), floatKernel(selectFloatPointKernel()),
+          int16Kernel(selectInt16PointKernel()) {}
+
+    void computeRow(const uint16_t *depth, unsigned int row,
+                    PointFormat format, void *xyz) const {
+        const uint16_t *rowDepth = depth + static_cast<size_t>(row) * width;
+        if (format == PointFormat::FLOAT32) {
+            floatKernel(rowDepth, rayX.data(), rayY[row], 0.001f,
+                        static_cast<float *>(xyz), width);
+        } else {
+            int16Kernel(rowDepth, rayX.data(), rayY[row], 1.0f,
+                        static_cast<int16_t *>(xyz), width);
+        }
+    }
+
+  public:
+    std::vector<float> cameraMatrix;
+    unsigned int width;
+    unsigned int height;
+
+    // The rays of a pinhole camera are separable: the x of the ray of a
+    // pixel, for a depth of 1, only depends on its column and the y only
+    // on its row. Both tables stay in L1.
+    std::vector<float> rayX;
+    std::vector<float> rayY;
+
+    // The points of a row, when they are interleaved with other fields in
+    // the output
+    std::vector<float> rowPoints;
+
+    FloatPointKernel floatKernel;
+    Int16PointKernel int16Kernel;
+};
+
+PointCloudGenerator::PointCloudGenerator()
+    : m_impl(new PointCloudGeneratorImpl) {}
+
+PointCloudGenerator::~PointCloudGenerator() = default;
+
+Status PointCloudGenerator::setIntrinsics(const IntrinsicParameters &intrinsics,
+                                          unsigned int width,
+                                          unsigned int height) {
+    const std::vector<float> &k = intrinsics.cameraMatrix;
+    if (k.size() < 9 || k[0] == 0.0f || k[4] == 0.0f) {
+        LOG(WARNING) << "Invalid camera matrix";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    if (k == m_impl->cameraMatrix && width == m_impl->width &&
+        height == m_impl->height) {
+        return Status::OK;
+    }
+
+    const float fx = k[0];
+    const float fy = k[4];
+    const float cx = k[2];
+    const float cy = k[5];
+
+    m_impl->rayX.resize(width);
+    for (unsigned int u = 0; u < width; ++u) {
+        m_impl->rayX[u] = (static_cast<float>(u) - cx) / fx;
+    }
+
+    m_impl->rayY.resize(height);
+    for (unsigned int v = 0; v < height; ++v) {
+        m_impl->rayY[v] = (static_cast<float>(v) - cy) / fy;
+    }
+
+    m_impl->rowPoints.resize(3 * static_cast<size_t>(width));
+    m_impl->cameraMatrix = k;
+    m_impl->width = width;
+    m_impl->height = height;
+
+    return Status::OK;
+}
+
+Status PointCloudGenerator::compute(const uint16_t *depth, const uint16_t *ir,
+                                    const PointCloudBuffer &output) {
+    const size_t pointCount = getPointCount();
+    if (pointCount == 0) {
+        LOG(WARNING) << "The intrinsic parameters are not set";
+        return Status::UNAVAILABLE;
+    }
+
+    if (!depth || !output.points || (output.intensity && !ir)) {
+        LOG(WARNING) << "Missing depth, IR or output buffer";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    const size_t coordinateSize =
+        output.format == PointFormat::FLOAT32 ? sizeof(float) : sizeof(int16_t);
+    const size_t packedStep = 3 * coordinateSize;
+    const size_t pointStep = output.pointStep ? output.pointStep : packedStep;
+    if (pointStep < packedStep) {
+        LOG(WARNING) << "The point step is smaller than a point";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    const size_t intensityStep =
+        output.intensityStep ? output.intensityStep : sizeof(uint16_t);
+    const unsigned int width = m_impl->width;
+    uint8_t *points = static_cast<uint8_t *>(output.points);
+    uint8_t *intensity = reinterpret_cast<uint8_t *>(output.intensity);
+
+    // The output is written row by row, so that interleaved points and
+    // intensities share the cache lines written for a row
+    for (unsigned int row = 0; row < m_impl->height; ++row) {
+        const size_t first = static_cast<size_t>(row) * width;
+        uint8_t *rowOutput = points + first * pointStep;
+
+        if (pointStep == packedStep) {
+            m_impl->computeRow(depth, row, output.format, rowOutput);
+        } else {
+            // The points are computed packed, while they are in L1, then
+            // scattered
+            m_impl->computeRow(depth, row, output.format,
+                               m_impl->rowPoints.data());
+            const uint8_t *src =
+                reinterpret_cast<const uint8_t *>(m_impl->rowPoints.data());
+            if (output.format == PointFormat::FLOAT32) {
+                scatterPoints<3 * sizeof(float)>(src, rowOutput, pointStep,
+                                                 width);
+            } else {
+                scatterPoints<3 * sizeof(int16_t)>(src, rowOutput, pointStep,
+                                                   width);
+            }
+        }
+
+        if (!intensity) {
+            continue;
+        }
+        uint8_t *rowIntensity = intensity + first * intensityStep;
+        if (intensityStep == sizeof(uint16_t)) {
+            memcpy(rowIntensity, ir + first, width * sizeof(uint16_t));
+        } else {
+            for (unsigned int i = 0; i < width; ++i) {
+                memcpy(rowIntensity, ir + first + i, sizeof(uint16_t));
+                rowIntensity += intensityStep;
+            }
+        }
+    }
+
+    return Status::OK;
+}
+
+Status PointCloudGenerator::compute(Frame &frame,
+                                    const PointCloudBuffer &output) {
+    FrameDetails details;
+    frame.getDetails(details);
+
+    // The depth data is the first half of the frame, the IR data the second
+    if (details.width != m_impl->width ||
+        details.height / 2 != m_impl->height) {
+        LOG(WARNING) << "The frame is " << details.width << "x"
+                     << details.height / 2 << " but the rays are computed for "
+                     << m_impl->width << "x" << m_impl->height;
+        return Status::INVALID_ARGUMENT;
+    }
+
+    uint16_t *depth = nullptr;
+    uint16_t *ir = nullptr;
+    frame.getData(FrameDataType::DEPTH, &depth);
+    frame.getData(FrameDataType::IR, &ir);
+
+    return compute(depth, ir, output);
+}
+
+size_t PointCloudGenerator::getPointCount() const {
+    return static_cast<size_t>(m_impl->width) * m_impl->height;
+}
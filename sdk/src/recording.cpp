@@ -0,0 +1,612 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "block_file_writer.h"
+#include "mapped_file.h"
+#include "recording_format.h"
+
+#include <aditof/frame_operations.h>
+#include <aditof/recording.h>
+
+#include <cstring>
+#include <glog/logging.h>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+using namespace aditof;
+
+static const char skPadding[8] = {0};
+
+static uint64_t paddedSize(uint64_t size) { return (size + 7) & ~uint64_t(7); }
+
+static void writeFloats(std::ostream &out, const char *key,
+                        const std::vector<float> &values) {
+    out << key << " " << values.size();
+    for (float value : values) {
+        out << " " << value;
+    }
+    out << "\n";
+}
+
+static bool readFloats(std::istream &in, std::vector<float> &values) {
+    size_t count;
+    if (!(in >> count) || count > 64) {
+        return false;
+    }
+    values.resize(count);
+    for (float &value : values) {
+        if (!(in >> value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! serializeDetails - Text payload of the INFO chunk
+static std::string serializeDetails(const CameraDetails &details,
+                                    unsigned int fps) {
+    std::ostringstream out;
+    out << std::setprecision(std::numeric_limits<float>::max_digits10);
+
+    out << "camera_id " << details.cameraId << "\n";
+    out << "mode " << details.mode << "\n";
+    out << "frame_type " << details.frameType.type << " "
+        << details.frameType.width << " " << details.frameType.height << "\n";
+    out << "connection " << static_cast<int>(details.connection) << "\n";
+    writeFloats(out, "camera_matrix", details.intrinsics.cameraMatrix);
+    writeFloats(out, "dist_coeffs", details.intrinsics.distCoeffs);
+    out << "pixel_size " << details.intrinsics.pixelWidth << " "
+        << details.intrinsics.pixelHeight << "\n";
+    out << "depth_range " << details.minDepth << " " << details.maxDepth
+        << "\n";
+    out << "bit_count " << details.bitCount << "\n";
+    out << "fps " << fps << "\n";
+
+    return out.str();
+}
+
+//! parseDetails - Reads the payload of the INFO chunk
+static bool parseDetails(const char *data, size_t size, CameraDetails &details,
+                         unsigned int &fps) {
+    std::istringstream in(std::string(data, size));
+    std::string line;
+
+    while (std::getline(in, line)) {
+        std::istringstream entry(line);
+        std::string key;
+        if (!(entry >> key)) {
+            continue;
+        }
+
+        bool valid = true;
+        if (key == "camera_id") {
+            entry >> std::ws;
+            std::getline(entry, details.cameraId);
+        } else if (key == "mode") {
+            entry >> details.mode;
+        } else if (key == "frame_type") {
+            valid = static_cast<bool>(entry >> details.frameType.type >>
+                                      details.frameType.width >>
+                                      details.frameType.height);
+        } else if (key == "connection") {
+            int connection;
+            valid = static_cast<bool>(entry >> connection);
+            details.connection = static_cast<ConnectionType>(connection);
+        } else if (key == "camera_matrix") {
+            valid = readFloats(entry, details.intrinsics.cameraMatrix);
+        } else if (key == "dist_coeffs") {
+            valid = readFloats(entry, details.intrinsics.distCoeffs);
+        } else if (key == "pixel_size") {
+            valid = static_cast<bool>(entry >> details.intrinsics.pixelWidth >>
+                                      details.intrinsics.pixelHeight);
+        } else if (key == "depth_range") {
+            valid = static_cast<bool>(entry >> details.minDepth >>
+                                      details.maxDepth);
+        } else if (key == "bit_count") {
+            valid = static_cast<bool>(entry >> details.bitCount);
+        } else if (key == "fps") {
+            valid = static_cast<bool>(entry >> fps);
+        }
+
+        if (!valid) {
+            LOG(WARNING) << "Invalid recording details: " << line;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Frames are written in blocks of 4 MiB. The 16 blocks buffer about two
+// seconds of depth_ir frames at 30 fps when the storage stalls.
+static const size_t skWriterBlockSize = 4 << 20;
+static const size_t skWriterBlockCount = 16;
+
+static size_t packedSize(size_t pixelCount) { return (pixelCount + 1) / 2 * 3; }
+
+//! packPixels - Packs pixels two by two in three bytes, like the sensor does
+/*!
+    \return false if a pixel doesn't fit in 12 bits, the packed data being
+    incomplete then. Calibrated depth can exceed 12 bits in the far modes.
+*/
+static bool packPixels(const uint16_t *pixels, size_t pixelCount,
+                       uint8_t *packed) {
+    uint16_t allBits = 0;
+    size_t i = 0;
+
+    for (; i + 1 < pixelCount; i += 2, packed += 3) {
+        uint16_t first = pixels[i];
+        uint16_t second = pixels[i + 1];
+        allBits |= first | second;
+        packed[0] = static_cast<uint8_t>(first >> 4);
+        packed[1] = static_cast<uint8_t>(second >> 4);
+        packed[2] = static_cast<uint8_t>((first & 0xF) | ((second & 0xF) << 4));
+    }
+    if (i < pixelCount) {
+        allBits |= pixels[i];
+        packed[0] = static_cast<uint8_t>(pixels[i] >> 4);
+        packed[1] = 0;
+        packed[2] = static_cast<uint8_t>(pixels[i] & 0xF);
+    }
+
+    return (allBits & 0xF000) == 0;
+}
+
+//! unpackPixels - Reverts packPixels()
+static void unpackPixels(const uint8_t *packed, size_t pixelCount,
+                         uint16_t *pixels) {
+    size_t i = 0;
+
+    for (; i + 1 < pixelCount; i += 2, packed += 3) {
+        pixels[i] = static_cast<uint16_t>((packed[0] << 4) | (packed[2] & 0xF));
+        pixels[i + 1] =
+            static_cast<uint16_t>((packed[1] << 4) | (packed[2] >> 4));
+    }
+    if (i < pixelCount) {
+        pixels[i] = static_cast<uint16_t>((packed[0] << 4) | (packed[2] & 0xF));
+    }
+}
+
+class RecordingWriterImpl {
+  public:
+    RecordingWriterImpl() : file(skWriterBlockSize, skWriterBlockCount) {}
+
+    BlockFileWriter file;
+    FrameDetails frameDetails;
+    std::vector<uint64_t> index;
+    std::vector<uint8_t> packed;
+    size_t droppedFrames = 0;
+
+    //! writeChunk - Appends a chunk made of a header and of two parts
+    void writeChunk(uint32_t tag, const void *first, uint64_t firstSize,
+                    const void *second, uint64_t secondSize) {
+        RecordingChunkHeader header;
+        header.tag = tag;
+        header.reserved = 0;
+        header.size = firstSize + secondSize;
+
+        file.append(&header, sizeof(header));
+        file.append(first, firstSize);
+        if (secondSize) {
+            file.append(second, secondSize);
+        }
+        file.append(skPadding, paddedSize(header.size) - header.size);
+    }
+};
+
+namespace aditof {
+
+RecordingWriter::RecordingWriter() : m_impl(new RecordingWriterImpl) {}
+
+RecordingWriter::~RecordingWriter() {
+    if (isOpen()) {
+        close();
+    }
+}
+
+Status RecordingWriter::open(const std::string &fileName,
+                             const CameraDetails &details, unsigned int fps) {
+    if (isOpen()) {
+        close();
+    }
+
+    if (!m_impl->file.open(fileName)) {
+        LOG(WARNING) << "Cannot create recording: " << fileName;
+        return Status::UNREACHABLE;
+    }
+
+    m_impl->index.clear();
+    m_impl->droppedFrames = 0;
+    m_impl->frameDetails = details.frameType;
+
+    RecordingFileHeader header;
+    memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+    header.version = RECORDING_VERSION;
+    header.reserved = 0;
+    header.headerSize = sizeof(header);
+    m_impl->file.append(&header, sizeof(header));
+
+    std::string info = serializeDetails(details, fps);
+    m_impl->writeChunk(RECORDING_INFO_TAG, info.data(), info.size(), nullptr,
+                       0);
+
+    return Status::OK;
+}
+
+Status RecordingWriter::writeFrame(Frame &frame, float afeTemperature,
+                                   float laserTemperature) {
+    if (!isOpen()) {
+        LOG(WARNING) << "No recording open";
+        return Status::UNAVAILABLE;
+    }
+
+    if (m_impl->file.failed()) {
+        LOG(WARNING) << "Cannot write frame to recording";
+        return Status::GENERIC_ERROR;
+    }
+
+    FrameDetails details;
+    frame.getDetails(details);
+    if (details != m_impl->frameDetails) {
+        LOG(WARNING) << "The frame type differs from the one of the recording";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    uint16_t *data;
+    Status status = frame.getData(FrameDataType::RAW, &data);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    FrameMetadata metadata;
+    frame.getMetadata(metadata);
+
+    RecordingFrameRecord record;
+    record.sequence = metadata.sequence;
+    record.sensorTimestamp = metadata.sensorTimestamp;
+    record.dequeueTimestamp = metadata.dequeueTimestamp;
+    record.readyTimestamp = metadata.readyTimestamp;
+    record.transferTime = metadata.transferTime;
+    record.unpackTime = metadata.unpackTime;
+    record.calibrationTime = metadata.calibrationTime;
+    record.afeTemperature = afeTemperature;
+    record.laserTemperature = laserTemperature;
+
+    // Frames are stored in 12 bits per pixel unless some values don't fit
+    size_t pixelCount = static_cast<size_t>(details.width) * details.height;
+    m_impl->packed.resize(packedSize(pixelCount));
+    const void *frameData = m_impl->packed.data();
+    if (packPixels(data, pixelCount, m_impl->packed.data())) {
+        record.dataFormat =
+            static_cast<uint32_t>(RecordingDataFormat::PACKED_12);
+        record.dataSize = static_cast<uint32_t>(m_impl->packed.size());
+    } else {
+        frameData = data;
+        record.dataFormat =
+            static_cast<uint32_t>(RecordingDataFormat::UNPACKED_16);
+        record.dataSize = static_cast<uint32_t>(sizeof(uint16_t) * pixelCount);
+    }
+
+    // Drop the frame rather than block the capture when the storage is
+    // behind
+    uint64_t chunkSize = sizeof(RecordingChunkHeader) +
+                         paddedSize(sizeof(record) + record.dataSize);
+    if (m_impl->file.available() < chunkSize) {
+        ++m_impl->droppedFrames;
+        return Status::BUSY;
+    }
+
+    m_impl->index.push_back(m_impl->file.offset());
+    m_impl->writeChunk(RECORDING_FRAME_TAG, &record, sizeof(record),
+                       frameData, record.dataSize);
+
+    return Status::OK;
+}
+
+Status RecordingWriter::close() {
+    if (!isOpen()) {
+        return Status::OK;
+    }
+
+    RecordingFileTrailer trailer;
+    memcpy(trailer.magic, RECORDING_INDEX_MAGIC, sizeof(trailer.magic));
+    trailer.indexOffset = m_impl->file.offset();
+
+    m_impl->writeChunk(RECORDING_INDEX_TAG, m_impl->index.data(),
+                       m_impl->index.size() * sizeof(uint64_t), nullptr, 0);
+    m_impl->file.append(&trailer, sizeof(trailer));
+
+    if (m_impl->droppedFrames > 0) {
+        LOG(WARNING) << m_impl->droppedFrames
+                     << " frames were dropped, the storage was too slow";
+    }
+
+    if (!m_impl->file.close()) {
+        LOG(WARNING) << "Cannot write recording";
+        return Status::GENERIC_ERROR;
+    }
+
+    return Status::OK;
+}
+
+bool RecordingWriter::isOpen() const { return m_impl->file.isOpen(); }
+
+size_t RecordingWriter::getFrameCount() const { return m_impl->index.size(); }
+
+size_t RecordingWriter::getDroppedFrameCount() const {
+    return m_impl->droppedFrames;
+}
+
+} // namespace aditof
+
+class RecordingReaderImpl {
+  public:
+    MappedFile file;
+
+    CameraDetails details;
+    unsigned int fps = 0;
+    std::vector<uint64_t> index;
+
+    const RecordingChunkHeader *chunkAt(uint64_t offset) const;
+    const RecordingFrameRecord *frameAt(size_t index) const;
+    bool readIndex();
+    void scanChunks();
+};
+
+const RecordingChunkHeader *
+RecordingReaderImpl::chunkAt(uint64_t offset) const {
+    const uint64_t size = file.size();
+    if (offset % 8 || offset > size ||
+        size - offset < sizeof(RecordingChunkHeader)) {
+        return nullptr;
+    }
+
+    auto chunk =
+        reinterpret_cast<const RecordingChunkHeader *>(file.data() + offset);
+    if (chunk->size > size - offset - sizeof(RecordingChunkHeader)) {
+        return nullptr;
+    }
+
+    return chunk;
+}
+
+const RecordingFrameRecord *RecordingReaderImpl::frameAt(size_t i) const {
+    if (i >= index.size()) {
+        return nullptr;
+    }
+
+    const RecordingChunkHeader *chunk = chunkAt(index[i]);
+    if (!chunk || chunk->tag != RECORDING_FRAME_TAG ||
+        chunk->size < sizeof(RecordingFrameRecord)) {
+        return nullptr;
+    }
+
+    auto record = reinterpret_cast<const RecordingFrameRecord *>(chunk + 1);
+    if (record->dataSize > chunk->size - sizeof(RecordingFrameRecord)) {
+        return nullptr;
+    }
+
+    return record;
+}
+
+bool RecordingReaderImpl::readIndex() {
+    const uint64_t size = file.size();
+    if (size < sizeof(RecordingFileHeader) + sizeof(RecordingFileTrailer)) {
+        return false;
+    }
+
+    // The file may have been cut anywhere, so the trailer is not necessarily
+    // aligned
+    RecordingFileTrailer trailer;
+    memcpy(&trailer, file.data() + size - sizeof(trailer), sizeof(trailer));
+    if (memcmp(trailer.magic, RECORDING_INDEX_MAGIC, sizeof(trailer.magic))) {
+        return false;
+    }
+
+    const RecordingChunkHeader *chunk = chunkAt(trailer.indexOffset);
+    if (!chunk || chunk->tag != RECORDING_INDEX_TAG) {
+        return false;
+    }
+
+    auto entries = reinterpret_cast<const uint64_t *>(chunk + 1);
+    index.assign(entries, entries + chunk->size / sizeof(uint64_t));
+
+    return true;
+}
+
+void RecordingReaderImpl::scanChunks() {
+    index.clear();
+
+    uint64_t offset = sizeof(RecordingFileHeader);
+    while (const RecordingChunkHeader *chunk = chunkAt(offset)) {
+        if (chunk->tag == RECORDING_FRAME_TAG) {
+            index.push_back(offset);
+        }
+        offset += sizeof(RecordingChunkHeader) + paddedSize(chunk->size);
+    }
+}
+
+namespace aditof {
+
+RecordingReader::RecordingReader() : m_impl(new RecordingReaderImpl) {}
+
+RecordingReader::~RecordingReader() { close(); }
+
+Status RecordingReader::open(const std::string &fileName) {
+    close();
+
+    if (!m_impl->file.open(fileName)) {
+        LOG(WARNING) << "Cannot open recording: " << fileName;
+        return Status::UNREACHABLE;
+    }
+
+    auto header =
+        reinterpret_cast<const RecordingFileHeader *>(m_impl->file.data());
+    if (m_impl->file.size() < sizeof(RecordingFileHeader) ||
+        memcmp(header->magic, RECORDING_MAGIC, sizeof(header->magic))) {
+        LOG(WARNING) << fileName << " is not a recording";
+        close();
+        return Status::INVALID_ARGUMENT;
+    }
+    if (header->version > RECORDING_VERSION) {
+        LOG(WARNING) << "Unsupported recording version: " << header->version;
+        close();
+        return Status::UNAVAILABLE;
+    }
+
+    const RecordingChunkHeader *info =
+        m_impl->chunkAt(sizeof(RecordingFileHeader));
+    if (!info || info->tag != RECORDING_INFO_TAG ||
+        !parseDetails(reinterpret_cast<const char *>(info + 1), info->size,
+                      m_impl->details, m_impl->fps)) {
+        LOG(WARNING) << "The recording has no valid camera details";
+        close();
+        return Status::INVALID_ARGUMENT;
+    }
+
+    if (!m_impl->readIndex()) {
+        LOG(WARNING) << "The recording was not closed, looking for its frames";
+        m_impl->scanChunks();
+    }
+
+    return Status::OK;
+}
+
+void RecordingReader::close() {
+    m_impl->file.close();
+    m_impl->details = CameraDetails();
+    m_impl->fps = 0;
+    m_impl->index.clear();
+}
+
+bool RecordingReader::isOpen() const { return m_impl->file.isOpen(); }
+
+Status RecordingReader::getCameraDetails(CameraDetails &details) const {
+    if (!isOpen()) {
+        return Status::UNAVAILABLE;
+    }
+    details = m_impl->details;
+
+    return Status::OK;
+}
+
+unsigned int RecordingReader::getFps() const { return m_impl->fps; }
+
+size_t RecordingReader::getFrameCount() const { return m_impl->index.size(); }
+
+Status RecordingReader::getFrameInfo(size_t index,
+                                     RecordedFrameInfo &info) const {
+    const RecordingFrameRecord *record = m_impl->frameAt(index);
+    if (!record) {
+        LOG(WARNING) << "Invalid frame index: " << index;
+        return Status::INVALID_ARGUMENT;
+    }
+
+    info.metadata.sequence = record->sequence;
+    info.metadata.sensorTimestamp = record->sensorTimestamp;
+    info.metadata.dequeueTimestamp = record->dequeueTimestamp;
+    info.metadata.readyTimestamp = record->readyTimestamp;
+    info.metadata.transferTime = record->transferTime;
+    info.metadata.unpackTime = record->unpackTime;
+    info.metadata.calibrationTime = record->calibrationTime;
+    info.afeTemperature = record->afeTemperature;
+    info.laserTemperature = record->laserTemperature;
+
+    return Status::OK;
+}
+
+Status RecordingReader::getFrameData(size_t index,
+                                     const uint16_t **data) const {
+    const RecordingFrameRecord *record = m_impl->frameAt(index);
+    if (!record) {
+        LOG(WARNING) << "Invalid frame index: " << index;
+        return Status::INVALID_ARGUMENT;
+    }
+
+    const FrameDetails &details = m_impl->details.frameType;
+    if (record->dataFormat !=
+            static_cast<uint32_t>(RecordingDataFormat::UNPACKED_16) ||
+        record->dataSize != sizeof(uint16_t) * details.width * details.height) {
+        return Status::UNAVAILABLE;
+    }
+
+    *data = reinterpret_cast<const uint16_t *>(record + 1);
+
+    return Status::OK;
+}
+
+Status RecordingReader::readFrame(size_t index, Frame &frame) const {
+    const RecordingFrameRecord *record = m_impl->frameAt(index);
+    if (!record) {
+        LOG(WARNING) << "Invalid frame index: " << index;
+        return Status::INVALID_ARGUMENT;
+    }
+
+    const FrameDetails &details = m_impl->details.frameType;
+    size_t pixelCount = static_cast<size_t>(details.width) * details.height;
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(record + 1);
+    bool packed = false;
+
+    if (record->dataFormat ==
+            static_cast<uint32_t>(RecordingDataFormat::PACKED_12) &&
+        record->dataSize == packedSize(pixelCount)) {
+        packed = true;
+    } else if (record->dataFormat !=
+                   static_cast<uint32_t>(RecordingDataFormat::UNPACKED_16) ||
+               record->dataSize != sizeof(uint16_t) * pixelCount) {
+        LOG(WARNING) << "Unsupported data in frame " << index;
+        return Status::UNAVAILABLE;
+    }
+
+    RecordedFrameInfo info;
+    getFrameInfo(index, info);
+
+    FrameDetails frameDetails;
+    frame.getDetails(frameDetails);
+    if (frameDetails != details) {
+        frame.setDetails(details);
+    }
+
+    uint16_t *frameData;
+    frame.getData(FrameDataType::RAW, &frameData);
+    if (packed) {
+        unpackPixels(data, pixelCount, frameData);
+    } else {
+        memcpy(frameData, data, sizeof(uint16_t) * pixelCount);
+    }
+    frame.setMetadata(info.metadata);
+
+    return Status::OK;
+}
+
+} // namespace aditof
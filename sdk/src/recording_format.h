@@ -0,0 +1,121 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RECORDING_FORMAT_H
+#define RECORDING_FORMAT_H
+
+#include <stdint.h>
+
+//! recording_format - Layout of the files written by RecordingWriter
+/*!
+    A recording is a file header followed by chunks. Every chunk is a
+    ChunkHeader and a payload padded to a multiple of 8 bytes, so that all
+    the payloads are 8 byte aligned when the file is mapped in memory:
+
+        FileHeader
+        INFO chunk  - the camera details, as "key values" text lines
+        FRAM chunk  - a FrameRecord followed by the frame data
+        ...
+        INDX chunk  - the file offset of every FRAM chunk (uint64_t each)
+        FileTrailer - the file offset of the INDX chunk
+
+    Values are little endian. Readers skip the chunks they don't know, so
+    chunks can be added without changing the version. A recording that was
+    not closed has no index and no trailer; its frames are found by walking
+    the chunks.
+*/
+
+namespace aditof {
+
+static const char RECORDING_MAGIC[8] = {'A', 'D', 'I', 'T', 'O', 'F', 'R', 'C'};
+static const char RECORDING_INDEX_MAGIC[8] = {'A', 'D', 'I', 'T',
+                                              'O', 'F', 'I', 'X'};
+static const uint16_t RECORDING_VERSION = 1;
+
+constexpr uint32_t recordingTag(char a, char b, char c, char d) {
+    return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) |
+           (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+}
+
+static const uint32_t RECORDING_INFO_TAG = recordingTag('I', 'N', 'F', 'O');
+static const uint32_t RECORDING_FRAME_TAG = recordingTag('F', 'R', 'A', 'M');
+static const uint32_t RECORDING_INDEX_TAG = recordingTag('I', 'N', 'D', 'X');
+
+//! RecordingDataFormat - How the data of a recorded frame is stored
+enum class RecordingDataFormat : uint32_t {
+    UNPACKED_16 = 0, //!< the data of the Frame, 16 bits per pixel
+    PACKED_12 = 1,   //!< the same pixels packed two by two in three bytes
+};
+
+//! RecordingFileHeader - Starts the file
+struct RecordingFileHeader {
+    char magic[8];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t headerSize;
+};
+
+//! RecordingChunkHeader - Starts every chunk
+struct RecordingChunkHeader {
+    uint32_t tag;
+    uint32_t reserved;
+    uint64_t size; //!< of the payload, without the padding
+};
+
+//! RecordingFrameRecord - Starts the payload of a FRAM chunk
+struct RecordingFrameRecord {
+    uint32_t sequence;
+    uint32_t dataFormat;
+    uint64_t sensorTimestamp;
+    uint64_t dequeueTimestamp;
+    uint64_t readyTimestamp;
+    uint32_t transferTime;
+    uint32_t unpackTime;
+    uint32_t calibrationTime;
+    float afeTemperature;
+    float laserTemperature;
+    uint32_t dataSize; //!< of the frame data following the record
+};
+
+//! RecordingFileTrailer - Ends the file of a closed recording
+struct RecordingFileTrailer {
+    uint64_t indexOffset;
+    char magic[8];
+};
+
+static_assert(sizeof(RecordingFileHeader) == 16, "Unexpected padding");
+static_assert(sizeof(RecordingChunkHeader) == 16, "Unexpected padding");
+static_assert(sizeof(RecordingFrameRecord) == 56, "Unexpected padding");
+static_assert(sizeof(RecordingFileTrailer) == 16, "Unexpected padding");
+
+} // namespace aditof
+
+#endif // RECORDING_FORMAT_H
@@ -0,0 +1,460 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "replay_device.h"
+#include "device_utils.h"
+#include "frame_lease_impl.h"
+
+#include <aditof/frame_lease.h>
+#include <aditof/frame_operations.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <glog/logging.h>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+struct ReplayFrameType {
+    aditof::FrameDetails details;
+    std::string file;
+};
+
+struct ReplayDevice::ImplData {
+    bool manifestLoaded = false;
+    std::string directory;
+    std::vector<ReplayFrameType> frameTypes;
+    std::string eepromFile;
+    std::string firmwareFile;
+    std::string afeRegistersFile;
+    float afeTemperature = 25.0f;
+    float laserTemperature = 25.0f;
+    double fps = 0.0;
+
+    std::vector<uint8_t> eeprom;
+    std::vector<uint8_t> firmware;
+    std::unordered_map<uint16_t, uint16_t> afeRegisters;
+
+    aditof::FrameDetails frameDetails;
+    // Shared with the leases, which keep the frames of a previous frame type
+    // alive after it changed
+    std::shared_ptr<const std::vector<uint8_t>> frames;
+    size_t frameSize = 0;
+    size_t frameCount = 0;
+    size_t frameIndex = 0;
+    bool started = false;
+    std::chrono::steady_clock::time_point nextFrameTime;
+    uint32_t sequence = 0;
+    aditof::FrameMetadata metadata;
+};
+
+static bool readFile(const std::string &path, std::vector<uint8_t> &data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    data.resize(static_cast<size_t>(size));
+
+    return size == 0 ||
+           file.read(reinterpret_cast<char *>(data.data()), size).good();
+}
+
+ReplayDevice::ReplayDevice(const aditof::DeviceConstructionData &data)
+    : m_devData(data), m_implData(new ReplayDevice::ImplData) {
+    m_deviceDetails.sensorType = aditof::SensorType::SENSOR_96TOF1;
+
+    // The sensor type must be known before the device is opened
+    loadManifest();
+}
+
+ReplayDevice::~ReplayDevice() = default;
+
+aditof::Status ReplayDevice::loadManifest() {
+    using namespace aditof;
+
+    std::ifstream manifest(m_devData.driverPath);
+    if (!manifest) {
+        LOG(WARNING) << "Cannot open replay manifest: " << m_devData.driverPath;
+        return Status::UNREACHABLE;
+    }
+
+    size_t separator = m_devData.driverPath.find_last_of("/\\");
+    if (separator != std::string::npos) {
+        m_implData->directory = m_devData.driverPath.substr(0, separator + 1);
+    }
+
+    std::string line;
+    while (std::getline(manifest, line)) {
+        std::istringstream entry(line);
+        std::string key;
+        if (!(entry >> key) || key[0] == '#') {
+            continue;
+        }
+
+        bool valid = true;
+        if (key == "sensor") {
+            std::string sensor;
+            valid = static_cast<bool>(entry >> sensor);
+            if (sensor == "96tof1") {
+                m_deviceDetails.sensorType = SensorType::SENSOR_96TOF1;
+            } else if (sensor == "chicony") {
+                m_deviceDetails.sensorType = SensorType::SENSOR_CHICONY;
+            } else {
+                valid = false;
+            }
+        } else if (key == "frame_type") {
+            ReplayFrameType frameType;
+            valid = static_cast<bool>(
+                entry >> frameType.details.type >> frameType.details.width >>
+                frameType.details.height >> frameType.file);
+            frameType.file = m_implData->directory + frameType.file;
+            m_implData->frameTypes.push_back(frameType);
+        } else if (key == "eeprom") {
+            valid = static_cast<bool>(entry >> m_implData->eepromFile);
+            m_implData->eepromFile =
+                m_implData->directory + m_implData->eepromFile;
+        } else if (key == "firmware") {
+            valid = static_cast<bool>(entry >> m_implData->firmwareFile);
+            m_implData->firmwareFile =
+                m_implData->directory + m_implData->firmwareFile;
+        } else if (key == "afe_registers") {
+            valid = static_cast<bool>(entry >> m_implData->afeRegistersFile);
+            m_implData->afeRegistersFile =
+                m_implData->directory + m_implData->afeRegistersFile;
+        } else if (key == "temperature") {
+            valid = static_cast<bool>(entry >> m_implData->afeTemperature >>
+                                      m_implData->laserTemperature);
+        } else if (key == "fps") {
+            valid = static_cast<bool>(entry >> m_implData->fps);
+        } else {
+            LOG(WARNING) << "Unknown replay manifest entry: " << key;
+        }
+
+        if (!valid) {
+            LOG(WARNING) << "Invalid replay manifest entry: " << line;
+            return Status::INVALID_ARGUMENT;
+        }
+    }
+
+    m_implData->manifestLoaded = true;
+
+    return Status::OK;
+}
+
+aditof::Status ReplayDevice::open() {
+    using namespace aditof;
+
+    LOG(INFO) << "Opening replay device: " << m_devData.driverPath;
+
+    if (!m_implData->manifestLoaded) {
+        return Status::UNREACHABLE;
+    }
+
+    if (!m_implData->eepromFile.empty() &&
+        !readFile(m_implData->eepromFile, m_implData->eeprom)) {
+        LOG(WARNING) << "Cannot read " << m_implData->eepromFile;
+        return Status::UNREACHABLE;
+    }
+
+    if (!m_implData->firmwareFile.empty() &&
+        !readFile(m_implData->firmwareFile, m_implData->firmware)) {
+        LOG(WARNING) << "Cannot read " << m_implData->firmwareFile;
+        return Status::UNREACHABLE;
+    }
+
+    if (!m_implData->afeRegistersFile.empty()) {
+        std::vector<uint8_t> registers;
+        if (!readFile(m_implData->afeRegistersFile, registers)) {
+            LOG(WARNING) << "Cannot read " << m_implData->afeRegistersFile;
+            return Status::UNREACHABLE;
+        }
+        for (size_t i = 0; i + 4 <= registers.size(); i += 4) {
+            uint16_t address = registers[i] | (registers[i + 1] << 8);
+            uint16_t value = registers[i + 2] | (registers[i + 3] << 8);
+            m_implData->afeRegisters[address] = value;
+        }
+    }
+
+    return Status::OK;
+}
+
+aditof::Status ReplayDevice::start() {
+    m_implData->started = true;
+    m_implData->nextFrameTime = std::chrono::steady_clock::now();
+
+    return aditof::Status::OK;
+}
+
+aditof::Status ReplayDevice::stop() {
+    m_implData->started = false;
+
+    return aditof::Status::OK;
+}
+
+aditof::Status
+ReplayDevice::getAvailableFrameTypes(std::vector<aditof::FrameDetails> &types) {
+    for (const auto &frameType : m_implData->frameTypes) {
+        types.push_back(frameType.details);
+    }
+
+    return aditof::Status::OK;
+}
+
+aditof::Status
+ReplayDevice::setFrameType(const aditof::FrameDetails &details) {
+    using namespace aditof;
+
+    if (details == m_implData->frameDetails && m_implData->frameCount > 0) {
+        return Status::OK;
+    }
+
+    auto frameType = std::find_if(
+        m_implData->frameTypes.begin(), m_implData->frameTypes.end(),
+        [&details](const ReplayFrameType &replayType) {
+            return replayType.details.type == details.type &&
+                   replayType.details.width == details.width &&
+                   replayType.details.height == details.height;
+        });
+    if (frameType == m_implData->frameTypes.end()) {
+        LOG(WARNING) << "Frame type " << details.type
+                     << " is not part of the recording";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    // The whole recording is kept in memory so that the playback does not
+    // depend on the speed of the disk
+    auto frames = std::make_shared<std::vector<uint8_t>>();
+    if (!readFile(frameType->file, *frames)) {
+        LOG(WARNING) << "Cannot read " << frameType->file;
+        return Status::UNREACHABLE;
+    }
+
+    size_t frameSize = details.width * details.height * 3 / 2;
+    size_t frameCount = frameSize ? frames->size() / frameSize : 0;
+    if (frameCount == 0) {
+        LOG(WARNING) << frameType->file << " does not hold a whole frame";
+        return Status::GENERIC_ERROR;
+    }
+
+    m_implData->frames = frames;
+    m_implData->frameDetails = details;
+    m_implData->frameSize = frameSize;
+    m_implData->frameCount = frameCount;
+    m_implData->frameIndex = 0;
+
+    return Status::OK;
+}
+
+aditof::Status ReplayDevice::program(const uint8_t * /*firmware*/,
+                                     size_t /*size*/) {
+    // There is no sensor to program, the recording already has the frames
+    return aditof::Status::OK;
+}
+
+const uint8_t *ReplayDevice::nextFrame() {
+    aditof::FrameMetadata &metadata = m_implData->metadata;
+    uint64_t requestTimestamp = aditof::monotonicTimestamp();
+
+    if (m_implData->fps > 0.0) {
+        // A consumer slower than the sensor gets frames at its own pace, it
+        // does not get a burst of frames to catch up
+        auto now = std::chrono::steady_clock::now();
+        if (now < m_implData->nextFrameTime) {
+            std::this_thread::sleep_until(m_implData->nextFrameTime);
+            now = m_implData->nextFrameTime;
+        }
+        m_implData->nextFrameTime =
+            now +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1.0 / m_implData->fps));
+    }
+
+    // The frame is considered captured when it is handed out
+    metadata = aditof::FrameMetadata();
+    metadata.sequence = ++m_implData->sequence;
+    metadata.dequeueTimestamp = aditof::monotonicTimestamp();
+    metadata.sensorTimestamp = metadata.dequeueTimestamp;
+    metadata.transferTime =
+        static_cast<uint32_t>(metadata.dequeueTimestamp - requestTimestamp);
+
+    const uint8_t *frame = m_implData->frames->data() +
+                           m_implData->frameIndex * m_implData->frameSize;
+    m_implData->frameIndex =
+        (m_implData->frameIndex + 1) % m_implData->frameCount;
+
+    return frame;
+}
+
+aditof::Status ReplayDevice::getFrame(uint16_t *buffer) {
+    using namespace aditof;
+
+    if (!buffer) {
+        LOG(WARNING) << "Invalid adddress to buffer provided";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    // Like a sensor that is not streaming, a stopped device has no frames
+    if (!m_implData->started) {
+        LOG(WARNING) << "Device is not started";
+        return Status::GENERIC_ERROR;
+    }
+
+    if (m_implData->frameCount == 0) {
+        LOG(WARNING) << "No frame type set";
+        return Status::GENERIC_ERROR;
+    }
+
+    const uint8_t *frame = nextFrame();
+    aditof::deinterleave(reinterpret_cast<const char *>(frame), buffer,
+                         m_implData->frameSize, m_implData->frameDetails.width,
+                         m_implData->frameDetails.height);
+
+    FrameMetadata &metadata = m_implData->metadata;
+    metadata.unpackTime =
+        static_cast<uint32_t>(monotonicTimestamp() - metadata.dequeueTimestamp);
+
+    return Status::OK;
+}
+
+aditof::Status ReplayDevice::getFrameLease(aditof::FrameLease &lease) {
+    using namespace aditof;
+
+    // Like a sensor that is not streaming, a stopped device has no frames
+    if (!m_implData->started) {
+        LOG(WARNING) << "Device is not started";
+        return Status::GENERIC_ERROR;
+    }
+
+    if (m_implData->frameCount == 0) {
+        LOG(WARNING) << "No frame type set";
+        return Status::GENERIC_ERROR;
+    }
+
+    // The frame stays valid until the lease is released, even if the frame
+    // type changes meanwhile
+    FrameDetails details = m_implData->frameDetails;
+    auto unpack = [details](const uint8_t *data, size_t size,
+                            uint16_t *buffer) {
+        aditof::deinterleave(reinterpret_cast<const char *>(data), buffer,
+                             size, details.width, details.height);
+    };
+    std::shared_ptr<const std::vector<uint8_t>> frames = m_implData->frames;
+    auto release = [frames]() {};
+
+    lease = FrameLease(std::unique_ptr<FrameLeaseImpl>(
+        new FrameLeaseImpl(details, nextFrame(), m_implData->frameSize,
+                           unpack, release)));
+
+    return Status::OK;
+}
+
+aditof::Status ReplayDevice::getFrameMetadata(aditof::FrameMetadata &metadata) {
+    metadata = m_implData->metadata;
+
+    return aditof::Status::OK;
+}
+
+aditof::Status ReplayDevice::readEeprom(uint32_t address, uint8_t *data,
+                                        size_t length) {
+    using namespace aditof;
+
+    if (address == 0xFFFFFFFE && length == sizeof(uint32_t)) {
+        uint32_t size = static_cast<uint32_t>(m_implData->firmware.size());
+        memcpy(data, &size, sizeof(size));
+        return Status::OK;
+    }
+
+    const std::vector<uint8_t> &image =
+        address == 0xFFFFFFFF ? m_implData->firmware : m_implData->eeprom;
+    size_t offset = address == 0xFFFFFFFF ? 0 : address;
+    if (offset + length > image.size()) {
+        LOG(WARNING) << "Read of " << length << " bytes at " << address
+                     << " is outside of the recorded EEPROM";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    std::copy(image.begin() + offset, image.begin() + offset + length, data);
+
+    return Status::OK;
+}
+
+aditof::Status ReplayDevice::writeEeprom(uint32_t address, const uint8_t *data,
+                                         size_t length) {
+    if (address + length > m_implData->eeprom.size()) {
+        m_implData->eeprom.resize(address + length, 0xFF);
+    }
+    std::copy(data, data + length, m_implData->eeprom.begin() + address);
+
+    return aditof::Status::OK;
+}
+
+aditof::Status ReplayDevice::readAfeRegisters(const uint16_t *address,
+                                              uint16_t *data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        auto reg = m_implData->afeRegisters.find(address[i]);
+        data[i] = reg != m_implData->afeRegisters.end() ? reg->second : 0;
+    }
+
+    return aditof::Status::OK;
+}
+
+aditof::Status ReplayDevice::writeAfeRegisters(const uint16_t *address,
+                                               const uint16_t *data,
+                                               size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        m_implData->afeRegisters[address[i]] = data[i];
+    }
+
+    return aditof::Status::OK;
+}
+
+aditof::Status ReplayDevice::readAfeTemp(float &temperature) {
+    temperature = m_implData->afeTemperature;
+
+    return aditof::Status::OK;
+}
+
+aditof::Status ReplayDevice::readLaserTemp(float &temperature) {
+    temperature = m_implData->laserTemperature;
+
+    return aditof::Status::OK;
+}
+
+aditof::Status ReplayDevice::getDetails(aditof::DeviceDetails &details) const {
+    details = m_deviceDetails;
+
+    return aditof::Status::OK;
+}
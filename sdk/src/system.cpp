@@ -56,4 +56,10 @@ System::getCameraListAtIp(std::vector<std::shared_ptr<Camera>> &cameraList,
     return m_impl->getCameraListAtIp(cameraList, ip);
 }
 
+Status System::getCameraListFromReplay(
+    std::vector<std::shared_ptr<Camera>> &cameraList,
+    const std::string &manifest) const {
+    return m_impl->getCameraListFromReplay(cameraList, manifest);
+}
+
 } // namespace aditof
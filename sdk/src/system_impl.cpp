@@ -101,3 +101,26 @@ aditof::Status SystemImpl::getCameraListAtIp(
 
     return Status::OK;
 }
+
+aditof::Status SystemImpl::getCameraListFromReplay(
+    std::vector<std::shared_ptr<aditof::Camera>> &cameraList,
+    const std::string &manifest) const {
+    using namespace aditof;
+
+    cameraList.clear();
+
+    DeviceConstructionData data;
+    data.deviceType = DeviceType::REPLAY;
+    data.driverPath = manifest;
+
+    std::unique_ptr<DeviceInterface> device = DeviceFactory::buildDevice(data);
+    std::shared_ptr<Camera> camera =
+        CameraFactory::buildCamera(std::move(device));
+    if (!camera) {
+        LOG(WARNING) << "Failed to create a camera for replay: " << manifest;
+        return Status::GENERIC_ERROR;
+    }
+    cameraList.emplace_back(camera);
+
+    return Status::OK;
+}
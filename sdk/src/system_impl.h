@@ -55,6 +55,9 @@ class SystemImpl {
     aditof::Status
     getCameraListAtIp(std::vector<std::shared_ptr<aditof::Camera>> &cameraList,
                       const std::string &ip) const;
+    aditof::Status getCameraListFromReplay(
+        std::vector<std::shared_ptr<aditof::Camera>> &cameraList,
+        const std::string &manifest) const;
 
   private:
     std::unique_ptr<aditof::DeviceEnumeratorInterface> m_enumerator;
@@ -30,7 +30,10 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include "local_device.h"
+#include "device_utils.h"
+#include "frame_lease_impl.h"
 #include "target_definitions.h"
+#include <aditof/frame_lease.h>
 #include <aditof/frame_operations.h>
 #include <fstream>
 
@@ -41,6 +44,7 @@ extern "C" {
 
 #include <algorithm>
 #include <arm_neon.h>
+#include <cassert>
 #include <cmath>
 #include <fcntl.h>
 #include <glog/logging.h>
@@ -83,6 +87,7 @@ struct LocalDevice::ImplData {
     enum v4l2_buf_type videoBuffersType;
     std::unordered_map<std::string, CalibrationData> calibration_cache;
     eeprom edev;
+    aditof::FrameMetadata metadata;
 
     ImplData()
         : fd(-1), sfd(-1), videoBuffers(nullptr),
@@ -500,45 +505,13 @@ aditof::Status LocalDevice::program(const uint8_t *firmware, size_t size) {
     return status;
 }
 
-aditof::Status LocalDevice::getFrame(uint16_t *buffer) {
-    using namespace aditof;
-
-    Status status = waitForBuffer();
-    if (status != Status::OK) {
-        return status;
-    }
-
-    struct v4l2_buffer buf;
-
-    status = dequeueInternalBuffer(buf);
-    if (status != Status::OK) {
-        return status;
-    }
-
-    unsigned int width;
-    unsigned int height;
-    unsigned int buf_data_len;
-    uint8_t *pdata;
-
-    width = m_implData->frameDetails.width;
-    height = m_implData->frameDetails.height;
-
-    status = getInternalBuffer(&pdata, buf_data_len, buf);
-    if (status != Status::OK) {
-        return status;
-    }
-
-    auto isBufferPacked = [](const struct v4l2_buffer &buf, unsigned int width,
-                             unsigned int height) {
-        unsigned int bytesused = 0;
-        if (buf.type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
-            bytesused = buf.m.planes[0].bytesused;
-        } else {
-            bytesused = buf.bytesused;
-        }
-
-        return bytesused == (width * height * 3 / 2);
-    };
+// Converts the content of a video buffer to 16 bits per pixel
+static void unpackFrameData(const uint8_t *pdata, unsigned int buf_data_len,
+                            unsigned int bytesused, bool isPacked,
+                            const aditof::FrameDetails &details,
+                            uint16_t *buffer) {
+    unsigned int width = details.width;
+    unsigned int height = details.height;
 
     if ((width == 668)) {
         unsigned int j = 0;
@@ -555,13 +528,13 @@ aditof::Status LocalDevice::getFrame(uint16_t *buffer) {
                         ((((unsigned short)*(pdata + i + 2)) & 0x00F0) >> 4);
             j++;
         }
-    } else if (!isBufferPacked(buf, width, height)) {
+    } else if (!isPacked) {
         // TODO: investigate optimizations for this (arm neon / 1024 bytes
         // chunks)
-        if (m_implData->frameDetails.type == "depth_only") {
-            memcpy(buffer, pdata, buf.bytesused);
-        } else if (m_implData->frameDetails.type == "ir_only") {
-            memcpy(buffer + (width * height) / 2, pdata, buf.bytesused);
+        if (details.type == "depth_only") {
+            memcpy(buffer, pdata, bytesused);
+        } else if (details.type == "ir_only") {
+            memcpy(buffer + (width * height) / 2, pdata, bytesused);
         }
     } else {
         // clang-format off
@@ -569,8 +542,8 @@ aditof::Status LocalDevice::getFrame(uint16_t *buffer) {
         uint16_t *irPtr = buffer + (width * height) / 2;
         unsigned int j = 0;
 
-	if (m_implData->frameDetails.type == "depth_only" ||
-		m_implData->frameDetails.type == "ir_only") {
+	if (details.type == "depth_only" ||
+		details.type == "ir_only") {
 		buf_data_len /= 2;
 	}
         /* The frame is read from the device as an array of uint8_t's where
@@ -606,10 +579,10 @@ aditof::Status LocalDevice::getFrame(uint16_t *buffer) {
             toStore.val[0] = aBuffer;
             toStore.val[1] = bBuffer;
 
-            if (m_implData->frameDetails.type == "depth_only") {
+            if (details.type == "depth_only") {
                 vst2q_u16(depthPtr, toStore);
                 depthPtr += 16;
-            } else if (m_implData->frameDetails.type == "ir_only") {
+            } else if (details.type == "ir_only") {
                 vst2q_u16(irPtr, toStore);
                 irPtr += 16;
             } else {
@@ -627,6 +600,69 @@ aditof::Status LocalDevice::getFrame(uint16_t *buffer) {
         }
         // clang-format on
     }
+}
+
+static bool isBufferPacked(const struct v4l2_buffer &buf, unsigned int width,
+                           unsigned int height) {
+    unsigned int bytesused = 0;
+    if (buf.type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+        bytesused = buf.m.planes[0].bytesused;
+    } else {
+        bytesused = buf.bytesused;
+    }
+
+    return bytesused == (width * height * 3 / 2);
+}
+
+// Copies a dequeued buffer so that it outlives the next dequeue. Multi-planar
+// buffers point to the plane descriptions of ImplData, which are copied into
+// plane. Single-planar buffers hold the offset of their memory in place of
+// the planes pointer, so there is nothing to copy.
+static void copyDequeuedBuffer(const struct v4l2_buffer &buf,
+                               struct v4l2_buffer &copy,
+                               struct v4l2_plane &plane) {
+    copy = buf;
+    if (buf.type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+        assert(buf.m.planes != nullptr && buf.length >= 1);
+        plane = buf.m.planes[0];
+        copy.m.planes = &plane;
+    }
+}
+
+aditof::Status LocalDevice::getFrame(uint16_t *buffer) {
+    using namespace aditof;
+
+    uint64_t requestTimestamp = monotonicTimestamp();
+
+    Status status = waitForBuffer();
+    if (status != Status::OK) {
+        return status;
+    }
+
+    struct v4l2_buffer buf;
+
+    status = dequeueInternalBuffer(buf);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    FrameMetadata &metadata = m_implData->metadata;
+    setBufferMetadata(buf, requestTimestamp, metadata);
+
+    unsigned int buf_data_len;
+    uint8_t *pdata;
+
+    status = getInternalBuffer(&pdata, buf_data_len, buf);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    unpackFrameData(pdata, buf_data_len, buf.bytesused,
+                    isBufferPacked(buf, m_implData->frameDetails.width,
+                                   m_implData->frameDetails.height),
+                    m_implData->frameDetails, buffer);
+    metadata.unpackTime =
+        static_cast<uint32_t>(monotonicTimestamp() - metadata.dequeueTimestamp);
 
     status = enqueueInternalBuffer(buf);
     if (status != Status::OK) {
@@ -636,6 +672,73 @@ aditof::Status LocalDevice::getFrame(uint16_t *buffer) {
     return status;
 }
 
+aditof::Status LocalDevice::getFrameLease(aditof::FrameLease &lease) {
+    using namespace aditof;
+
+    uint64_t requestTimestamp = monotonicTimestamp();
+
+    Status status = waitForBuffer();
+    if (status != Status::OK) {
+        return status;
+    }
+
+    // The buffer keeps its own copy of the plane description since the one
+    // in ImplData is reused by the next dequeue.
+    struct LeasedBuffer {
+        struct v4l2_buffer buf;
+        struct v4l2_plane plane;
+    };
+    std::shared_ptr<LeasedBuffer> leased = std::make_shared<LeasedBuffer>();
+
+    struct v4l2_buffer buf;
+    status = dequeueInternalBuffer(buf);
+    if (status != Status::OK) {
+        return status;
+    }
+    copyDequeuedBuffer(buf, leased->buf, leased->plane);
+
+    // The frame is unpacked later, when the lease data is first requested
+    setBufferMetadata(leased->buf, requestTimestamp, m_implData->metadata);
+
+    unsigned int buf_data_len;
+    uint8_t *pdata;
+
+    status = getInternalBuffer(&pdata, buf_data_len, leased->buf);
+    if (status != Status::OK) {
+        enqueueInternalBuffer(leased->buf);
+        return status;
+    }
+
+    FrameDetails details = m_implData->frameDetails;
+    unsigned int bytesused = leased->buf.bytesused;
+    bool isPacked = isBufferPacked(leased->buf, details.width, details.height);
+    int fd = m_implData->fd;
+
+    auto unpack = [details, bytesused, isPacked](const uint8_t *data,
+                                                 size_t size,
+                                                 uint16_t *buffer) {
+        unpackFrameData(data, size, bytesused, isPacked, details, buffer);
+    };
+    auto release = [fd, leased]() {
+        if (xioctl(fd, VIDIOC_QBUF, &leased->buf) == -1) {
+            LOG(WARNING) << "VIDIOC_QBUF error "
+                         << "errno: " << errno
+                         << " error: " << strerror(errno);
+        }
+    };
+
+    lease = FrameLease(std::unique_ptr<FrameLeaseImpl>(
+        new FrameLeaseImpl(details, pdata, buf_data_len, unpack, release)));
+
+    return status;
+}
+
+aditof::Status LocalDevice::getFrameMetadata(aditof::FrameMetadata &metadata) {
+    metadata = m_implData->metadata;
+
+    return aditof::Status::OK;
+}
+
 aditof::Status LocalDevice::readEeprom(uint32_t address, uint8_t *data,
                                        size_t length) {
     using namespace aditof;
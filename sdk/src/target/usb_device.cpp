@@ -65,6 +65,10 @@ aditof::Status UsbDevice::getFrame(uint16_t * /*buffer*/) {
     return aditof::Status::GENERIC_ERROR;
 }
 
+aditof::Status UsbDevice::getFrameLease(aditof::FrameLease & /*lease*/) {
+    return aditof::Status::GENERIC_ERROR;
+}
+
 aditof::Status UsbDevice::readEeprom(uint32_t /*address*/, uint8_t * /*data*/,
                                      size_t /*length*/) {
     return aditof::Status::GENERIC_ERROR;
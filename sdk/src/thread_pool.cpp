@@ -0,0 +1,168 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace {
+
+// Shared by the caller of parallelFor() and the helper tasks. A helper that
+// starts after every chunk was taken leaves without touching the body, so
+// it doesn't matter that parallelFor() may have returned by then.
+struct ParallelForState {
+    size_t begin;
+    size_t end;
+    size_t grain;
+    size_t chunkCount;
+    const std::function<void(size_t, size_t)> *body;
+
+    std::atomic<size_t> nextChunk;
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t doneChunks;
+
+    void runChunks() {
+        size_t done = 0;
+        size_t chunk;
+        while ((chunk = nextChunk.fetch_add(1)) < chunkCount) {
+            size_t first = begin + chunk * grain;
+            (*body)(first, std::min(first + grain, end));
+            ++done;
+        }
+
+        if (done > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            doneChunks += done;
+            if (doneChunks == chunkCount) {
+                cv.notify_all();
+            }
+        }
+    }
+};
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threadCount) : m_stop(false) {
+    if (threadCount == 0) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 0;
+    }
+
+    for (size_t i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&ThreadPool::workerThread, this);
+    }
+}
+
+ThreadPool &ThreadPool::instance() {
+    // Never destroyed: its workers must not be joined while the statics of
+    // the process are destroyed, and frames may still be processed then.
+    static ThreadPool *pool = new ThreadPool;
+    return *pool;
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+
+    for (std::thread &thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    if (m_threads.empty()) {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain,
+                             const std::function<void(size_t, size_t)> &body) {
+    if (end <= begin) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+
+    size_t chunkCount = (end - begin + grain - 1) / grain;
+    if (chunkCount == 1 || m_threads.empty()) {
+        for (size_t first = begin; first < end; first += grain) {
+            body(first, std::min(first + grain, end));
+        }
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->begin = begin;
+    state->end = end;
+    state->grain = grain;
+    state->chunkCount = chunkCount;
+    state->body = &body;
+    state->nextChunk = 0;
+    state->doneChunks = 0;
+
+    size_t helperCount = std::min(m_threads.size(), chunkCount - 1);
+    for (size_t i = 0; i < helperCount; ++i) {
+        submit([state]() { state->runChunks(); });
+    }
+
+    state->runChunks();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&]() { return state->doneChunks == chunkCount; });
+}
+
+void ThreadPool::workerThread() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,95 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! ThreadPool - A fixed set of worker threads running queued tasks
+/*!
+    The workers are started by the constructor and sleep while the queue is
+    empty. parallelFor() splits a range into chunks that are run by the
+    workers and by the calling thread, which makes it safe to call from a
+    task: when all the workers are busy the caller does the work itself.
+    The destructor runs the tasks that are still queued, then joins the
+    workers. The per-frame kernels of the sdk share instance(), so that
+    cameras and filters don't each start a set of threads.
+*/
+class ThreadPool {
+  public:
+    //! ThreadPool - Start threadCount workers. 0 starts one less than the
+    //! number of cores, the calling thread being the last one.
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    //! instance - The pool shared by the process, started on first use
+    static ThreadPool &instance();
+
+    //! threadCount - Number of workers
+    size_t threadCount() const { return m_threads.size(); }
+
+    //! submit - Queue a task to be run by a worker
+    void submit(std::function<void()> task);
+
+    //! parallelFor - Run body on [begin, end) split in chunks
+    /*!
+        Returns once all the chunks are done. The chunks are run in any order
+        and concurrently, body must only touch what belongs to its chunk.
+        \param begin - the first index
+        \param end - one past the last index
+        \param grain - the size of a chunk, the last one may be smaller
+        \param body - called with the [first, last) range of a chunk
+    */
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t)> &body);
+
+  private:
+    void workerThread();
+
+  private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_stop;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,505 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "undistortion.h"
+#include "cpu_features.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glog/logging.h>
+
+#if defined(ADITOF_X86)
+#include <emmintrin.h>
+#endif
+
+#if defined(ADITOF_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace aditof;
+
+// The position of a source between its 4 pixels is stored with 5 bits, the
+// bilinear weights have 10 bits and the sums fit in 32 bits for any 16 bit
+// pixel values
+#define FRACTION_BITS 5
+#define FRACTION_ONE (1 << FRACTION_BITS)
+#define WEIGHT_BITS (2 * FRACTION_BITS)
+
+// The rows are split in bands of this many rows between the threads
+static const size_t skRowsPerBand = 16;
+
+// Depth is interpolated when the 4 source pixels differ by less than 1/16 of
+// the smallest one, about the noise of the sensor
+#define EDGE_SHIFT 4
+
+struct RemapTable {
+    const int32_t *offsets;
+    const uint8_t *fractionsX;
+    const uint8_t *fractionsY;
+    size_t width;
+};
+
+/* The kernels write the pixels [first, last) of the undistorted image from
+ * the distorted source. The SIMD kernels process last - first - (last -
+ * first) % 8 pixels and finish with the scalar kernel; they give the same
+ * values as the scalar kernel. The 4 source pixels are read with scalar
+ * loads, which are as fast as a hardware gather on most machines.
+ */
+typedef void (*BilinearKernel)(const uint16_t *source, const RemapTable &table,
+                               uint16_t *image, size_t first, size_t last);
+typedef void (*EdgeAwareKernel)(const uint16_t *source,
+                                const RemapTable &table, uint16_t *image,
+                                size_t first, size_t last, uint16_t maxDepth);
+
+static inline uint16_t bilinearPixel(const uint16_t *p, size_t width,
+                                     uint32_t fx, uint32_t fy) {
+    uint32_t top = p[0] * (FRACTION_ONE - fx) + p[1] * fx;
+    uint32_t bottom = p[width] * (FRACTION_ONE - fx) + p[width + 1] * fx;
+    return static_cast<uint16_t>(
+        (top * (FRACTION_ONE - fy) + bottom * fy + (1 << (WEIGHT_BITS - 1))) >>
+        WEIGHT_BITS);
+}
+
+static inline uint16_t nearestPixel(const uint16_t *p, size_t width,
+                                    uint32_t fx, uint32_t fy) {
+    return p[(fy >= FRACTION_ONE / 2 ? width : 0) +
+             (fx >= FRACTION_ONE / 2 ? 1 : 0)];
+}
+
+static void bilinearScalar(const uint16_t *source, const RemapTable &table,
+                           uint16_t *image, size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+        int32_t offset = table.offsets[i];
+        image[i] = offset < 0 ? 0
+                              : bilinearPixel(source + offset, table.width,
+                                              table.fractionsX[i],
+                                              table.fractionsY[i]);
+    }
+}
+
+static void nearestScalar(const uint16_t *source, const RemapTable &table,
+                          uint16_t *image, size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+        int32_t offset = table.offsets[i];
+        image[i] = offset < 0 ? 0
+                              : nearestPixel(source + offset, table.width,
+                                             table.fractionsX[i],
+                                             table.fractionsY[i]);
+    }
+}
+
+static void edgeAwareScalar(const uint16_t *source, const RemapTable &table,
+                            uint16_t *image, size_t first, size_t last,
+                            uint16_t maxDepth) {
+    const size_t width = table.width;
+
+    for (size_t i = first; i < last; ++i) {
+        int32_t offset = table.offsets[i];
+        if (offset < 0) {
+            image[i] = 0;
+            continue;
+        }
+
+        const uint16_t *p = source + offset;
+        uint16_t low = std::min(std::min(p[0], p[1]),
+                                std::min(p[width], p[width + 1]));
+        uint16_t high = std::max(std::max(p[0], p[1]),
+                                 std::max(p[width], p[width + 1]));
+        uint32_t fx = table.fractionsX[i];
+        uint32_t fy = table.fractionsY[i];
+
+        if (low != 0 && high < maxDepth && high - low <= (low >> EDGE_SHIFT)) {
+            image[i] = bilinearPixel(p, width, fx, fy);
+        } else {
+            image[i] = nearestPixel(p, width, fx, fy);
+        }
+    }
+}
+
+//! gatherNeighbors - Load the 4 source pixels of 8 pixels, 0 for the pixels
+//! that see outside of the image
+static inline void gatherNeighbors(const uint16_t *source,
+                                   const RemapTable &table, size_t i,
+                                   uint16_t neighbors[4][8]) {
+    const size_t width = table.width;
+    for (int k = 0; k < 8; ++k) {
+        int32_t offset = table.offsets[i + k];
+        if (offset < 0) {
+            neighbors[0][k] = neighbors[1][k] = 0;
+            neighbors[2][k] = neighbors[3][k] = 0;
+            continue;
+        }
+        const uint16_t *p = source + offset;
+        neighbors[0][k] = p[0];
+        neighbors[1][k] = p[1];
+        neighbors[2][k] = p[width];
+        neighbors[3][k] = p[width + 1];
+    }
+}
+
+#if defined(ADITOF_X86)
+ADITOF_TARGET("sse2")
+static inline __m128i load8(const uint16_t *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+//! multiplyAdd - Add the 32 bit products of 8 unsigned 16 bit values
+ADITOF_TARGET("sse2")
+static inline void multiplyAdd(__m128i values, __m128i weights, __m128i &lo,
+                               __m128i &hi) {
+    __m128i productLo = _mm_mullo_epi16(values, weights);
+    __m128i productHi = _mm_mulhi_epu16(values, weights);
+    lo = _mm_add_epi32(lo, _mm_unpacklo_epi16(productLo, productHi));
+    hi = _mm_add_epi32(hi, _mm_unpackhi_epi16(productLo, productHi));
+}
+
+ADITOF_TARGET("sse2")
+static inline __m128i bilinearSse2(const uint16_t neighbors[4][8],
+                                   const RemapTable &table, size_t i) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(FRACTION_ONE);
+
+    __m128i fx = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(
+            reinterpret_cast<const __m128i *>(table.fractionsX + i)),
+        zero);
+    __m128i fy = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(
+            reinterpret_cast<const __m128i *>(table.fractionsY + i)),
+        zero);
+    __m128i ifx = _mm_sub_epi16(one, fx);
+    __m128i ify = _mm_sub_epi16(one, fy);
+
+    __m128i lo = _mm_set1_epi32(1 << (WEIGHT_BITS - 1));
+    __m128i hi = lo;
+    multiplyAdd(load8(neighbors[0]), _mm_mullo_epi16(ifx, ify), lo, hi);
+    multiplyAdd(load8(neighbors[1]), _mm_mullo_epi16(fx, ify), lo, hi);
+    multiplyAdd(load8(neighbors[2]), _mm_mullo_epi16(ifx, fy), lo, hi);
+    multiplyAdd(load8(neighbors[3]), _mm_mullo_epi16(fx, fy), lo, hi);
+
+    // Unsigned 32 to 16 bit packing, which SSE2 doesn't have: the values are
+    // moved to the signed range, packed, then moved back
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+    lo = _mm_sub_epi32(_mm_srli_epi32(lo, WEIGHT_BITS), bias32);
+    hi = _mm_sub_epi32(_mm_srli_epi32(hi, WEIGHT_BITS), bias32);
+    return _mm_xor_si128(_mm_packs_epi32(lo, hi), bias16);
+}
+
+ADITOF_TARGET("sse2")
+static void bilinearSse2(const uint16_t *source, const RemapTable &table,
+                         uint16_t *image, size_t first, size_t last) {
+    uint16_t neighbors[4][8];
+
+    size_t end = last - (last - first) % 8;
+    for (size_t i = first; i < end; i += 8) {
+        gatherNeighbors(source, table, i, neighbors);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(image + i),
+                         bilinearSse2(neighbors, table, i));
+    }
+
+    bilinearScalar(source, table, image, end, last);
+}
+
+ADITOF_TARGET("sse2")
+static void edgeAwareSse2(const uint16_t *source, const RemapTable &table,
+                          uint16_t *image, size_t first, size_t last,
+                          uint16_t maxDepth) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+    const __m128i maxDepthVec = _mm_set1_epi16(static_cast<short>(maxDepth));
+    uint16_t neighbors[4][8];
+    uint16_t nearest[8];
+
+    size_t end = last - (last - first) % 8;
+    for (size_t i = first; i < end; i += 8) {
+        gatherNeighbors(source, table, i, neighbors);
+        for (int k = 0; k < 8; ++k) {
+            uint32_t fx = table.fractionsX[i + k];
+            uint32_t fy = table.fractionsY[i + k];
+            nearest[k] = neighbors[(fy >= FRACTION_ONE / 2 ? 2 : 0) +
+                                   (fx >= FRACTION_ONE / 2 ? 1 : 0)][k];
+        }
+
+        // Unsigned min and max, with the signed instructions of SSE2
+        __m128i low = _mm_set1_epi16(0x7FFF);
+        __m128i high = bias16;
+        for (int n = 0; n < 4; ++n) {
+            __m128i v = _mm_xor_si128(load8(neighbors[n]), bias16);
+            low = _mm_min_epi16(low, v);
+            high = _mm_max_epi16(high, v);
+        }
+        low = _mm_xor_si128(low, bias16);
+        high = _mm_xor_si128(high, bias16);
+
+        // low != 0 && high < maxDepth && high - low <= low >> EDGE_SHIFT
+        __m128i spread = _mm_subs_epu16(high, low);
+        __m128i smooth = _mm_cmpeq_epi16(
+            _mm_subs_epu16(spread, _mm_srli_epi16(low, EDGE_SHIFT)), zero);
+        __m128i saturated =
+            _mm_cmpeq_epi16(_mm_subs_epu16(maxDepthVec, high), zero);
+        __m128i interpolate = _mm_andnot_si128(
+            _mm_cmpeq_epi16(low, zero), _mm_andnot_si128(saturated, smooth));
+
+        __m128i result = _mm_or_si128(
+            _mm_and_si128(interpolate, bilinearSse2(neighbors, table, i)),
+            _mm_andnot_si128(interpolate, load8(nearest)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(image + i), result);
+    }
+
+    edgeAwareScalar(source, table, image, end, last, maxDepth);
+}
+#endif // ADITOF_X86
+
+#if defined(ADITOF_NEON)
+static inline uint16x8_t bilinearNeon(const uint16_t neighbors[4][8],
+                                      const RemapTable &table, size_t i) {
+    const uint16x8_t one = vdupq_n_u16(FRACTION_ONE);
+    uint16x8_t fx = vmovl_u8(vld1_u8(table.fractionsX + i));
+    uint16x8_t fy = vmovl_u8(vld1_u8(table.fractionsY + i));
+    uint16x8_t ifx = vsubq_u16(one, fx);
+    uint16x8_t ify = vsubq_u16(one, fy);
+
+    uint16x8_t weights[4] = {vmulq_u16(ifx, ify), vmulq_u16(fx, ify),
+                             vmulq_u16(ifx, fy), vmulq_u16(fx, fy)};
+    uint32x4_t lo = vdupq_n_u32(0);
+    uint32x4_t hi = vdupq_n_u32(0);
+    for (int n = 0; n < 4; ++n) {
+        uint16x8_t v = vld1q_u16(neighbors[n]);
+        lo = vmlal_u16(lo, vget_low_u16(v), vget_low_u16(weights[n]));
+        hi = vmlal_u16(hi, vget_high_u16(v), vget_high_u16(weights[n]));
+    }
+
+    return vcombine_u16(vrshrn_n_u32(lo, WEIGHT_BITS),
+                        vrshrn_n_u32(hi, WEIGHT_BITS));
+}
+
+static void bilinearNeon(const uint16_t *source, const RemapTable &table,
+                         uint16_t *image, size_t first, size_t last) {
+    uint16_t neighbors[4][8];
+
+    size_t end = last - (last - first) % 8;
+    for (size_t i = first; i < end; i += 8) {
+        gatherNeighbors(source, table, i, neighbors);
+        vst1q_u16(image + i, bilinearNeon(neighbors, table, i));
+    }
+
+    bilinearScalar(source, table, image, end, last);
+}
+
+static void edgeAwareNeon(const uint16_t *source, const RemapTable &table,
+                          uint16_t *image, size_t first, size_t last,
+                          uint16_t maxDepth) {
+    const uint16x8_t maxDepthVec = vdupq_n_u16(maxDepth);
+    uint16_t neighbors[4][8];
+    uint16_t nearest[8];
+
+    size_t end = last - (last - first) % 8;
+    for (size_t i = first; i < end; i += 8) {
+        gatherNeighbors(source, table, i, neighbors);
+        for (int k = 0; k < 8; ++k) {
+            uint32_t fx = table.fractionsX[i + k];
+            uint32_t fy = table.fractionsY[i + k];
+            nearest[k] = neighbors[(fy >= FRACTION_ONE / 2 ? 2 : 0) +
+                                   (fx >= FRACTION_ONE / 2 ? 1 : 0)][k];
+        }
+
+        uint16x8_t p0 = vld1q_u16(neighbors[0]);
+        uint16x8_t p1 = vld1q_u16(neighbors[1]);
+        uint16x8_t p2 = vld1q_u16(neighbors[2]);
+        uint16x8_t p3 = vld1q_u16(neighbors[3]);
+        uint16x8_t low = vminq_u16(vminq_u16(p0, p1), vminq_u16(p2, p3));
+        uint16x8_t high = vmaxq_u16(vmaxq_u16(p0, p1), vmaxq_u16(p2, p3));
+
+        uint16x8_t interpolate = vandq_u16(
+            vandq_u16(vtstq_u16(low, low), vcltq_u16(high, maxDepthVec)),
+            vcleq_u16(vsubq_u16(high, low), vshrq_n_u16(low, EDGE_SHIFT)));
+
+        vst1q_u16(image + i, vbslq_u16(interpolate,
+                                       bilinearNeon(neighbors, table, i),
+                                       vld1q_u16(nearest)));
+    }
+
+    edgeAwareScalar(source, table, image, end, last, maxDepth);
+}
+#endif // ADITOF_NEON
+
+static BilinearKernel selectBilinearKernel() {
+    const CpuFeatures &features = cpuFeatures();
+
+#if defined(ADITOF_X86)
+    if (features.sse2) {
+        return bilinearSse2;
+    }
+#endif
+
+#if defined(ADITOF_NEON)
+    if (features.neon) {
+        return bilinearNeon;
+    }
+#endif
+
+    (void)features;
+    return bilinearScalar;
+}
+
+static EdgeAwareKernel selectEdgeAwareKernel() {
+    const CpuFeatures &features = cpuFeatures();
+
+#if defined(ADITOF_X86)
+    if (features.sse2) {
+        return edgeAwareSse2;
+    }
+#endif
+
+#if defined(ADITOF_NEON)
+    if (features.neon) {
+        return edgeAwareNeon;
+    }
+#endif
+
+    (void)features;
+    return edgeAwareScalar;
+}
+
+Undistortion::Undistortion() : m_width(0), m_height(0) {}
+
+Undistortion::~Undistortion() = default;
+
+Status Undistortion::setIntrinsics(const IntrinsicParameters &intrinsics,
+                                   unsigned int width, unsigned int height) {
+    const std::vector<float> &k = intrinsics.cameraMatrix;
+    if (k.size() < 9 || k[0] == 0.0f || k[4] == 0.0f) {
+        LOG(WARNING) << "Invalid camera matrix";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    if (k == m_cameraMatrix && intrinsics.distCoeffs == m_distCoeffs &&
+        width == m_width && height == m_height) {
+        return Status::OK;
+    }
+
+    const double fx = k[0];
+    const double fy = k[4];
+    const double cx = k[2];
+    const double cy = k[5];
+
+    // k1, k2, p1, p2, k3, missing coefficients are 0
+    double d[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+    for (size_t i = 0; i < 5 && i < intrinsics.distCoeffs.size(); ++i) {
+        d[i] = intrinsics.distCoeffs[i];
+    }
+
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    m_offsets.assign(pixelCount, -1);
+    m_fractionsX.assign(pixelCount, 0);
+    m_fractionsY.assign(pixelCount, 0);
+
+    for (unsigned int v = 0; v < height && width > 1 && height > 1; ++v) {
+        for (unsigned int u = 0; u < width; ++u) {
+            double x = (u - cx) / fx;
+            double y = (v - cy) / fy;
+            double r2 = x * x + y * y;
+            double radial = 1.0 + r2 * (d[0] + r2 * (d[1] + r2 * d[4]));
+            double xd =
+                x * radial + 2.0 * d[2] * x * y + d[3] * (r2 + 2.0 * x * x);
+            double yd =
+                y * radial + d[2] * (r2 + 2.0 * y * y) + 2.0 * d[3] * x * y;
+            double xs = xd * fx + cx;
+            double ys = yd * fy + cy;
+
+            if (xs < -0.5 || xs > width - 0.5 || ys < -0.5 ||
+                ys > height - 0.5) {
+                continue;
+            }
+
+            // The 4 pixels must be in the image, at the borders the source
+            // is moved onto the last pixel
+            double x0 = std::min(std::max(std::floor(xs), 0.0), width - 2.0);
+            double y0 = std::min(std::max(std::floor(ys), 0.0), height - 2.0);
+            double wx = std::min(std::max(xs - x0, 0.0), 1.0);
+            double wy = std::min(std::max(ys - y0, 0.0), 1.0);
+
+            size_t index = static_cast<size_t>(v) * width + u;
+            m_offsets[index] = static_cast<int32_t>(y0 * width + x0);
+            m_fractionsX[index] =
+                static_cast<uint8_t>(std::lround(wx * FRACTION_ONE));
+            m_fractionsY[index] =
+                static_cast<uint8_t>(std::lround(wy * FRACTION_ONE));
+        }
+    }
+
+    m_source.resize(pixelCount);
+    m_cameraMatrix = k;
+    m_distCoeffs = intrinsics.distCoeffs;
+    m_width = width;
+    m_height = height;
+
+    return Status::OK;
+}
+
+void Undistortion::undistortDepth(uint16_t *depth, uint16_t maxDepth,
+                                  DepthInterpolation interpolation) {
+    static const EdgeAwareKernel edgeAwareKernel = selectEdgeAwareKernel();
+
+    const RemapTable table = {m_offsets.data(), m_fractionsX.data(),
+                              m_fractionsY.data(), m_width};
+    const uint16_t *source = m_source.data();
+    memcpy(m_source.data(), depth, m_source.size() * sizeof(uint16_t));
+
+    ThreadPool::instance().parallelFor(
+        0, m_height, skRowsPerBand, [&](size_t firstRow, size_t lastRow) {
+            size_t first = firstRow * m_width;
+            size_t last = lastRow * m_width;
+            if (interpolation == DepthInterpolation::EDGE_AWARE) {
+                edgeAwareKernel(source, table, depth, first, last, maxDepth);
+            } else {
+                nearestScalar(source, table, depth, first, last);
+            }
+        });
+}
+
+void Undistortion::undistortIr(uint16_t *ir) {
+    static const BilinearKernel bilinearKernel = selectBilinearKernel();
+
+    const RemapTable table = {m_offsets.data(), m_fractionsX.data(),
+                              m_fractionsY.data(), m_width};
+    const uint16_t *source = m_source.data();
+    memcpy(m_source.data(), ir, m_source.size() * sizeof(uint16_t));
+
+    ThreadPool::instance().parallelFor(
+        0, m_height, skRowsPerBand, [&](size_t firstRow, size_t lastRow) {
+            bilinearKernel(source, table, ir, firstRow * m_width,
+                           lastRow * m_width);
+        });
+}
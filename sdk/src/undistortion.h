@@ -0,0 +1,98 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Analog Devices, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef UNDISTORTION_H
+#define UNDISTORTION_H
+
+
+#include <aditof/camera_96tof1_specifics.h>
+#include <aditof/camera_definitions.h>
+#include <aditof/status_definitions.h>
+
+#include <stdint.h>
+#include <vector>
+
+//! Undistortion - Removes the lens distortion from depth and IR images
+/*!
+    The source pixel of every pixel of the undistorted image is computed once
+    per intrinsic parameters and image size, with the distortion model of
+    OpenCV (k1, k2, p1, p2, k3), and stored in fixed point: the offset of the
+    top-left of the 4 source pixels around it and the position between them
+    in 1/32 of a pixel. Pixels that see outside of the sensor are set to 0.
+
+    IR images are interpolated bilinearly. Interpolating depth across an edge
+    would create points between the foreground and the background, so depth
+    is either taken from the nearest pixel or, with EDGE_AWARE, interpolated
+    only where the 4 source pixels are valid and close to each other.
+
+    The images are processed in place, in bands of rows run on the thread
+    pool of the process.
+    The methods must not be called from several threads at once.
+*/
+class Undistortion {
+  public:
+    Undistortion();
+    ~Undistortion();
+
+    Undistortion(const Undistortion &) = delete;
+    Undistortion &operator=(const Undistortion &) = delete;
+
+    //! setIntrinsics - Compute the remap table for images of width x height
+    //! pixels. Nothing is recomputed if nothing changed.
+    //! \return Status::INVALID_ARGUMENT if the camera matrix is incomplete
+    aditof::Status setIntrinsics(const aditof::IntrinsicParameters &intrinsics,
+                                 unsigned int width, unsigned int height);
+
+    //! undistortDepth - Undistort a depth image, in place
+    //! \param maxDepth - depth values from maxDepth up are invalid, like 0
+    void undistortDepth(uint16_t *depth, uint16_t maxDepth,
+                        aditof::DepthInterpolation interpolation);
+
+    //! undistortIr - Undistort an IR image, in place
+    void undistortIr(uint16_t *ir);
+
+  private:
+    std::vector<float> m_cameraMatrix;
+    std::vector<float> m_distCoeffs;
+    unsigned int m_width;
+    unsigned int m_height;
+
+    // Offset in the source image of the top-left of the 4 pixels around the
+    // source of each pixel, -1 if the source is outside of the image
+    std::vector<int32_t> m_offsets;
+    // Position of the source between the 4 pixels, from 0 to 32
+    std::vector<uint8_t> m_fractionsX;
+    std::vector<uint8_t> m_fractionsY;
+
+    std::vector<uint16_t> m_source;
+};
+
+#endif // UNDISTORTION_H
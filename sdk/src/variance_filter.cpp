@@ -29,14 +29,241 @@
  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#include "cpu_features.h"
+#include "depth_filter.h"
+
+#include <aditof/frame.h>
 #include <aditof/variance_filter.h>
 
+#include <algorithm>
+#include <glog/logging.h>
+#include <vector>
+
+#if defined(ADITOF_X86)
+#include <emmintrin.h>
+#endif
+
+#if defined(ADITOF_NEON)
+#include <arm_neon.h>
+#endif
+
 using namespace aditof;
 
-Status VarianceFilter::processFrame(const Frame & /*inFrame*/,
-                                    Frame & /*outFrame*/) {
+static const unsigned int skDefaultWindowSize = 8;
+static const float skDefaultVarianceThreshold = 400.0f;
+
+/* The kernels update the mean and the variance of count pixels with their
+ * new depth and set the depth to 0 where the variance is above the threshold.
+ * With weight = 1 / n, the update is the one of Welford for the n-th sample:
+ *     delta = x - mean
+ *     mean += weight * delta
+ *     variance = (1 - weight) * (variance + weight * delta * delta)
+ * which keeps the population variance of the samples. The SIMD kernels give
+ * the same values as the scalar kernel.
+ */
+typedef void (*VarianceKernel)(uint16_t *depth, float *mean, float *variance,
+                               size_t count, float weight, float threshold);
+
+static void updateScalar(uint16_t *depth, float *mean, float *variance,
+                         size_t count, float weight, float threshold) {
+    const float keep = 1.0f - weight;
+
+    for (size_t i = 0; i < count; ++i) {
+        float delta = static_cast<float>(depth[i]) - mean[i];
+        float weightedDelta = weight * delta;
+        mean[i] = mean[i] + weightedDelta;
+        variance[i] = keep * (variance[i] + weightedDelta * delta);
+        if (variance[i] > threshold) {
+            depth[i] = 0;
+        }
+    }
+}
+
+#if defined(ADITOF_X86)
+//! update4 - Update 4 pixels and return the mask of the noisy ones
+ADITOF_TARGET("sse2")
+static inline __m128i update4(__m128i depth, float *mean, float *variance,
+                              __m128 weight, __m128 keep, __m128 threshold) {
+    __m128 m = _mm_loadu_ps(mean);
+    __m128 delta = _mm_sub_ps(_mm_cvtepi32_ps(depth), m);
+    __m128 weightedDelta = _mm_mul_ps(weight, delta);
+    __m128 v = _mm_mul_ps(
+        keep, _mm_add_ps(_mm_loadu_ps(variance),
+                         _mm_mul_ps(weightedDelta, delta)));
+    _mm_storeu_ps(mean, _mm_add_ps(m, weightedDelta));
+    _mm_storeu_ps(variance, v);
+
+    return _mm_castps_si128(_mm_cmpgt_ps(v, threshold));
+}
+
+ADITOF_TARGET("sse2")
+static void updateSse2(uint16_t *depth, float *mean, float *variance,
+                       size_t count, float weight, float threshold) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 weightVec = _mm_set1_ps(weight);
+    const __m128 keepVec = _mm_set1_ps(1.0f - weight);
+    const __m128 thresholdVec = _mm_set1_ps(threshold);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i *>(depth + i));
+        __m128i noisyLo = update4(_mm_unpacklo_epi16(d, zero), mean + i,
+                                  variance + i, weightVec, keepVec,
+                                  thresholdVec);
+        __m128i noisyHi = update4(_mm_unpackhi_epi16(d, zero), mean + i + 4,
+                                  variance + i + 4, weightVec, keepVec,
+                                  thresholdVec);
+        __m128i noisy = _mm_packs_epi32(noisyLo, noisyHi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(depth + i),
+                         _mm_andnot_si128(noisy, d));
+    }
+
+    updateScalar(depth + i, mean + i, variance + i, count - i, weight,
+                 threshold);
+}
+#endif // ADITOF_X86
+
+#if defined(ADITOF_NEON)
+static inline uint32x4_t update4(uint32x4_t depth, float *mean,
+                                 float *variance, float32x4_t weight,
+                                 float32x4_t keep, float32x4_t threshold) {
+    float32x4_t m = vld1q_f32(mean);
+    float32x4_t delta = vsubq_f32(vcvtq_f32_u32(depth), m);
+    float32x4_t weightedDelta = vmulq_f32(weight, delta);
+    float32x4_t v = vmulq_f32(
+        keep,
+        vaddq_f32(vld1q_f32(variance), vmulq_f32(weightedDelta, delta)));
+    vst1q_f32(mean, vaddq_f32(m, weightedDelta));
+    vst1q_f32(variance, v);
+
+    return vcgtq_f32(v, threshold);
+}
+
+static void updateNeon(uint16_t *depth, float *mean, float *variance,
+                       size_t count, float weight, float threshold) {
+    const float32x4_t weightVec = vdupq_n_f32(weight);
+    const float32x4_t keepVec = vdupq_n_f32(1.0f - weight);
+    const float32x4_t thresholdVec = vdupq_n_f32(threshold);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t d = vld1q_u16(depth + i);
+        uint32x4_t noisyLo =
+            update4(vmovl_u16(vget_low_u16(d)), mean + i, variance + i,
+                    weightVec, keepVec, thresholdVec);
+        uint32x4_t noisyHi =
+            update4(vmovl_u16(vget_high_u16(d)), mean + i + 4,
+                    variance + i + 4, weightVec, keepVec, thresholdVec);
+        uint16x8_t noisy =
+            vcombine_u16(vmovn_u32(noisyLo), vmovn_u32(noisyHi));
+        vst1q_u16(depth + i, vbicq_u16(d, noisy));
+    }
+
+    updateScalar(depth + i, mean + i, variance + i, count - i, weight,
+                 threshold);
+}
+#endif // ADITOF_NEON
+
+static VarianceKernel selectVarianceKernel() {
+    const CpuFeatures &features = cpuFeatures();
+
+#if defined(ADITOF_X86)
+    if (features.sse2) {
+        return updateSse2;
+    }
+#endif
+
+#if defined(ADITOF_NEON)
+    if (features.neon) {
+        return updateNeon;
+    }
+#endif
 
-    // TO DO: implement this
+    (void)features;
+    return updateScalar;
+}
+
+class VarianceFilterImpl {
+  public:
+    VarianceFilterImpl()
+        : windowSize(skDefaultWindowSize),
+          varianceThreshold(skDefaultVarianceThreshold), frameCount(0),
+          kernel(selectVarianceKernel()) {}
+
+  public:
+    unsigned int windowSize;
+    float varianceThreshold;
+
+    // The statistics of the pixels, in separate arrays so that they are
+    // loaded and stored in vectors
+    std::vector<float> mean;
+    std::vector<float> variance;
+    unsigned int frameCount;
+
+    VarianceKernel kernel;
+};
+
+VarianceFilter::VarianceFilter() : m_impl(new VarianceFilterImpl) {}
+
+VarianceFilter::~VarianceFilter() = default;
+
+Status VarianceFilter::processFrame(const Frame &inFrame, Frame &outFrame) {
+    DepthPlane depth;
+    Status status = prepareDepthFilter(inFrame, outFrame, "variance", depth);
+    if (status != Status::OK) {
+        return status;
+    }
+
+    size_t pixelCount = static_cast<size_t>(depth.width) * depth.height;
+    if (m_impl->mean.size() != pixelCount) {
+        m_impl->mean.assign(pixelCount, 0.0f);
+        m_impl->variance.assign(pixelCount, 0.0f);
+        m_impl->frameCount = 0;
+    }
+
+    // 1 / n over the first frames of the window, then a constant weight
+    if (m_impl->frameCount < m_impl->windowSize) {
+        ++m_impl->frameCount;
+    }
+    float weight = 1.0f / static_cast<float>(m_impl->frameCount);
+
+    m_impl->kernel(depth.data, m_impl->mean.data(), m_impl->variance.data(),
+                   pixelCount, weight, m_impl->varianceThreshold);
+
+    return Status::OK;
+}
+
+Status VarianceFilter::setWindowSize(unsigned int frames) {
+    if (frames == 0) {
+        LOG(WARNING) << "The window must have at least one frame";
+        return Status::INVALID_ARGUMENT;
+    }
+
+    m_impl->windowSize = frames;
+    reset();
 
     return Status::OK;
 }
+
+unsigned int VarianceFilter::windowSize() const { return m_impl->windowSize; }
+
+Status VarianceFilter::setVarianceThreshold(float threshold) {
+    if (!(threshold > 0.0f)) {
+        LOG(WARNING) << "Invalid variance threshold: " << threshold;
+        return Status::INVALID_ARGUMENT;
+    }
+
+    m_impl->varianceThreshold = threshold;
+
+    return Status::OK;
+}
+
+float VarianceFilter::varianceThreshold() const {
+    return m_impl->varianceThreshold;
+}
+
+void VarianceFilter::reset() {
+    m_impl->mean.clear();
+    m_impl->variance.clear();
+    m_impl->frameCount = 0;
+}
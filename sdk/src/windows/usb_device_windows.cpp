@@ -65,6 +65,7 @@ struct UsbDevice::ImplData {
     SampleGrabberCallback *pCB;
     GUID videoType;
     std::unordered_map<std::string, CalibrationData> calibration_cache;
+    aditof::FrameMetadata metadata;
 };
 
 static std::wstring s2ws(const std::string &s) {
@@ -701,6 +702,14 @@ aditof::Status UsbDevice::getFrame(uint16_t *buffer) {
     tmpbuffer = (unsigned short *)malloc(currentWidth * currentHeight *
                                          sizeof(unsigned short));
 
+    // The sample grabber doesn't give the capture time of the frames, only
+    // the time spent in the SDK is known
+    FrameMetadata &metadata = m_implData->metadata;
+    uint32_t sequence = metadata.sequence + 1;
+    metadata = FrameMetadata();
+    metadata.sequence = sequence;
+    uint64_t requestTimestamp = monotonicTimestamp();
+
     while (retryCount < 1000) {
         if (m_implData->pCB->newFrame == 1) {
             long bufferSize = currentWidth * currentHeight * 2;
@@ -722,15 +731,34 @@ aditof::Status UsbDevice::getFrame(uint16_t *buffer) {
         }
     }
 
+    metadata.dequeueTimestamp = monotonicTimestamp();
+    metadata.transferTime =
+        static_cast<uint32_t>(metadata.dequeueTimestamp - requestTimestamp);
+
     aditof::deinterleave((const char *)tmpbuffer, buffer,
                          currentWidth * currentHeight * 3 / 2, currentWidth,
                          currentHeight);
+    metadata.unpackTime =
+        static_cast<uint32_t>(monotonicTimestamp() - metadata.dequeueTimestamp);
 
     free(tmpbuffer);
 
     return retryCount >= 1000 ? Status::GENERIC_ERROR : status;
 }
 
+aditof::Status UsbDevice::getFrameLease(aditof::FrameLease & /*lease*/) {
+    // The sample grabber hands out copies of the frames, there is no driver
+    // buffer that could be leased.
+    LOG(WARNING) << "Frame leases are not supported on this platform";
+    return aditof::Status::UNAVAILABLE;
+}
+
+aditof::Status UsbDevice::getFrameMetadata(aditof::FrameMetadata &metadata) {
+    metadata = m_implData->metadata;
+
+    return aditof::Status::OK;
+}
+
 aditof::Status UsbDevice::readEeprom(uint32_t address, uint8_t *data,
                                      size_t length) {
     using namespace aditof;